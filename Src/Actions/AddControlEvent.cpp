@@ -18,6 +18,7 @@
 #include "Actions/EditAction.h"
 #include "Editors/ControllerEditor.h"
 #include "Midi/Track.h"
+#include "Midi/CommonMidiUtils.h"
 #include "Midi/ControllerEvent.h"
 #include "Midi/Sequence.h"
 //#include "GUI/GraphicalTrack.h"
@@ -357,4 +358,67 @@ namespace TestAddControlEvent
         delete seq;
     }
     
+    UNIT_TEST(TestMixedControllers)
+    {
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        
+        Track* t = new Track(seq);
+        
+        {
+            OwnerPtr<Sequence::Import> import(seq->startImport());
+            t->addControlEvent_import(0,   64,  0);
+            t->addControlEvent_import(0,   10,  7);
+            t->addControlEvent_import(100, 127, 0);
+            t->addControlEvent_import(100, 20,  7);
+            t->addControlEvent_import(200, 30,  7);
+        }
+        seq->addTrack(t);
+        
+        require_e(t->getControllerEventAmount(0), ==, 2, "events are counted per controller");
+        require_e(t->getControllerEventAmount(7), ==, 3, "events are counted per controller");
+        require_e((int)t->getControllerEventIDs(7).size(), ==, 3, "events are listed per controller");
+        require_e(t->getControllerEventIDs(7)[1], ==, 3, "IDs refer to the track's event vector");
+        require_e(t->findFirstControllerEventFrom(7, 150), ==, 2, "lookup by tick within a controller");
+        
+        require(t->getControllerEventAt(100, 7) != NULL, "event found at tick");
+        require_e((int)t->getControllerEventAt(100, 7)->getValue(), ==, 20, "the right controller is found");
+        require(t->getControllerEventAt(200, 0) == NULL, "events of other controllers are not found");
+        
+        // replace the second event at tick 100; the first event at that tick is of another controller
+        seq->getTrack(0)->action(new AddControlEvent(100, 50, 7));
+        
+        require_e(t->getControllerEventAmount(), ==, 5, "the event was replaced, not added");
+        require_e(t->getControllerEventAmount(0), ==, 2, "other controller was not affected");
+        require_e((int)t->getControllerEventAt(100, 0)->getValue(), ==, 127, "other controller was not affected");
+        require_e((int)t->getControllerEventAt(100, 7)->getValue(), ==, 50,  "value was replaced");
+        
+        seq->undo();
+        require_e((int)t->getControllerEventAt(100, 7)->getValue(), ==, 20, "undo restored the value");
+        
+        delete seq;
+    }
+    
+    UNIT_TEST(TestTempoChangeUpdatesTime)
+    {
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        Track* t = new Track(seq);
+        seq->addTrack(t);
+        
+        seq->setTempo(120);
+        const int beat = seq->ticksPerQuarterNote();
+        require_e(getTimeAtTick(beat*4, seq), ==, 2, "4 beats at 120 BPM last 2 seconds");
+        
+        // a tempo bend value of 127 means 20 BPM
+        seq->getTrack(0)->action(new AddControlEvent(beat*2, 127, PSEUDO_CONTROLLER_TEMPO));
+        require_e(getTimeAtTick(beat*2, seq), ==, 1, "time before the tempo change is unaffected");
+        require_e(getTimeAtTick(beat*4, seq), ==, 7, "time after the tempo change is updated");
+        require_e(seq->getTempoMap().secondsToTick(4.0), ==, beat*3, "time to tick takes the change into account");
+        
+        seq->undo();
+        require_e(seq->getTempoEventAmount(), ==, 0, "undo removed the tempo event");
+        require_e(getTimeAtTick(beat*4, seq), ==, 2, "time is updated after undo");
+        
+        delete seq;
+    }
+    
 }
@@ -48,6 +48,12 @@ namespace AriaMaestosa
             
             
             virtual ~AddControllerSlide();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(AddControllerSlide) + relocator.getMemoryUsage() +
+                       getControlEventsMemoryUsage(removedControlEvents.size());
+            }
         };
         
     }
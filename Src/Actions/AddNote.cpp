@@ -262,5 +262,45 @@ namespace TestAddNote
         delete seq;
     }
     
+    // ----------------------------------------------------------------------------------------------------------
+    
+    UNIT_TEST(TestRejectOverlapping)
+    {
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        
+        TestSequenceProvider provider(seq);
+        AriaMaestosa::setCurrentSequenceProvider(&provider);
+        
+        Track* t = new Track(seq);
+        
+        // make a factory sequence to work from, with several notes starting on the same tick
+        {
+            OwnerPtr<Sequence::Import> import(seq->startImport());
+            t->addNote_import(100 /* pitch */, 0   /* start */, 100 /* end */, 127 /* volume */, -1);
+            t->addNote_import(101 /* pitch */, 100 /* start */, 200 /* end */, 127 /* volume */, -1);
+            t->addNote_import(102 /* pitch */, 100 /* start */, 150 /* end */, 127 /* volume */, -1);
+            t->addNote_import(103 /* pitch */, 100 /* start */, 300 /* end */, 127 /* volume */, -1);
+            t->addNote_import(104 /* pitch */, 300 /* start */, 400 /* end */, 127 /* volume */, -1);
+        }
+        t->reorderNoteOffVector();
+        seq->addTrack(t);
+        
+        require(not t->addNote(new Note(t, 101, 100, 120, 127)), "note overlapping another note of the same chord is rejected");
+        require(not t->addNote(new Note(t, 103, 100, 120, 127)), "note overlapping the last note of the chord is rejected");
+        require(t->getNoteAmount() == 5, "rejected notes were not added");
+        
+        require(t->addNote(new Note(t, 105, 100, 175, 127)), "note on a free pitch is accepted");
+        require(t->getNoteAmount() == 6, "the number of events was increased");
+        require(t->getNote(4)->getPitchID() == 105, "new note is placed after existing notes with the same tick");
+        require(t->getNote(5)->getTick() == 300, "events were properly ordered");
+        
+        require(t->getNoteOffVector()[0].getEndTick() == 100, "Note off vector is properly ordered");
+        require(t->getNoteOffVector()[1].getEndTick() == 150, "Note off vector is properly ordered");
+        require(t->getNoteOffVector()[2].getEndTick() == 175, "Note off vector is properly ordered");
+        require(t->getNoteOffVector()[3].getEndTick() == 200, "Note off vector is properly ordered");
+        
+        delete seq;
+    }
+    
 }
 // ----------------------------------------------------------------------------------------------------------
@@ -53,6 +53,11 @@ namespace AriaMaestosa
 
             virtual void perform();
             virtual void undo();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(AddNote) + relocator.getMemoryUsage();
+            }
         };
     }
 }
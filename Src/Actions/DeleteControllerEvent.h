@@ -47,6 +47,11 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~DeleteControllerEvent();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(DeleteControllerEvent) + getControlEventsMemoryUsage(removedControlEvents.size());
+            }
         };
         
         
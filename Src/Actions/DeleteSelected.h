@@ -48,6 +48,12 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~DeleteSelected();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(DeleteSelected) + getNotesMemoryUsage(removedNotes.size()) +
+                       getControlEventsMemoryUsage(removedControlEvents.size());
+            }
         };
         
         
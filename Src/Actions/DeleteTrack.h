@@ -41,6 +41,13 @@ namespace AriaMaestosa
         public:
             DeleteTrack(Sequence* whichSequence);
             virtual ~DeleteTrack();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                if (m_removed_track == NULL) return sizeof(DeleteTrack);
+                return sizeof(DeleteTrack) + sizeof(Track) + getNotesMemoryUsage(m_removed_track->getNoteAmount()) +
+                       getControlEventsMemoryUsage(m_removed_track->getControllerEventAmount());
+            }
 
             void perform();
             void undo();
@@ -0,0 +1,143 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Actions/DeltaVector.h"
+#include "UnitTest.h"
+#include "Utils.h"
+
+using namespace AriaMaestosa;
+
+// ----------------------------------------------------------------------------------------------------------
+
+DeltaVector::DeltaVector()
+{
+    m_count = 0;
+    m_last  = 0;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void DeltaVector::push_back(const int value)
+{
+    // zigzag encoding, so that small negative differences also take few bytes
+    const int delta = (int)((unsigned int)value - (unsigned int)m_last);
+    unsigned int bits = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+
+    // 7 bits per byte, the high bit tells whether more bytes follow
+    while (bits >= 0x80)
+    {
+        m_bytes.push_back((unsigned char)(bits | 0x80));
+        bits >>= 7;
+    }
+    m_bytes.push_back((unsigned char)bits);
+
+    m_last = value;
+    m_count++;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void DeltaVector::compact()
+{
+    std::vector<unsigned char>(m_bytes).swap(m_bytes);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void DeltaVector::clear()
+{
+    std::vector<unsigned char>().swap(m_bytes);
+    m_count = 0;
+    m_last  = 0;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+DeltaVector::Reader::Reader(const DeltaVector& vector) : m_vector(vector)
+{
+    m_position = 0;
+    m_last     = 0;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int DeltaVector::Reader::next()
+{
+    ASSERT(hasNext());
+
+    unsigned int bits  = 0;
+    int          shift = 0;
+    while (true)
+    {
+        const unsigned char byte = m_vector.m_bytes[m_position++];
+        bits |= (unsigned int)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) break;
+        shift += 7;
+    }
+
+    const int delta = (int)(bits >> 1) ^ -(int)(bits & 1);
+    m_last = (int)((unsigned int)m_last + (unsigned int)delta);
+    return m_last;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestDeltaVector
+{
+
+    UNIT_TEST( TestRoundTrip )
+    {
+        const int input[] = {0, 960, 1920, 1900, -5, 2147483647, -2147483647 - 1, 0, 127, 127};
+        const int count = sizeof(input)/sizeof(input[0]);
+
+        DeltaVector vector;
+        for (int n=0; n<count; n++) vector.push_back(input[n]);
+        vector.compact();
+        require_e(vector.size(), ==, count, "all values were added");
+
+        DeltaVector::Reader reader(vector);
+        for (int n=0; n<count; n++)
+        {
+            require(reader.hasNext(), "values left to read");
+            require_e(reader.next(), ==, input[n], "values are read back unchanged and in order");
+        }
+        require(not reader.hasNext(), "no more values");
+
+        vector.clear();
+        require_e(vector.size(), ==, 0, "vector was cleared");
+        require(not DeltaVector::Reader(vector).hasNext(), "cleared vector has no values");
+    }
+
+    UNIT_TEST( TestCompactTicks )
+    {
+        // ticks of notes in order, as actions remember them
+        const int NOTE_COUNT = 10000;
+        DeltaVector vector;
+        for (int n=0; n<NOTE_COUNT; n++) vector.push_back(n*240 + (n % 3)*10);
+        vector.compact();
+
+        require_e(vector.getMemoryUsage(), <=, sizeof(DeltaVector) + NOTE_COUNT*2,
+                  "ticks in order take at most 2 bytes each");
+
+        DeltaVector::Reader reader(vector);
+        for (int n=0; n<NOTE_COUNT; n++)
+        {
+            require_e(reader.next(), ==, n*240 + (n % 3)*10, "ticks are read back unchanged");
+        }
+    }
+
+}
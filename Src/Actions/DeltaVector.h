@@ -0,0 +1,76 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __DELTA_VECTOR_H__
+#define __DELTA_VECTOR_H__
+
+#include <stddef.h>
+#include <vector>
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief Compact, append-only list of integers, read back in order
+      *
+      * Actions keep one value per note they modify (tick, volume, ...) to be able to undo. Each value is
+      * stored as its difference from the previous one, in a variable amount of bytes; since notes are
+      * visited in tick order, ticks usually take 1 or 2 bytes instead of 4, and volumes 1 byte.
+      *
+      * @ingroup actions
+      */
+    class DeltaVector
+    {
+        std::vector<unsigned char> m_bytes;
+        int m_count;
+        int m_last;
+
+    public:
+
+        /** @brief reads the values of a DeltaVector, in the order they were added */
+        class Reader
+        {
+            const DeltaVector& m_vector;
+            unsigned int m_position;
+            int m_last;
+
+        public:
+            Reader(const DeltaVector& vector);
+
+            bool hasNext() const { return m_position < m_vector.m_bytes.size(); }
+
+            /** @pre hasNext() */
+            int next();
+        };
+
+        DeltaVector();
+
+        void push_back(const int value);
+
+        /** @brief release the memory reserved for growth, call once all values were added */
+        void compact();
+
+        void clear();
+
+        int size() const { return m_count; }
+
+        /** @return amount of memory used by this vector, in bytes */
+        size_t getMemoryUsage() const { return sizeof(DeltaVector) + m_bytes.capacity(); }
+    };
+
+}
+
+#endif
@@ -49,6 +49,11 @@ namespace AriaMaestosa
             void moveEvent(Action::MoveNotes* event);
             
             virtual ~Duplicate();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(Duplicate) + relocator.getMemoryUsage();
+            }
         };
     }
 }
@@ -80,6 +80,9 @@ void NoteRelocator::prepareToRelocate()
 {
     m_id                      = 0;
     m_noteamount_in_track     = m_track->getNoteAmount();
+    
+    // relocated notes are about to be modified
+    m_track->invalidateNoteIndex();
     m_noteamount_in_relocator = notes.size();
 }
 
@@ -67,6 +67,9 @@ namespace AriaMaestosa
         
         /** returns one note at a time, and NULL when all of them where given */
         Note* getNextNote(); 
+        
+        /** @return memory used to remember the notes, in bytes (the notes themselves are not owned) */
+        size_t getMemoryUsage() const { return notes.size()*sizeof(Note*); }
     };
     
     class ControlEventRelocator
@@ -88,6 +91,9 @@ namespace AriaMaestosa
         
         /** returns one note at a time, and NULL when all of them where given */
         ControllerEvent* getNextControlEvent(); 
+        
+        /** @return memory used to remember the events, in bytes (the events themselves are not owned) */
+        size_t getMemoryUsage() const { return events.size()*sizeof(ControllerEvent*); }
     };
     
     /**
@@ -126,6 +132,27 @@ namespace AriaMaestosa
             virtual ~EditAction() {}
             
             wxString getName() const { return m_name; }
+            
+            /**
+              * @return an estimate of the memory kept by this action for undo, in bytes. The undo stack
+              *         is sized by the memory its actions use, so actions that keep data for each note
+              *         they affect must override this.
+              */
+            virtual size_t getMemoryUsage() const { return sizeof(EditAction); }
+            
+        protected:
+            
+            /** @return memory used by notes owned by an action (e.g. removed notes kept for undo) */
+            static size_t getNotesMemoryUsage(const int count)
+            {
+                return count*(sizeof(Note) + sizeof(Note*));
+            }
+            
+            /** @return memory used by control events owned by an action */
+            static size_t getControlEventsMemoryUsage(const int count)
+            {
+                return count*(sizeof(ControllerEvent) + sizeof(ControllerEvent*));
+            }
         };
         
         /**
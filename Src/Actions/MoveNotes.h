@@ -68,6 +68,12 @@ namespace AriaMaestosa
             
             void doMoveOneNote(const int noteid);
             
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(MoveNotes) + relocator.getMemoryUsage() +
+                       (undo_pitch.capacity() + undo_fret.capacity() + undo_string.capacity())*sizeof(short);
+            }
+            
             virtual ~MoveNotes();
         };
     }
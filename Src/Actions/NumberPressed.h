@@ -43,6 +43,11 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~NumberPressed();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(NumberPressed) + relocator.getMemoryUsage();
+            }
         };
         
     }
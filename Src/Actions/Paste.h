@@ -46,6 +46,11 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~Paste();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(Paste) + relocator.getMemoryUsage();
+            }
         };
     }
 }
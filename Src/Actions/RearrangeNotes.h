@@ -41,6 +41,12 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~RearrangeNotes();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(RearrangeNotes) + relocator.getMemoryUsage() +
+                       (fret.capacity() + string.capacity())*sizeof(int);
+            }
         };
         
     }
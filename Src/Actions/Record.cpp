@@ -75,3 +75,12 @@ bool Record::canUndoNow()
     return not PlatformMidiManager::get()->isRecording();
 }
 
+// ----------------------------------------------------------------------------------------------------------
+
+size_t Record::getMemoryUsage() const
+{
+    size_t total = sizeof(Record);
+    for (int n=0; n<m_actions.size(); n++) total += m_actions[n].getMemoryUsage();
+    return total;
+}
+
@@ -46,6 +46,8 @@ namespace AriaMaestosa
 
             virtual bool canUndoNow();
             
+            virtual size_t getMemoryUsage() const;
+            
             virtual ~Record();
         };
         
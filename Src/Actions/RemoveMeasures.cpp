@@ -55,6 +55,22 @@ RemoveMeasures::RemovedTrackPart::~RemovedTrackPart()
 
 // ----------------------------------------------------------------------------------------------------------
 
+size_t RemoveMeasures::getMemoryUsage() const
+{
+    size_t total = sizeof(RemoveMeasures) + getControlEventsMemoryUsage(removedTempoEvents.size()) +
+                   removedTextEvents.size()*(sizeof(TextEvent) + sizeof(TextEvent*)) +
+                   timeSigChangesBackup.capacity()*sizeof(TimeSigChange);
+    
+    for (int n=0; n<removedTrackParts.size(); n++)
+    {
+        total += sizeof(RemovedTrackPart) + getNotesMemoryUsage(removedTrackParts[n].removedNotes.size()) +
+                 getControlEventsMemoryUsage(removedTrackParts[n].removedControlEvents.size());
+    }
+    return total;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
 void RemoveMeasures::undo()
 {
     Action::InsertEmptyMeasures opposite_action(m_from_measure, (m_to_measure - m_from_measure));
@@ -55,6 +55,8 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~RemoveMeasures();
+            
+            virtual size_t getMemoryUsage() const;
         };
         
         
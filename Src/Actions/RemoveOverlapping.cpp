@@ -19,11 +19,13 @@
 #include "Midi/Track.h"
 #include "Midi/Note.h"
 #include "AriaCore.h"
+#include "UnitTest.h"
 
 #include <wx/intl.h>
 #include <wx/utils.h>
 
 #include <algorithm>
+#include <climits>
 
 using namespace AriaMaestosa::Action;
 
@@ -49,54 +51,186 @@ void RemoveOverlapping::undo()
     removedNotes.clearWithoutDeleting();
 }
 
+void RemoveOverlapping::findOverlappingNotes(const ptr_vector<Note>& notes, std::vector<int>& out)
+{
+    const int noteAmount = notes.size();
+    
+    int pitchAmount = 0;
+    for (int n=0; n<noteAmount; n++)
+    {
+        pitchAmount = std::max(pitchAmount, notes[n].getPitchID() + 1);
+    }
+    
+    // Notes are sorted by start tick, so a note overlaps a later note of the same pitch if it ends
+    // after the start of the next note of that pitch that has a length. Notes without length only
+    // overlap notes without length at the same tick. First pass, backwards : find notes that overlap
+    // a later note.
+    std::vector<bool> overlapsLater(noteAmount, false);
+    std::vector<int>  nextStart(pitchAmount, INT_MAX);
+    std::vector<int>  nextEmptyStart(pitchAmount, INT_MAX);
+    for (int n=noteAmount-1; n>=0; n--)
+    {
+        const int pitch = notes[n].getPitchID();
+        const int tick  = notes[n].getTick();
+        const int end   = notes[n].getEndTick();
+        
+        if (end == tick)
+        {
+            overlapsLater[n]      = (nextEmptyStart[pitch] == tick);
+            nextEmptyStart[pitch] = tick;
+        }
+        else
+        {
+            overlapsLater[n]      = (nextStart[pitch] < end);
+            nextStart[pitch]      = tick;
+        }
+    }
+    
+    // Second pass, forwards : a note that does not overlap a later note is still removed if it overlaps
+    // an earlier note that was kept, i.e. if it starts before the end of the kept notes of its pitch
+    std::vector<int> keptEnd(pitchAmount, INT_MIN);
+    std::vector<int> keptEmptyTick(pitchAmount, INT_MIN);
+    for (int n=0; n<noteAmount; n++)
+    {
+        const int pitch = notes[n].getPitchID();
+        const int tick  = notes[n].getTick();
+        const int end   = notes[n].getEndTick();
+        const bool empty = (end == tick);
+        
+        bool remove = overlapsLater[n];
+        if (not remove)
+        {
+            remove = (empty ? keptEmptyTick[pitch] == tick : keptEnd[pitch] > tick);
+        }
+        
+        if (remove)
+        {
+            out.push_back(n);
+        }
+        else if (empty)
+        {
+            keptEmptyTick[pitch] = tick;
+        }
+        else
+        {
+            keptEnd[pitch] = std::max(keptEnd[pitch], end);
+        }
+    }
+}
+
 void RemoveOverlapping::perform()
 {
     ASSERT(m_track != NULL);
     wxBeginBusyCursor();
     
     ptr_vector<Note>& notes = m_visitor->getNotesVector();
-    const int noteAmount = notes.size();
     
-    // compare all notes to see if they match
-    for (int n1=0; n1<noteAmount; n1++)
+    std::vector<int> overlapping;
+    findOverlappingNotes(notes, overlapping);
+    
+    const int count = overlapping.size();
+    for (int n=0; n<count; n++)
     {
+        removedNotes.push_back(&notes[overlapping[n]]);
+        m_track->markNoteToBeRemoved(overlapping[n]);
+    }
+    
+    m_track->removeMarkedNotes();
+    wxEndBusyCursor();
+    
+    Display::render();
+    
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestRemoveOverlapping
+{
+    using namespace AriaMaestosa;
+    
+    /** the original implementation, comparing every note with every other note */
+    void findOverlappingNotesSlow(const ptr_vector<Note>& notes, std::vector<int>& out)
+    {
+        const int noteAmount = notes.size();
+        std::vector<bool> marked(noteAmount, false);
         
-        for (int n2=0; n2<noteAmount; n2++)
+        for (int n1=0; n1<noteAmount; n1++)
         {
-            
-            if (n1 == n2) continue; // don't compare a note with itself
-            if (notes.isMarked(n1)) continue; // skip notes already removed
-            if (notes.isMarked(n2)) continue; // skip notes already removed
-            
-            // both notes have the same pitch, they are candidates for overlapping
-            if (notes[n1].getPitchID() == notes[n2].getPitchID())
+            for (int n2=0; n2<noteAmount; n2++)
             {
-                const int from = std::min(notes[n1].getTick(), notes[n2].getTick());
-                const int to = std::max(notes[n1].getEndTick(), notes[n2].getEndTick());
-                // total length of both notes
-                const int length =  (notes[n1].getEndTick() - notes[n1].getTick()) +
-                (notes[n2].getEndTick() - notes[n2].getTick());
+                if (n1 == n2 or marked[n1] or marked[n2]) continue;
+                if (notes[n1].getPitchID() != notes[n2].getPitchID()) continue;
+                
+                const int from   = std::min(notes[n1].getTick(), notes[n2].getTick());
+                const int to     = std::max(notes[n1].getEndTick(), notes[n2].getEndTick());
+                const int length = (notes[n1].getEndTick() - notes[n1].getTick()) +
+                                   (notes[n2].getEndTick() - notes[n2].getTick());
                 
-                // if difference between beginning of first note and ending of second note is smaller than their lengths, then the notes overlap
-                // if they both begin at the same tick they also overlap
                 if ( (to - from < length) or (to - from == 0) )
                 {
-                    removedNotes.push_back(&notes[n1]);
-                    m_track->markNoteToBeRemoved(n1);
+                    marked[n1] = true;
+                    out.push_back(n1);
                 }
-                
-                
-            }// end if pitches match
+            }
+        }
+    }
+    
+    /** make notes in start tick order, on a few pitches, often overlapping, some without length */
+    void makeNotes(ptr_vector<Note>& notes, const int count, const int pitchAmount, unsigned int seed)
+    {
+        int tick = 0;
+        for (int n=0; n<count; n++)
+        {
+            seed = seed*1103515245 + 12345;
+            tick += (seed >> 16) % 3 == 0 ? 0 : (seed >> 8) % 50;
             
-        }//next n2
-        
-    }//next n1
+            seed = seed*1103515245 + 12345;
+            const int length = ((seed >> 16) % 10 == 0 ? 0 : (seed >> 8) % 200);
+            
+            seed = seed*1103515245 + 12345;
+            notes.push_back( new Note(NULL, (seed >> 16) % pitchAmount, tick, tick + length, 100) );
+        }
+    }
     
-    m_track->removeMarkedNotes();
-    wxEndBusyCursor();
+    UNIT_TEST( TestOverlappingSemantics )
+    {
+        ptr_vector<Note> notes;
+        notes.push_back( new Note(NULL, 60, 0,   100, 100) ); // 0 : overlaps note 1, removed
+        notes.push_back( new Note(NULL, 60, 50,  150, 100) ); // 1 : kept
+        notes.push_back( new Note(NULL, 62, 60,  100, 100) ); // 2 : other pitch, kept
+        notes.push_back( new Note(NULL, 60, 150, 200, 100) ); // 3 : only touches note 1, kept
+        notes.push_back( new Note(NULL, 64, 300, 300, 100) ); // 4 : same tick as note 5, removed
+        notes.push_back( new Note(NULL, 64, 300, 300, 100) ); // 5 : kept
+        notes.push_back( new Note(NULL, 66, 400, 500, 100) ); // 6 : overlaps note 8, removed
+        notes.push_back( new Note(NULL, 66, 450, 450, 100) ); // 7 : no length within note 6, kept
+        notes.push_back( new Note(NULL, 66, 480, 490, 100) ); // 8 : kept
+        
+        std::vector<int> removed;
+        Action::RemoveOverlapping::findOverlappingNotes(notes, removed);
+        
+        require_e((int)removed.size(), ==, 3, "the right amount of notes is removed");
+        require_e(removed[0], ==, 0, "of overlapping notes, the last is kept");
+        require_e(removed[1], ==, 4, "notes without length at the same tick overlap");
+        require_e(removed[2], ==, 6, "a note overlapping a later one is removed");
+        
+        std::vector<int> expected;
+        findOverlappingNotesSlow(notes, expected);
+        require(removed == expected, "results are the same as with the original implementation");
+    }
     
-    Display::render();
+    UNIT_TEST( TestSameAsOriginal )
+    {
+        for (int seed=1; seed<=20; seed++)
+        {
+            ptr_vector<Note> notes;
+            makeNotes(notes, 1500, 1 + seed % 5, seed);
+            
+            std::vector<int> removed, expected;
+            Action::RemoveOverlapping::findOverlappingNotes(notes, removed);
+            findOverlappingNotesSlow(notes, expected);
+            require(removed == expected, "results are the same as with the original implementation");
+        }
+    }
     
 }
-
-
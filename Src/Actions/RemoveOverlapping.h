@@ -20,6 +20,8 @@
 #include "Actions/EditAction.h"
 #include "ptr_vector.h"
 
+#include <vector>
+
 namespace AriaMaestosa
 {
     class Track;
@@ -41,6 +43,23 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~RemoveOverlapping();
+            
+            /**
+              * @brief find the notes this action removes
+              *
+              * A note is removed when it overlaps (shares some time with, or starts and ends at the same
+              * tick as) a later note of the same pitch, or an earlier note of the same pitch that is kept.
+              * In other words, of notes overlapping each other the last one is kept.
+              *
+              * @param notes    notes of a track, sorted by start tick
+              * @param[out] out receives the IDs of the notes to remove, in increasing order
+              */
+            static void findOverlappingNotes(const ptr_vector<Note>& notes, std::vector<int>& out);
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(RemoveOverlapping) + getNotesMemoryUsage(removedNotes.size());
+            }
         };
         
     }
@@ -41,6 +41,11 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~ResizeNotes();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(ResizeNotes) + relocator.getMemoryUsage();
+            }
         };
         
     }
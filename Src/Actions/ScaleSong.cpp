@@ -50,6 +50,13 @@ void ScaleSong::perform()
     }
 }
 
+size_t ScaleSong::getMemoryUsage() const
+{
+    size_t total = sizeof(ScaleSong);
+    for (int a=0; a<actions.size(); a++) total += actions[a].getMemoryUsage();
+    return total;
+}
+
 void ScaleSong::undo()
 {
     const int amount = actions.size();
@@ -43,6 +43,8 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~ScaleSong();
+            
+            virtual size_t getMemoryUsage() const;
         };
         
     }
@@ -17,7 +17,11 @@
 #include "Actions/ScaleTrack.h"
 #include "Actions/EditAction.h"
 #include "Midi/MeasureData.h"
+#include "Midi/Sequence.h"
 #include "Midi/Track.h"
+#include "AriaCore.h"
+#include "UnitTest.h"
+#include "UnitTestUtils.h"
 
 #include <wx/intl.h>
 
@@ -47,12 +51,13 @@ void ScaleTrack::undo()
     Note* current_note;
     relocator.setParent(m_track);
     relocator.prepareToRelocate();
-    int n=0;
+    DeltaVector::Reader start(m_note_start);
+    DeltaVector::Reader length(m_note_length);
     while ((current_note = relocator.getNextNote()) and current_note != NULL)
     {
-        current_note->setTick( m_note_start[n] );
-        current_note->setEndTick( m_note_end[n] );
-        n++;
+        const int tick = start.next();
+        current_note->setTick( tick );
+        current_note->setEndTick( tick + length.next() );
     }
     m_track->reorderNoteVector();
     m_track->reorderNoteOffVector();
@@ -78,7 +83,7 @@ void ScaleTrack::perform()
         const int endTick   = notes[n].getEndTick();
         
         m_note_start.push_back( startTick );
-        m_note_end.push_back( endTick );
+        m_note_length.push_back( endTick - startTick );
         
         notes[n].setTick   ( (int)( (startTick - m_relative_to)*m_factor + m_relative_to ) );
         notes[n].setEndTick( (int)( (endTick   - m_relative_to)*m_factor + m_relative_to ) );
@@ -87,6 +92,8 @@ void ScaleTrack::perform()
         if (notes[n].getEndTick() > last_tick) last_tick = notes[n].getEndTick();
         
     }//next
+    m_note_start.compact();
+    m_note_length.compact();
     
     MeasureData* md = m_track->getSequence()->getMeasureData();
     if (last_tick > md->getTotalTickAmount())
@@ -101,3 +108,88 @@ void ScaleTrack::perform()
 
 // ----------------------------------------------------------------------------------------------------------
 
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestScaleTrack
+{
+    using namespace AriaMaestosa;
+    
+    UNIT_TEST( TestUndoMemoryBudget )
+    {
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        TestSequenceProvider provider(seq);
+        AriaMaestosa::setCurrentSequenceProvider(&provider);
+        
+        const int NOTE_COUNT = 1000;
+        Track* t = new Track(seq);
+        {
+            OwnerPtr<Sequence::Import> import(seq->startImport());
+            for (int n=0; n<NOTE_COUNT; n++)
+            {
+                t->addNote_import(60 + n % 12 /* pitch */, n*240 /* start */, n*240 + 200 /* end */,
+                                  100 /* volume */, -1);
+            }
+        }
+        seq->addTrack(t);
+        
+        t->action(new ScaleTrack(2.0f, 0, false));
+        const size_t actionMemory = seq->getUndoStackMemoryUsage();
+        require_e(actionMemory, <, NOTE_COUNT*(sizeof(Note*) + 2*sizeof(int)), "undo data is packed");
+        
+        // scale back and forth, the undo stack may only keep about 20 of these actions
+        seq->setUndoMemoryBudget(actionMemory*20);
+        const int ACTION_COUNT = 51;
+        for (int n=1; n<ACTION_COUNT; n++)
+        {
+            t->action(new ScaleTrack(n % 2 == 1 ? 0.5f : 2.0f, 0, false));
+        }
+        
+        const int levels = seq->getUndoLevelCount();
+        require_e(levels, <, ACTION_COUNT,   "old actions were dropped");
+        require_e(levels, >=, MIN_UNDO_LEVELS, "recent actions are kept");
+        require_e(seq->getUndoStackMemoryUsage(), <=, seq->getUndoMemoryBudget(), "undo stack fits in budget");
+        
+        // undo all that is left; we get back to the song as it was after the actions that were dropped
+        for (int n=0; n<levels; n++) seq->undo();
+        require_e(seq->getUndoLevelCount(), ==, 0, "everything was undone");
+        
+        const int factor = ((ACTION_COUNT - levels) % 2 == 1 ? 2 : 1);
+        for (int n=0; n<NOTE_COUNT; n++)
+        {
+            require_e(t->getNoteStartInMidiTicks(n), ==, n*240*factor,         "note start was restored");
+            require_e(t->getNoteEndInMidiTicks(n),   ==, (n*240 + 200)*factor, "note end was restored");
+        }
+        
+        delete seq;
+    }
+    
+    UNIT_TEST( TestUndoLevelCap )
+    {
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        TestSequenceProvider provider(seq);
+        AriaMaestosa::setCurrentSequenceProvider(&provider);
+        
+        Track* t = new Track(seq);
+        {
+            OwnerPtr<Sequence::Import> import(seq->startImport());
+            for (int n=0; n<10; n++)
+            {
+                t->addNote_import(60 + n /* pitch */, n*240 /* start */, n*240 + 200 /* end */,
+                                  100 /* volume */, -1);
+            }
+        }
+        seq->addTrack(t);
+        
+        // the memory budget is never reached, but the amount of undo levels is still bounded
+        for (int n=0; n<MAX_UNDO_LEVELS + 10; n++)
+        {
+            t->action(new ScaleTrack(n % 2 == 0 ? 2.0f : 0.5f, 0, false));
+        }
+        require_e(seq->getUndoStackMemoryUsage(), <, seq->getUndoMemoryBudget(), "budget was not reached");
+        require_e(seq->getUndoLevelCount(), ==, MAX_UNDO_LEVELS, "oldest levels were dropped");
+        
+        delete seq;
+    }
+    
+}
@@ -17,6 +17,7 @@
 #ifndef _rmscale_
 #define _rmscale_
 
+#include "Actions/DeltaVector.h"
 #include "Actions/EditAction.h"
 
 namespace AriaMaestosa
@@ -37,8 +38,10 @@ namespace AriaMaestosa
             bool  m_selection_only;
             
             NoteRelocator relocator;
-            std::vector<int> m_note_start;
-            std::vector<int> m_note_end;
+            
+            /** original start and length of each note, for undo */
+            DeltaVector m_note_start;
+            DeltaVector m_note_length;
             
         public:
             
@@ -46,6 +49,12 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~ScaleTrack();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(ScaleTrack) + relocator.getMemoryUsage() + m_note_start.getMemoryUsage() +
+                       m_note_length.getMemoryUsage();
+            }
         };
         
     }
@@ -41,6 +41,11 @@ namespace AriaMaestosa
 
             void perform();
             void undo();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(ScrollNotesIntoView) + m_positions.capacity()*sizeof(float);
+            }
         };
         
     }
@@ -44,6 +44,12 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~SetAccidentalSign();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(SetAccidentalSign) + relocator.getMemoryUsage() +
+                       (m_original_signs.capacity() + m_pitch.capacity())*sizeof(int);
+            }
         };
     }
 }
@@ -40,11 +40,10 @@ void SetNoteVolume::undo()
     Note* current_note;
     relocator.setParent(m_track);
     relocator.prepareToRelocate();
-    int n = 0;
+    DeltaVector::Reader volumes(m_volumes);
     while ((current_note = relocator.getNextNote()) and current_note != NULL)
     {
-        current_note->setVolume( m_volumes[n] );
-        n++;
+        current_note->setVolume( volumes.next() );
     }
 }
 
@@ -76,6 +75,7 @@ void SetNoteVolume::perform()
                 }
             }
         }//next note
+        m_volumes.compact();
         
     }
     else
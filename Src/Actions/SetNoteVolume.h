@@ -17,6 +17,7 @@
 #ifndef _setnotevolume_
 #define _setnotevolume_
 
+#include "Actions/DeltaVector.h"
 #include "Actions/EditAction.h"
 #include <vector>
 
@@ -39,7 +40,7 @@ namespace AriaMaestosa
             int m_old_volume;
             
             NoteRelocator relocator;
-            std::vector<int> m_volumes;
+            DeltaVector m_volumes;
             
             void adjustVolume(int& volume);
             
@@ -53,6 +54,11 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~SetNoteVolume();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(SetNoteVolume) + relocator.getMemoryUsage() + m_volumes.getMemoryUsage();
+            }
         };
         
     }
@@ -44,6 +44,11 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~ShiftBySemiTone();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(ShiftBySemiTone) + m_relocator.getMemoryUsage();
+            }
         };
         
         
@@ -47,6 +47,12 @@ namespace AriaMaestosa
 
             void perform();
             void undo();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(ShiftFrets) + relocator.getMemoryUsage() +
+                       (m_frets.capacity() + m_strings.capacity())*sizeof(int);
+            }
         };
         
         
@@ -47,6 +47,12 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~ShiftString();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(ShiftString) + m_relocator.getMemoryUsage() +
+                       (m_frets.capacity() + m_strings.capacity())*sizeof(int);
+            }
         };
     }
 }
@@ -38,12 +38,13 @@ void SnapNotesToGrid::undo()
     Note* current_note;
     relocator.setParent(m_track);
     relocator.prepareToRelocate();
-    int n = 0;
+    DeltaVector::Reader start(note_start);
+    DeltaVector::Reader length(note_length);
     while ((current_note = relocator.getNextNote()) and current_note != NULL)
     {
-        current_note->setTick( note_start[n] );
-        current_note->setEndTick( note_end[n] );
-        n++;
+        const int tick = start.next();
+        current_note->setTick( tick );
+        current_note->setEndTick( tick + length.next() );
     }
     m_track->reorderNoteVector();
     m_track->reorderNoteOffVector();
@@ -64,7 +65,7 @@ void SnapNotesToGrid::perform()
         if (not note->isSelected()) continue;
         
         note_start.push_back( note->getTick() );
-        note_end.push_back( note->getEndTick() );
+        note_length.push_back( note->getEndTick() - note->getTick() );
         
         int len = note->getEndTick() - note->getTick();
         note->setTick( m_track->snapMidiTickToGrid( note->getTick(), true ) );
@@ -80,6 +81,8 @@ void SnapNotesToGrid::perform()
         note->setEndTick( end_tick );
         relocator.rememberNote(notes[n]);
     }
+    note_start.compact();
+    note_length.compact();
     
     
     m_track->reorderNoteVector();
@@ -17,6 +17,7 @@
 #ifndef _snptogrid_
 #define _snptogrid_
 
+#include "Actions/DeltaVector.h"
 #include "Actions/EditAction.h"
 
 namespace AriaMaestosa
@@ -34,8 +35,10 @@ namespace AriaMaestosa
             friend class AriaMaestosa::Track;
             
             NoteRelocator relocator;
-            std::vector<int> note_start;
-            std::vector<int> note_end;
+            
+            /** original start and length of each note, for undo */
+            DeltaVector note_start;
+            DeltaVector note_length;
             
         public:
             
@@ -43,6 +46,12 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~SnapNotesToGrid();
+            
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(SnapNotesToGrid) + relocator.getMemoryUsage() + note_start.getMemoryUsage() +
+                       note_length.getMemoryUsage();
+            }
         };
         
     }
@@ -46,6 +46,12 @@ namespace AriaMaestosa
             void perform();
             void undo();
             virtual ~UpdateGuitarTuning();
+
+            virtual size_t getMemoryUsage() const
+            {
+                return sizeof(UpdateGuitarTuning) + relocator.getMemoryUsage() +
+                       (frets.capacity() + strings.capacity() + previous_tuning.capacity())*sizeof(int);
+            }
         };
         
         
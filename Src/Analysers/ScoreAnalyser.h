@@ -287,6 +287,8 @@ namespace AriaMaestosa
         /** @brief set the level below which the stem is up, and above which it is down */
         void setStemPivot(const int level);
         
+        int getStemPivot() const { return m_stem_pivot; }
+        
         /**
          * @brief Puts notes in time order.
          * Notes that have no stems go last so that they don't disturb note grouping in chords.
@@ -0,0 +1,174 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Analysers/ScoreAnalysisCache.h"
+#include "Midi/MeasureData.h"
+
+#include <algorithm>
+
+using namespace AriaMaestosa;
+
+// -----------------------------------------------------------------------------------------------------------
+
+ScoreAnalysisCache::ScoreAnalysisCache()
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------
+
+bool ScoreAnalysisCache::sameInput(const std::vector<NoteRenderInfo>& a, const std::vector<NoteRenderInfo>& b)
+{
+    if (a.size() != b.size()) return false;
+
+    const int count = a.size();
+    for (int n=0; n<count; n++)
+    {
+        if (a[n].getTick()        != b[n].getTick()        or
+            a[n].getTickLength()  != b[n].getTickLength()  or
+            a[n].getLevel()       != b[n].getLevel()       or
+            a[n].m_sign           != b[n].m_sign           or
+            a[n].m_selected       != b[n].m_selected       or
+            a[n].m_pitch          != b[n].m_pitch          or
+            a[n].m_measure_begin  != b[n].m_measure_begin  or
+            a[n].m_measure_end    != b[n].m_measure_end)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------
+
+void ScoreAnalysisCache::beginRender()
+{
+    const int count = m_used_measures.size();
+    for (int n=0; n<count; n++)
+    {
+        m_measures[ m_used_measures[n] ].m_input.clear();
+    }
+    m_used_measures.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------
+
+void ScoreAnalysisCache::addNote(const NoteRenderInfo& renderInfo)
+{
+    ASSERT_E(renderInfo.m_measure_begin, >=, 0);
+
+    // a note lasting over many measures is given to each of them, each keeps its own part after splitting
+    const int last_measure = std::max(renderInfo.m_measure_begin, renderInfo.m_measure_end);
+    if (last_measure >= (int)m_measures.size()) m_measures.resize(last_measure + 1);
+
+    for (int measure=renderInfo.m_measure_begin; measure<=last_measure; measure++)
+    {
+        MeasureEntry& entry = m_measures[measure];
+        if (entry.m_input.empty()) m_used_measures.push_back(measure);
+        entry.m_input.push_back(renderInfo);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------
+
+void ScoreAnalysisCache::rebuild(const int measure, MeasureEntry& entry, ScoreAnalyser* analyser,
+                                 const MeasureData* md)
+{
+    analyser->clearAndPrepare();
+
+    const int count = entry.m_input.size();
+    for (int n=0; n<count; n++)
+    {
+        NoteRenderInfo renderInfo = entry.m_input[n];
+        analyser->addToVector(renderInfo);
+    }
+
+    // notes lasting over many measures were split at measure bars, only keep the parts in this measure
+    std::vector<NoteRenderInfo>& notes = analyser->m_note_render_info;
+    int kept = 0;
+    for (unsigned int n=0; n<notes.size(); n++)
+    {
+        if (notes[n].m_measure_begin == measure) notes[kept++] = notes[n];
+    }
+    notes.erase(notes.begin() + kept, notes.end());
+
+    analyser->doneAdding();
+    entry.m_notes.assign(notes.begin(), notes.end());
+
+    analyser->analyseNoteInfo();
+    entry.m_analysed.assign(notes.begin(), notes.end());
+
+    entry.m_cached_input = entry.m_input;
+    entry.m_first_tick   = md->firstTickInMeasure(measure);
+    entry.m_last_tick    = md->lastTickInMeasure(measure);
+    entry.m_num          = md->getTimeSigNumerator(measure);
+    entry.m_denom        = md->getTimeSigDenominator(measure);
+    entry.m_stem_pivot   = analyser->getStemPivot();
+    entry.m_valid        = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------
+
+void ScoreAnalysisCache::update(ScoreAnalyser* analyser, const MeasureData* md)
+{
+    std::sort(m_used_measures.begin(), m_used_measures.end());
+
+    const int count = m_used_measures.size();
+    for (int n=0; n<count; n++)
+    {
+        const int measure = m_used_measures[n];
+        MeasureEntry& entry = m_measures[measure];
+
+        if (not entry.m_valid                                              or
+            entry.m_first_tick != md->firstTickInMeasure(measure)          or
+            entry.m_last_tick  != md->lastTickInMeasure(measure)           or
+            entry.m_num        != md->getTimeSigNumerator(measure)         or
+            entry.m_denom      != md->getTimeSigDenominator(measure)       or
+            entry.m_stem_pivot != analyser->getStemPivot()                 or
+            not sameInput(entry.m_input, entry.m_cached_input))
+        {
+            rebuild(measure, entry, analyser, md);
+        }
+    }
+
+    analyser->clearAndPrepare();
+    for (int n=0; n<count; n++)
+    {
+        const std::vector<NoteRenderInfo>& notes = m_measures[ m_used_measures[n] ].m_notes;
+        analyser->m_note_render_info.insert(analyser->m_note_render_info.end(), notes.begin(), notes.end());
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------
+
+void ScoreAnalysisCache::fillAnalysed(ScoreAnalyser* analyser) const
+{
+    analyser->clearAndPrepare();
+
+    const int count = m_used_measures.size();
+    for (int n=0; n<count; n++)
+    {
+        const std::vector<NoteRenderInfo>& notes = m_measures[ m_used_measures[n] ].m_analysed;
+        analyser->m_note_render_info.insert(analyser->m_note_render_info.end(), notes.begin(), notes.end());
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------
+
+void ScoreAnalysisCache::clear()
+{
+    m_measures.clear();
+    m_used_measures.clear();
+}
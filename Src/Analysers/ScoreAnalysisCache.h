@@ -0,0 +1,109 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __SCORE_ANALYSIS_CACHE_H__
+#define __SCORE_ANALYSIS_CACHE_H__
+
+#include "Analysers/ScoreAnalyser.h"
+
+#include <vector>
+
+namespace AriaMaestosa
+{
+    class MeasureData;
+
+    /**
+      * @brief Keeps the results of ScoreAnalyser, measure by measure, from one render to the next
+      *
+      * Score analysis (splitting notes, chords, triplets, beams) never crosses a measure bar, so it can be
+      * done one measure at a time. Each render, the editor gives this cache the NoteRenderInfo objects of
+      * the visible notes, already bearing their level and accidental; a measure is analysed again only if
+      * these notes, or the measure itself (bounds, time signature, stem pivot), differ from those its
+      * cached results were computed from. Thus an edit, a key change or a time sig change only invalidates
+      * the measures it actually changes, and scrolling costs nothing but drawing.
+      *
+      * There is one cache per track and per clef.
+      *
+      * @ingroup analysers
+      */
+    class ScoreAnalysisCache
+    {
+        struct MeasureEntry
+        {
+            /** notes of this measure given during the current render */
+            std::vector<NoteRenderInfo> m_input;
+
+            /** notes and context the cached results below were computed from */
+            std::vector<NoteRenderInfo> m_cached_input;
+            int  m_first_tick, m_last_tick, m_num, m_denom, m_stem_pivot;
+            bool m_valid;
+
+            /** notes of this measure, split as needed, before analysis (used for note heads and silences) */
+            std::vector<NoteRenderInfo> m_notes;
+
+            /** notes of this measure, after analysis */
+            std::vector<NoteRenderInfo> m_analysed;
+
+            MeasureEntry()
+            {
+                m_first_tick = m_last_tick = m_num = m_denom = m_stem_pivot = -1;
+                m_valid = false;
+            }
+        };
+
+        std::vector<MeasureEntry> m_measures;
+
+        /** measures that received notes during the current render */
+        std::vector<int> m_used_measures;
+
+        static bool sameInput(const std::vector<NoteRenderInfo>& a, const std::vector<NoteRenderInfo>& b);
+
+        void rebuild(const int measure, MeasureEntry& entry, ScoreAnalyser* analyser, const MeasureData* md);
+
+    public:
+        LEAK_CHECK();
+
+        ScoreAnalysisCache();
+
+        /** @brief call before giving the notes of a new render with 'addNote' */
+        void beginRender();
+
+        /**
+          * @brief give a visible note, in time order, with its level and sign set but before it is
+          *        split or analysed
+          */
+        void addNote(const NoteRenderInfo& renderInfo);
+
+        /**
+          * @brief analyse again the measures whose notes changed since the last render, then fill the
+          *        analyser with the notes of this render, ready for the first rendering pass
+          *        (the same state 'ScoreAnalyser::doneAdding' leaves it in)
+          */
+        void update(ScoreAnalyser* analyser, const MeasureData* md);
+
+        /**
+          * @brief fill the analyser with the analysed notes of this render, ready for the second rendering
+          *        pass (the same state 'ScoreAnalyser::analyseNoteInfo' leaves it in)
+          */
+        void fillAnalysed(ScoreAnalyser* analyser) const;
+
+        /** @brief drop all cached results */
+        void clear();
+    };
+
+}
+
+#endif
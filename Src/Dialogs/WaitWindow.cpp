@@ -152,6 +152,8 @@ namespace AriaMaestosa
         
         void setProgress(int progress)
         {
+            // work done without a window (e.g. printing from the command line) reports progress too
+            if (waitWindow == NULL) return;
             waitWindow->setProgress( progress );
         }
         
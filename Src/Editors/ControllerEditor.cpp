@@ -294,12 +294,11 @@ void ControllerEditor::renderEvents()
 
     const int currentController = m_controller_choice->getControllerID();
 
-    const int eventAmount = m_track->getControllerEventAmount(currentController == PSEUDO_CONTROLLER_LYRICS,
-                                                              Track::isTempoController(currentController) );
+    const bool isTextController = (currentController == PSEUDO_CONTROLLER_LYRICS or
+                                   currentController == PSEUDO_CONTROLLER_INSTRUMENT_CHANGE or
+                                   currentController == 0 /* bank select */);
     
-    if (currentController == PSEUDO_CONTROLLER_LYRICS or
-        currentController == PSEUDO_CONTROLLER_INSTRUMENT_CHANGE or
-        currentController == 0 /* bank select */)
+    if (isTextController)
     {
         AriaRender::images();
     }
@@ -307,8 +306,33 @@ void ControllerEditor::renderEvents()
     const int x_scroll = m_gsequence->getXScrollInPixels();
     int eventsOfThisType = 0;
     
-    for (int n=0; n<eventAmount; n++)
-    {        
+    // tempo and lyrics are stored in the sequence; for all others, only visit the events of this controller
+    const bool isTrackController = (currentController != PSEUDO_CONTROLLER_LYRICS and
+                                    not Track::isTempoController(currentController));
+    const std::vector<int>* ids = NULL;
+    int eventAmount;
+    int firstEvent = 0;
+    if (isTrackController)
+    {
+        ids         = &m_track->getControllerEventIDs(currentController);
+        eventAmount = ids->size();
+        
+        if (not isTextController)
+        {
+            // start with the last event before the visible area, its value is drawn up to the next event
+            const int firstVisibleTick = RelativeXCoord(Editor::getEditorXStart(), WINDOW, m_gsequence).getRelativeTo(MIDI);
+            firstEvent = std::max(0, m_track->findFirstControllerEventFrom(currentController, firstVisibleTick) - 1);
+        }
+    }
+    else
+    {
+        eventAmount = m_track->getControllerEventAmount(currentController == PSEUDO_CONTROLLER_LYRICS,
+                                                        Track::isTempoController(currentController) );
+    }
+    
+    for (int i=firstEvent; i<eventAmount; i++)
+    {
+        const int n = (ids == NULL ? i : (*ids)[i]);
         tmp = m_track->getControllerEvent(n, currentController);
         if (tmp->getController() != currentController) continue; // only draw events of this controller
         eventsOfThisType++;
@@ -953,13 +977,12 @@ void ControllerEditor::rightClick(RelativeXCoord x, const int y)
         {
             const int instruments_y = (area_from_y + area_to_y + area_to_y)/3;
             
-            const int eventAmount = m_track->getControllerEventAmount();
+            const std::vector<int>& ids = m_track->getControllerEventIDs(PSEUDO_CONTROLLER_INSTRUMENT_CHANGE);
+            const int eventAmount = ids.size();
             ControllerEvent* eventToDelete = NULL;
             for (int n=0; n<eventAmount; n++)
             {     
-                ControllerEvent* evt = m_track->getControllerEvent(n, PSEUDO_CONTROLLER_INSTRUMENT_CHANGE);
-                
-                if (evt->getController() != PSEUDO_CONTROLLER_INSTRUMENT_CHANGE) continue;
+                ControllerEvent* evt = m_track->getControllerEvent(ids[n], PSEUDO_CONTROLLER_INSTRUMENT_CHANGE);
                 
                 const int xloc = ControllerEditor::getPositionInPixels(evt->getTick(), m_gsequence);
 
@@ -621,9 +621,14 @@ int DrumEditor::getYForDrum(const int given_drumID)
 
 NoteSearchResult DrumEditor::noteAt(RelativeXCoord x, const int y, int& noteID)
 {
-    const int noteAmount = m_track->getNoteAmount();
-    for (int n=0; n<noteAmount; n++)
+    // drums are hit on a few pixels after their start
+    std::vector<int> candidates;
+    findNotesInPixelRange(m_track, x.getRelativeTo(EDITOR) - 5, x.getRelativeTo(EDITOR) + 1, candidates);
+    
+    const int noteAmount = candidates.size();
+    for (int i=0; i<noteAmount; i++)
     {
+        const int n = candidates[i];
         const int drumx = m_graphical_track->getNoteStartInPixels(n) - m_gsequence->getXScrollInPixels();
 
         ASSERT(m_track->getNotePitchID(n)>0);
@@ -905,9 +910,13 @@ void DrumEditor::render(RelativeXCoord mousex_current, int mousey_current,
     const int mouse_y1 = std::min(mousey_current, mousey_initial);
     const int mouse_y2 = std::max(mousey_current, mousey_initial);
     
-    const int noteAmount = m_track->getNoteAmount();
-    for (int n=0; n<noteAmount; n++)
+    std::vector<int> visibleNotes;
+    findNotesInPixelRange(m_track, -Editor::getEditorXStart(), m_width - Editor::getEditorXStart(), visibleNotes);
+    
+    const int noteAmount = visibleNotes.size();
+    for (int i=0; i<noteAmount; i++)
     {
+        const int n = visibleNotes[i];
         const int drumx = m_graphical_track->getNoteStartInPixels(n) - m_gsequence->getXScrollInPixels() +
                           Editor::getEditorXStart();
 
@@ -874,6 +874,20 @@ int Editor::getLevelAtY(const int y)
     
 // ------------------------------------------------------------------------------------------------------------
 
+void Editor::findNotesInPixelRange(const Track* track, const int fromX, const int toX, std::vector<int>& out) const
+{
+    const float zoom    = m_gsequence->getZoom();
+    const int   xscroll = m_gsequence->getXScrollInPixels();
+    
+    // pad by a tick on each side so that float truncation never drops a note the pixel checks would keep
+    const int fromTick = std::max(0, (int)((fromX + xscroll) / zoom) - 1);
+    const int toTick   = (int)((toX + xscroll) / zoom) + 2;
+    
+    track->findNotesInRange(fromTick, toTick, out);
+}
+
+// ------------------------------------------------------------------------------------------------------------
+
 void Editor::makeMoveNoteEvent(const int relativeX, const int relativeY, const int noteID,
                                Action::Duplicate* duplicateParent)
 {
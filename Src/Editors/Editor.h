@@ -145,6 +145,15 @@ namespace AriaMaestosa
         void makeMoveNoteEvent(const int relativeX, const int relativeY, const int m_last_clicked_note,
                                Action::Duplicate* duplicateParent=NULL);
 
+        /**
+          * @brief Find the notes of a track that are at least partly within a horizontal pixel range
+          * @param fromX, toX  range in pixels, relative to the start of the editor area (i.e. note pixel
+          *                    position minus the current horizontal scrolling)
+          * @param[out] out    IDs of the notes, in time order. The range is slightly widened to account for
+          *                    rounding, so callers should still clip precisely in pixels.
+          */
+        void findNotesInPixelRange(const Track* track, const int fromX, const int toX, std::vector<int>& out) const;
+
         /** @brief if you use a scrollbar, call this method somewhere near the end of your render method. */
         void renderScrollbar();
         
@@ -195,7 +204,7 @@ namespace AriaMaestosa
           * @brief on track deletion, we need to check if this one is being used and remove references
           * to it if so (TODO: use weak pointers or some other automatic system instead of manual deletion?)
           */
-        void trackDeleted(Track* track);
+        virtual void trackDeleted(Track* track);
         
         /**
           * @brief  Check if the Track passed as argument a background of this
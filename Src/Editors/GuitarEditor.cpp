@@ -129,7 +129,9 @@ void GuitarEditor::render(RelativeXCoord mousex_current, int mousey_current,
     }
 
     // ---------------------- draw notes ----------------------------
-    const int noteAmount = m_track->getNoteAmount();
+    std::vector<int> visibleNotes;
+    findNotesInPixelRange(m_track, 0, m_width, visibleNotes);
+    const int noteAmount = visibleNotes.size();
     
     const bool mouseValid = (mousex_current.isValid() and mousex_initial.isValid());
     
@@ -138,8 +140,9 @@ void GuitarEditor::render(RelativeXCoord mousex_current, int mousey_current,
     const int mouse_y1 = std::min(mousey_current, mousey_initial);
     const int mouse_y2 = std::max(mousey_current, mousey_initial);
     
-    for (int n=0; n<noteAmount; n++)
+    for (int i=0; i<noteAmount; i++)
     {
+        const int n = visibleNotes[i];
         const int pscroll = m_gsequence->getXScrollInPixels();
         int x1 = m_graphical_track->getNoteStartInPixels(n) - pscroll;
         int x2 = m_graphical_track->getNoteEndInPixels(n)   - pscroll;
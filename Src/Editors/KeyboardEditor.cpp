@@ -190,9 +190,13 @@ NoteSearchResult KeyboardEditor::noteAt(RelativeXCoord x, const int y, int& note
 {
     const int x_edit = x.getRelativeTo(EDITOR);
 
-    const int noteAmount = m_track->getNoteAmount();
-    for (int n=0; n<noteAmount; n++)
+    std::vector<int> candidates;
+    findNotesInPixelRange(m_track, x_edit, x_edit + 1, candidates);
+    
+    const int candidateAmount = candidates.size();
+    for (int i=0; i<candidateAmount; i++)
     {
+        const int n  = candidates[i];
         const int x1 = m_graphical_track->getNoteStartInPixels(n) - m_gsequence->getXScrollInPixels();
         const int x2 = m_graphical_track->getNoteEndInPixels(n)   - m_gsequence->getXScrollInPixels();
         const int y1 = m_track->getNotePitchID(n)*m_y_step + getEditorYStart() - getYScrollInPixels();
@@ -229,9 +233,21 @@ void KeyboardEditor::selectNotesInRect(RelativeXCoord& mousex_current, int mouse
     const int mouse_y_max = std::max( mousey_current, mousey_initial );
     const int xscroll = m_gsequence->getXScrollInPixels();
     
+    // only notes overlapping the rectangle horizontally can be selected; all others get deselected
+    std::vector<int> candidates;
+    findNotesInPixelRange(m_track, mouse_x_min, mouse_x_max, candidates);
+    int nextCandidate = 0;
+    
     const int count = m_track->getNoteAmount();
     for (int n=0; n<count; n++)
     {
+        if (nextCandidate >= (int)candidates.size() or candidates[nextCandidate] != n)
+        {
+            m_graphical_track->selectNote(n, false);
+            continue;
+        }
+        nextCandidate++;
+        
         int x1        = m_graphical_track->getNoteStartInPixels(n);
         int x2        = m_graphical_track->getNoteEndInPixels(n);
         int from_note = m_track->getNotePitchID(n);
@@ -382,9 +398,10 @@ void KeyboardEditor::scrollNotesIntoView()
         double maxNotePitch = 0;
         
         // Computes average pitch in track
+        const NoteColumns& columns = m_track->getNoteColumns();
         for (int j=0 ; j<noteCount ; j++)
         {
-            maxNotePitch += m_track->getNotePitchID(j);
+            maxNotePitch += columns.getPitchID(j);
         }
         int averageNotePitch = (int)(maxNotePitch / (double)noteCount);
         
@@ -488,13 +505,16 @@ void KeyboardEditor::render(RelativeXCoord mousex_current, int mousey_current,
             Track* otherTrack = m_background_tracks.get(bgtrack);
             GraphicalTrack* otherGTrack = m_gsequence->getGraphicsFor(otherTrack);
             ASSERT(otherGTrack != NULL);
-            const int noteAmount = otherTrack->getNoteAmount();
+            std::vector<int> visibleNotes;
+            findNotesInPixelRange(otherTrack, 0, m_width, visibleNotes);
+            const int noteAmount = visibleNotes.size();
             
             ariaColor = pickColor(colorIndex);
         
             // render the notes
-            for (int n=0; n<noteAmount; n++)
+            for (int i=0; i<noteAmount; i++)
             {
+                const int n = visibleNotes[i];
                 int x,y;
                 int x1 = otherGTrack->getNoteStartInPixels(n) - m_gsequence->getXScrollInPixels();
                 int x2 = otherGTrack->getNoteEndInPixels(n)   - m_gsequence->getXScrollInPixels();
@@ -534,9 +554,13 @@ void KeyboardEditor::render(RelativeXCoord mousex_current, int mousey_current,
     const int mouse_y_min = std::min(mousey_current, mousey_initial);
     const int mouse_y_max = std::max(mousey_current, mousey_initial);
 
-    const int noteAmount = m_track->getNoteAmount();
-    for (int n=0; n<noteAmount; n++)
+    std::vector<int> visibleNotes;
+    findNotesInPixelRange(m_track, 0, m_width, visibleNotes);
+    
+    const int noteAmount = visibleNotes.size();
+    for (int i=0; i<noteAmount; i++)
     {
+        const int n = visibleNotes[i];
         int x;
         const int x1 = m_graphical_track->getNoteStartInPixels(n) - pscroll;
         const int x2 = m_graphical_track->getNoteEndInPixels(n)   - pscroll;
@@ -18,6 +18,7 @@
 #include "Actions/AddNote.h"
 #include "Actions/ShiftBySemiTone.h"
 #include "Analysers/ScoreAnalyser.h"
+#include "Analysers/ScoreAnalysisCache.h"
 #include "Editors/ScoreEditor.h"
 #include "Editors/RelativeXCoord.h"
 #include "GUI/ImageProvider.h"
@@ -431,6 +432,22 @@ ScoreEditor::ScoreEditor(GraphicalTrack* track) : Editor(track)
 
 ScoreEditor::~ScoreEditor()
 {
+    std::map<const Track*, ScoreAnalysisCache*>::iterator it;
+    for (it = m_g_clef_caches.begin(); it != m_g_clef_caches.end(); it++) delete it->second;
+    for (it = m_f_clef_caches.begin(); it != m_f_clef_caches.end(); it++) delete it->second;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+ScoreAnalysisCache* ScoreEditor::getAnalysisCache(std::map<const Track*, ScoreAnalysisCache*>& caches,
+                                                  const Track* track)
+{
+    std::map<const Track*, ScoreAnalysisCache*>::iterator it = caches.find(track);
+    if (it != caches.end()) return it->second;
+    
+    ScoreAnalysisCache* cache = new ScoreAnalysisCache();
+    caches[track] = cache;
+    return cache;
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -453,6 +470,28 @@ const Note7 flat_order[]  = { NOTE_7_B, NOTE_7_E, NOTE_7_A, NOTE_7_D, NOTE_7_G,
 
 // ----------------------------------------------------------------------------------------------------------
 
+void ScoreEditor::trackDeleted(Track* track)
+{
+    Editor::trackDeleted(track);
+    
+    // the address of a deleted track may be reused by a new track, which must not get this cache
+    std::map<const Track*, ScoreAnalysisCache*>::iterator it = m_g_clef_caches.find(track);
+    if (it != m_g_clef_caches.end())
+    {
+        delete it->second;
+        m_g_clef_caches.erase(it);
+    }
+    
+    it = m_f_clef_caches.find(track);
+    if (it != m_f_clef_caches.end())
+    {
+        delete it->second;
+        m_f_clef_caches.erase(it);
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
 void ScoreEditor::onKeyChange(const int symbol_amount, const KeyType type)
 {
     // reset key signature before beginning
@@ -1238,19 +1277,29 @@ void ScoreEditor::render(RelativeXCoord mousex_current, int mousey_current,
 void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool focus, 
                 bool enableSelection, bool renderSilences, const AriaColor& baseColor)
 {
-    const int noteAmount = track->getNoteAmount();
+    std::vector<int> visibleNotes;
+    findNotesInPixelRange(track, ctx.first_x_to_consider - Editor::getEditorXStart(),
+                          ctx.last_x_to_consider - Editor::getEditorXStart(), visibleNotes);
+    
+    const int noteAmount = visibleNotes.size();
     int previous_tick = -1;
     
     GraphicalTrack* otherGTrack = m_gsequence->getGraphicsFor(track);
     ASSERT(otherGTrack != NULL);
     
-    m_g_clef_analyser->clearAndPrepare();
-    m_f_clef_analyser->clearAndPrepare();
+    // notes are analysed measure by measure, and only measures whose notes changed since the last
+    // render are analysed again
+    MeasureData* md = m_sequence->getMeasureData();
+    ScoreAnalysisCache* g_clef_cache = getAnalysisCache(m_g_clef_caches, track);
+    ScoreAnalysisCache* f_clef_cache = getAnalysisCache(m_f_clef_caches, track);
+    g_clef_cache->beginRender();
+    f_clef_cache->beginRender();
     
     // render pass 1. draw linear notation if relevant, gather information and do initial rendering for
     // musical notation
-    for (int n=0; n<noteAmount; n++)
+    for (int i=0; i<noteAmount; i++)
     {
+        const int n = visibleNotes[i];
         PitchSign note_sign;
         const int noteLevel = m_converter->noteToLevel(track->getNote(n), &note_sign);
 
@@ -1341,8 +1390,6 @@ void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool
 
         if (m_musical_notation_enabled)
         {
-            MeasureData* md = m_sequence->getMeasureData();
-            
             // build visible notes vector with initial info in it
             NoteRenderInfo currentNote = NoteRenderInfo::factory(tick, noteLevel, noteLength, note_sign,
                                                                  enableSelection and track->isNoteSelected(n),
@@ -1351,22 +1398,22 @@ void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool
             // add note to either G clef score or F clef score
             if (m_g_clef and not m_f_clef)
             {
-                m_g_clef_analyser->addToVector(currentNote);
+                g_clef_cache->addNote(currentNote);
             }
             else if (m_f_clef and not m_g_clef)
             {
-                m_f_clef_analyser->addToVector(currentNote);
+                f_clef_cache->addNote(currentNote);
             }
             else if (m_f_clef and m_g_clef)
             {
                 const int middleC = m_converter->getScoreCenterCLevel();
                 if (noteLevel < middleC)
                 {
-                    m_g_clef_analyser->addToVector(currentNote);
+                    g_clef_cache->addNote(currentNote);
                 }
                 else if (noteLevel > middleC)
                 {
-                    m_f_clef_analyser->addToVector(currentNote);
+                    f_clef_cache->addNote(currentNote);
                 }
                 else
                 {
@@ -1381,12 +1428,12 @@ void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool
                     {
                         const int checkNoteLevel = m_converter->noteToLevel( track->getNote(check_note), (PitchSign*)NULL );
                         
-                        if (checkNoteLevel > middleC)  m_f_clef_analyser->addToVector(currentNote);
-                        else                           m_g_clef_analyser->addToVector(currentNote);
+                        if (checkNoteLevel > middleC)  f_clef_cache->addNote(currentNote);
+                        else                           g_clef_cache->addNote(currentNote);
                     }
                     else
                     {
-                        m_g_clef_analyser->addToVector(currentNote);
+                        g_clef_cache->addNote(currentNote);
                     }
                     
                 } // end if note on middle C
@@ -1397,11 +1444,11 @@ void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool
     
     if (m_g_clef)
     {
-        m_g_clef_analyser->doneAdding();
+        g_clef_cache->update(m_g_clef_analyser, md);
     }
     if (m_f_clef)
     {
-        m_f_clef_analyser->doneAdding();
+        f_clef_cache->update(m_f_clef_analyser, md);
     }
     
     // render musical notation if enabled
@@ -1412,7 +1459,7 @@ void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool
             const int silences_y = getEditorYStart() +
                                    Y_STEP_HEIGHT*(m_converter->getScoreCenterCLevel()-8) -
                                    getYScrollInPixels() + 1;
-            renderScore(m_g_clef_analyser, silences_y, renderSilences, baseColor);
+            renderScore(m_g_clef_analyser, g_clef_cache, silences_y, renderSilences, baseColor);
         }
 
         if (m_f_clef)
@@ -1420,7 +1467,7 @@ void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool
             const int silences_y = getEditorYStart() +
                                    Y_STEP_HEIGHT*(m_converter->getScoreCenterCLevel()+4) -
                                   getYScrollInPixels() + 1;
-            renderScore(m_f_clef_analyser, silences_y, renderSilences, baseColor);
+            renderScore(m_f_clef_analyser, f_clef_cache, silences_y, renderSilences, baseColor);
         }
     }
 }
@@ -1428,7 +1475,7 @@ void ScoreEditor::renderTrack(Track* track, const TrackRenderContext& ctx, bool
 
 // ----------------------------------------------------------------------------------------------------------
 
-void ScoreEditor::renderScore(ScoreAnalyser* analyser, const int silences_y, 
+void ScoreEditor::renderScore(ScoreAnalyser* analyser, const ScoreAnalysisCache* cache, const int silences_y,
             bool renderSilences, const AriaColor& baseColor)
 {
     int visibleNoteAmount = analyser->getNoteCount();
@@ -1453,8 +1500,8 @@ void ScoreEditor::renderScore(ScoreAnalyser* analyser, const int silences_y,
 
     // ------------------------- second note rendering pass -------------------
 
-    // analyse notes to know how to build the score
-    analyser->analyseNoteInfo();
+    // analysed notes (how to build the score), analysis was done or reused by the cache in 'renderTrack'
+    cache->fillAnalysed(analyser);
 
     // triplet signs, tied notes, flags and beams
     visibleNoteAmount = analyser->m_note_render_info.size();
@@ -1623,11 +1670,17 @@ int ScoreEditor::getYScrollInPixels()
 NoteSearchResult ScoreEditor::noteAt(RelativeXCoord x, const int y, int& noteID)
 {
     const int head_radius = noteOpen->getImageHeight()/2;
-    const int noteAmount  = m_track->getNoteAmount();
     const int mx          = x.getRelativeTo(WINDOW);
 
-    for (int n=0; n<noteAmount; n++)
+    // a note can be hit on its whole length (linear notation) or on its head (musical notation)
+    std::vector<int> candidates;
+    findNotesInPixelRange(m_track, mx - Editor::getEditorXStart() - 11, mx - Editor::getEditorXStart() + 1,
+                          candidates);
+    
+    const int noteAmount = candidates.size();
+    for (int i=0; i<noteAmount; i++)
     {
+        const int n = candidates[i];
 
         //const int notePitch = track->getNotePitchID(n);
         const int noteLevel = m_converter->noteToLevel( m_track->getNote(n) );
@@ -21,6 +21,7 @@
 #include "Editors/Editor.h"
 
 #include <wx/intl.h>
+#include <map>
 
 namespace AriaMaestosa
 {
@@ -36,6 +37,7 @@ namespace AriaMaestosa
     class Note;
     class Track;
     class ScoreAnalyser;
+    class ScoreAnalysisCache;
     
     const int sign_dist = 5;
     
@@ -178,6 +180,13 @@ namespace AriaMaestosa
         OwnerPtr<ScoreAnalyser>  m_g_clef_analyser;
         OwnerPtr<ScoreAnalyser>  m_f_clef_analyser;
         
+        /** per-measure analysis results of each track this editor renders, one cache per clef */
+        std::map<const Track*, ScoreAnalysisCache*> m_g_clef_caches;
+        std::map<const Track*, ScoreAnalysisCache*> m_f_clef_caches;
+        
+        ScoreAnalysisCache* getAnalysisCache(std::map<const Track*, ScoreAnalysisCache*>& caches,
+                                             const Track* track);
+        
         bool m_musical_notation_enabled;
         bool m_linear_notation_enabled;
         
@@ -185,7 +194,7 @@ namespace AriaMaestosa
         int m_clicked_note;
         
         /** helper method for rendering */
-        void renderScore(ScoreAnalyser* analyser, const int silences_y, 
+        void renderScore(ScoreAnalyser* analyser, const ScoreAnalysisCache* cache, const int silences_y,
                         bool renderSilences, const AriaColor& baseColor);
         
         /** helper method for rendering */
@@ -232,6 +241,9 @@ namespace AriaMaestosa
         /** Called when user changes key. parameters are e.g. 5 sharps, 3 flats, etc. */
         virtual void onKeyChange(const int symbol_amount, const KeyType sharpness_symbol);
         
+        /** Override from Editor, to also forget the analysis cache of the deleted track */
+        virtual void trackDeleted(Track* track);
+        
         virtual void render(RelativeXCoord mousex_current, int mousey_current,
                             RelativeXCoord mousex_initial, int mousey_initial, bool focus=false);
         
@@ -1154,12 +1154,12 @@ void GraphicalTrack::processMouseOutsideOfMe()
 void GraphicalTrack::onTrackRemoved(Track* track)
 {
     m_keyboard_editor->trackDeleted(track);
+    m_score_editor->trackDeleted(track);
     
     // uncomment if these editors get background support too
     // m_guitar_editor->trackDelete(track);
     // m_drum_editor->trackDelete(track);
     // m_controller_editor->trackDelete(track);
-    // m_score_editor->trackDelete(track);
 }
 
 // ----------------------------------------------------------------------------------------------------------
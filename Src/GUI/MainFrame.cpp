@@ -345,6 +345,7 @@ MainFrame::MainFrame() : wxFrame(NULL, wxID_ANY, wxT("Aria Maestosa"), wxPoint(1
     m_disabled_for_welcome_screen = false;
     m_paused = false;
     m_reload_mode = false;
+    m_files_opened = false;
 
     m_root_sizer = new wxBoxSizer(wxVERTICAL);
     m_root_sizer->Add(m_main_panel, 1, wxEXPAND | wxALL, 0);
@@ -859,6 +860,7 @@ void MainFrame::onShow(wxShowEvent& evt)
     {
         loadFile(m_files_to_open[n]);
     }
+    m_files_opened = true;
     
     
     if ( pd->getBoolValue(SETTING_ID_LOAD_LAST_SESSION, false) && !m_file_in_command_line )
@@ -417,6 +417,9 @@ namespace AriaMaestosa
         wxArrayString m_files_to_open;
         bool m_reload_mode;
         
+        /** whether the files given to 'init' were processed (whether they could be loaded or not) */
+        bool m_files_opened;
+        
         
         
         void loadAriaFile(const wxString& filePath);
@@ -616,6 +619,9 @@ namespace AriaMaestosa
 
         /** Returns the amount of open sequences (files). */
         int getSequenceAmount() const { return m_sequences.size(); }
+        
+        /** @return whether the files to open at startup were processed (they may have failed to load) */
+        bool areStartupFilesOpened() const { return m_files_opened; }
 
         /**
          * Close an open sequence.
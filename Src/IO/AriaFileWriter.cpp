@@ -17,6 +17,7 @@
 #include "AriaFileWriter.h"
 
 #include "GUI/GraphicalSequence.h"
+#include "IO/IOUtils.h"
 #include "Midi/Sequence.h"
 
 #include <wx/string.h>
@@ -41,6 +42,40 @@ namespace AriaMaestosa
         if (overriding_file) wxRemoveFile( temp_name );
     }
     
+    bool saveAriaFile(Sequence* sequence, wxString filepath)
+    {
+        wxString temp_name = filepath + wxT("~");
+        const bool overriding_file = wxFileExists(filepath);
+        if (overriding_file and not wxRenameFile( filepath, temp_name, true )) return false;
+        
+        bool success;
+        {
+            wxFileOutputStream file( filepath );
+            success = file.IsOk();
+            if (success)
+            {
+                // same as GraphicalSequence::saveToFile, with the view at its default position
+                writeData("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n", file);
+                writeData(wxT("<seqview xscroll=\"0\" yscroll=\"0\" zoom=\"100\">\n"), file);
+                sequence->saveToFile(file);
+                writeData(wxT("</seqview>\n"), file);
+                
+                success = (file.GetLastError() == wxSTREAM_NO_ERROR and file.Close());
+            }
+        }
+        
+        if (not success)
+        {
+            // do not leave a partial file, and give back the file that was there
+            if (wxFileExists(filepath)) wxRemoveFile( filepath );
+            if (overriding_file) wxRenameFile( temp_name, filepath, false );
+            return false;
+        }
+        
+        if (overriding_file) wxRemoveFile( temp_name );
+        return true;
+    }
+    
     bool loadAriaFile(GraphicalSequence* sequence, wxString filepath)
     {
         wxFFile file(filepath);
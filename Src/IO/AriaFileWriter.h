@@ -24,6 +24,7 @@ namespace AriaMaestosa
 {
     
     class GraphicalSequence; // forward
+    class Sequence;
     
     /** @ingroup io */
     bool loadAriaFile(GraphicalSequence* sequence, wxString filepath);
@@ -31,6 +32,14 @@ namespace AriaMaestosa
     /** @ingroup io */
     void saveAriaFile(GraphicalSequence* sequence, wxString filepath);
     
+    /**
+      * @brief save a sequence that has no graphical representation, with the default view settings
+      * @note  does not touch the GUI, so it may be called from worker threads
+      * @return whether the file could be written; if not, any file previously there is left untouched
+      * @ingroup io
+      */
+    bool saveAriaFile(Sequence* sequence, wxString filepath);
+    
 }
 
 #endif
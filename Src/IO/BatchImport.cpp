@@ -0,0 +1,210 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "IO/BatchImport.h"
+#include "IO/AriaFileWriter.h"
+#include "IO/MidiFileReader.h"
+#include "Midi/Sequence.h"
+#include "Midi/Track.h"
+#include "UnitTest.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include <wx/stopwatch.h>
+
+using namespace AriaMaestosa;
+
+class BatchImporter::Worker : public wxThread
+{
+    BatchImporter* m_parent;
+public:
+    Worker(BatchImporter* parent) : wxThread(wxTHREAD_JOINABLE), m_parent(parent) {}
+    virtual ExitCode Entry()
+    {
+        m_parent->workerLoop();
+        return 0;
+    }
+};
+
+// ----------------------------------------------------------------------------------------------------------
+
+BatchImporter::BatchImporter(const int threadCount)
+{
+    m_thread_count = (threadCount > 0 ? threadCount : std::max(1, wxThread::GetCPUCount()));
+    m_callback     = NULL;
+    m_next_job     = 0;
+    m_done         = 0;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+wxString BatchImporter::makeUniqueDestination(const wxString& ariaPath)
+{
+    wxFileName destination(ariaPath);
+    const wxString name = destination.GetName();
+
+    for (int n=2; ; n++)
+    {
+        // compare absolute paths, ignoring case where the file system does
+        wxFileName key(destination);
+        key.Normalize(wxPATH_NORM_DOTS | wxPATH_NORM_ABSOLUTE | wxPATH_NORM_TILDE | wxPATH_NORM_CASE);
+        if (m_destinations.insert(key.GetFullPath()).second) return destination.GetFullPath();
+
+        destination.SetName(name + wxString::Format(wxT(" (%i)"), n));
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+wxString BatchImporter::addFile(const wxString& midiPath, const wxString& ariaPath)
+{
+    Job job;
+    job.m_source      = midiPath;
+    job.m_destination = makeUniqueDestination(ariaPath);
+    m_jobs.push_back(job);
+    return job.m_destination;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int BatchImporter::addDirectory(const wxString& directory, const wxString& outputDir)
+{
+    wxArrayString files;
+    wxDir::GetAllFiles(directory, &files, wxEmptyString, wxDIR_FILES);
+    files.Sort();
+
+    int added = 0;
+    for (unsigned int n=0; n<files.GetCount(); n++)
+    {
+        wxFileName source(files[n]);
+        const wxString extension = source.GetExt().Lower();
+        if (extension != wxT("mid") and extension != wxT("midi")) continue;
+
+        wxFileName destination(outputDir, source.GetName(), wxT("aria"));
+        addFile(source.GetFullPath(), destination.GetFullPath());
+        added++;
+    }
+    return added;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void BatchImporter::convert(const Job& job, BatchImportResult& result)
+{
+    result.m_source      = job.m_source;
+    result.m_destination = job.m_destination;
+
+    wxFileName source(job.m_source);
+    result.m_file_size = (source.FileExists() ? (long)source.GetSize().ToULong() : 0);
+
+    wxStopWatch watch;
+
+    OwnerPtr<Sequence> sequence(new Sequence(NULL, NULL, NULL, NULL, false));
+    if (loadMidiFile(sequence, job.m_source, result.m_warnings))
+    {
+        sequence->setFilepath(job.m_destination);
+        result.m_success = saveAriaFile(sequence, job.m_destination);
+
+        for (int n=0; n<sequence->getTrackAmount(); n++)
+        {
+            result.m_note_count += sequence->getTrack(n)->getNoteAmount();
+        }
+    }
+
+    result.m_time_ms = watch.Time();
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void BatchImporter::workerLoop()
+{
+    while (true)
+    {
+        int jobID;
+        {
+            wxMutexLocker lock(m_lock);
+            jobID = m_next_job++;
+        }
+        if (jobID >= (int)m_jobs.size()) return;
+
+        // each worker writes its own slot, the vector is not resized while workers run
+        convert(m_jobs[jobID], m_results[jobID]);
+
+        wxMutexLocker lock(m_lock);
+        m_done++;
+        if (m_callback != NULL) m_callback(m_results[jobID], m_done, m_jobs.size());
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void BatchImporter::run(ResultCallback callback)
+{
+    m_results.clear();
+    m_results.resize(m_jobs.size());
+    m_callback = callback;
+    m_next_job = 0;
+    m_done     = 0;
+
+    std::vector<Worker*> workers;
+    const int workerAmount = std::min(m_thread_count, (int)m_jobs.size());
+    for (int n=0; n<workerAmount; n++)
+    {
+        Worker* worker = new Worker(this);
+        if (worker->Create() != wxTHREAD_NO_ERROR or worker->Run() != wxTHREAD_NO_ERROR)
+        {
+            delete worker;
+            break;
+        }
+        workers.push_back(worker);
+    }
+
+    // if no thread could be started, do the work here; otherwise this thread waits for the workers
+    if (workers.empty()) workerLoop();
+
+    for (unsigned int n=0; n<workers.size(); n++)
+    {
+        workers[n]->Wait();
+        delete workers[n];
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestBatchImport
+{
+    using namespace AriaMaestosa;
+
+    UNIT_TEST( TestUniqueDestinations )
+    {
+        const wxString outputDir = wxFileName::GetTempDir();
+        const wxString song      = wxFileName(outputDir, wxT("song"),     wxT("aria")).GetFullPath();
+        const wxString song2     = wxFileName(outputDir, wxT("song (2)"), wxT("aria")).GetFullPath();
+        const wxString song3     = wxFileName(outputDir, wxT("song (3)"), wxT("aria")).GetFullPath();
+        const wxString other     = wxFileName(outputDir, wxT("other"),    wxT("aria")).GetFullPath();
+
+        BatchImporter importer(1);
+        require(importer.addFile(wxT("a/song.mid"),  song) == song,  "first file keeps its name");
+        require(importer.addFile(wxT("b/song.mid"),  song) == song2, "file with the same name is numbered");
+        require(importer.addFile(wxT("a/song.midi"), song) == song3, "numbering goes on");
+
+        require(importer.addFile(wxT("a/other.mid"), other) == other, "other names are not affected");
+        require_e(importer.getFileCount(), ==, 4, "all files were queued");
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __BATCH_IMPORT_H__
+#define __BATCH_IMPORT_H__
+
+#include <set>
+#include <vector>
+#include <wx/string.h>
+#include <wx/thread.h>
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief outcome of the conversion of one file by the BatchImporter
+      * @ingroup io
+      */
+    struct BatchImportResult
+    {
+        wxString m_source;
+        wxString m_destination;
+        bool     m_success;
+        int      m_note_count;
+        long     m_file_size;
+        long     m_time_ms;
+        std::set<wxString> m_warnings;
+
+        BatchImportResult() : m_success(false), m_note_count(0), m_file_size(0), m_time_ms(0) {}
+    };
+
+    /**
+      * @brief Converts many MIDI files to .aria files without any GUI, in parallel worker threads.
+      *
+      * Each file is imported into its own plain Sequence (no GraphicalSequence is involved) with
+      * loadMidiFile, then written with saveAriaFile. Files are handed out to the workers one at a time,
+      * so a few big files do not hold back the others.
+      *
+      * @ingroup io
+      */
+    class BatchImporter
+    {
+    public:
+
+        /** called, from the worker that converted it, after each file; calls are serialized */
+        typedef void (*ResultCallback)(const BatchImportResult& result, int done, int total);
+
+    private:
+
+        class Worker;
+
+        struct Job
+        {
+            wxString m_source;
+            wxString m_destination;
+        };
+
+        std::vector<Job>               m_jobs;
+        std::vector<BatchImportResult> m_results;
+
+        /** normalized destinations of the queued jobs, so that no two jobs write the same file */
+        std::set<wxString>             m_destinations;
+        int                            m_thread_count;
+        ResultCallback                 m_callback;
+
+        wxMutex m_lock;
+        int     m_next_job;
+        int     m_done;
+
+        void workerLoop();
+        void convert(const Job& job, BatchImportResult& result);
+        wxString makeUniqueDestination(const wxString& ariaPath);
+
+    public:
+
+        /** @param threadCount number of worker threads, or 0 to use one per processor */
+        BatchImporter(const int threadCount = 0);
+
+        /**
+          * @brief queue the conversion of one MIDI file to the given .aria file
+          *
+          * If a file already queued is saved to 'ariaPath' (e.g. two MIDI files with the same name in
+          * different directories), a number is appended to the name, as in 'song (2).aria'.
+          * @return the path the file will be saved to
+          */
+        wxString addFile(const wxString& midiPath, const wxString& ariaPath);
+
+        /**
+          * @brief queue all .mid and .midi files of a directory (not recursively), each saved in 'outputDir'
+          *        under the same name with extension .aria (numbered if taken, see 'addFile')
+          * @return the number of files added
+          */
+        int addDirectory(const wxString& directory, const wxString& outputDir);
+
+        int getFileCount() const { return m_jobs.size(); }
+
+        /** @brief convert all queued files, returns when all are done */
+        void run(ResultCallback callback = NULL);
+
+        /** @brief results of the last run, in the order the files were added */
+        const std::vector<BatchImportResult>& getResults() const { return m_results; }
+    };
+
+}
+
+#endif
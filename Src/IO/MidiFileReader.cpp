@@ -23,6 +23,8 @@
 #include "Midi/Sequence.h"
 #include "Midi/Track.h"
 #include "PreferencesData.h"
+#include "UnitTest.h"
+#include "UnitTestUtils.h"
 
 #include "jdksmidi/world.h"
 #include "jdksmidi/track.h"
@@ -34,6 +36,7 @@
 
 #include <cmath>
 #include <string>
+#include <vector>
 #include <wx/intl.h>
 
 class AriaMIDIFileReadMultiTrack : public jdksmidi::MIDIFileReadMultiTrack
@@ -50,17 +53,73 @@ public:
     }
 };
 
-bool AriaMaestosa::loadMidiFile(GraphicalSequence* gseq, wxString filepath, std::set<wxString>& warnings)
+// ----------------------------------------------------------------------------------------------------------
+
+/**
+  * The notes of the track being imported that are still waiting for their note off, as indices in the
+  * track's note vector. There is one stack per channel and per key, so that each note off is matched
+  * in constant time with the most recent note on of the same key on the same channel.
+  */
+class OpenNotes
 {
-    Sequence* sequence = gseq->getModel();
+    std::vector<int> m_stacks[16*128];
+    
+public:
     
+    /** @brief forget all notes; stacks keep their memory so they can be reused for the next track */
+    void clear()
+    {
+        for (int n=0; n<16*128; n++) m_stacks[n].clear();
+    }
+    
+    void push(const int channel, const int key, const int noteID)
+    {
+        m_stacks[channel*128 + key].push_back(noteID);
+    }
+    
+    /** @return the index of the most recent open note with this key on this channel, or -1 if none */
+    int pop(const int channel, const int key)
+    {
+        std::vector<int>& stack = m_stacks[channel*128 + key];
+        if (stack.empty()) return -1;
+        
+        const int noteID = stack.back();
+        stack.pop_back();
+        return noteID;
+    }
+};
+
+namespace AriaMaestosa
+{
+    /**
+      * Converts the tracks read by jdksmidi into Aria tracks.
+      * @return the tick of the last event of the song
+      */
+    static int importMidiTracks(Sequence* sequence, Sequence::Import* import,
+                                jdksmidi::MIDIMultiTrack& jdksequence, std::set<wxString>& warnings);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool AriaMaestosa::loadMidiFile(GraphicalSequence* gseq, wxString filepath, std::set<wxString>& warnings)
+{
+    if (not loadMidiFile(gseq->getModel(), filepath, warnings)) return false;
+
+    gseq->setZoom(100);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool AriaMaestosa::loadMidiFile(Sequence* sequence, wxString filepath, std::set<wxString>& warnings)
+{
     OwnerPtr<Sequence::Import> import(sequence->startImport());
 
-    // the stream used to read the input file
+    // the stream used to read the input file; the file is mapped in memory and parsed in place
 #ifdef WIN32
-    jdksmidi::MIDIFileReadStreamFile rs( (const wchar_t*)filepath.wc_str() );
+    jdksmidi::MIDIFileReadStreamMapped rs( (const wchar_t*)filepath.wc_str() );
 #else
-    jdksmidi::MIDIFileReadStreamFile rs( filepath.mb_str() );
+    jdksmidi::MIDIFileReadStreamMapped rs( filepath.mb_str() );
 #endif
 
     // the object which will hold all the tracks
@@ -79,6 +138,32 @@ bool AriaMaestosa::loadMidiFile(GraphicalSequence* gseq, wxString filepath, std:
         return false;
     }
 
+    const int lastEventTick = importMidiTracks(sequence, import, jdksequence, warnings);
+
+    // set song length
+    MeasureData* md = sequence->getMeasureData();
+    int measureAmount_i = md->measureAtTick(lastEventTick);
+    
+    std::cout << "[loadMidiFile] song length = " << measureAmount_i << " measures, last_event_tick="
+              << lastEventTick << ", beat length = " << sequence->ticksPerQuarterNote() << std::endl;
+
+    if (measureAmount_i < 1) measureAmount_i = 1;
+
+    {
+        ScopedMeasureTransaction tr(md->startTransaction());
+        tr->setMeasureAmount( measureAmount_i );
+    }
+
+    sequence->clearUndoStack();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int AriaMaestosa::importMidiTracks(Sequence* sequence, Sequence::Import* import,
+                                   jdksmidi::MIDIMultiTrack& jdksequence, std::set<wxString>& warnings)
+{
     jdksmidi::MIDITrack* track;
     jdksmidi::MIDITimedBigMessage* event;
 
@@ -91,6 +176,9 @@ bool AriaMaestosa::loadMidiFile(GraphicalSequence* gseq, wxString filepath, std:
     std::set<int> error_message_choker_evt;
     bool lsb_message_printed = false;
     
+    // reused from track to track
+    OpenNotes open_notes;
+    
     {
         ScopedMeasureITransaction tr(sequence->getMeasureData()->startImportTransaction());
         
@@ -151,6 +239,8 @@ bool AriaMaestosa::loadMidiFile(GraphicalSequence* gseq, wxString filepath, std:
 
             bool need_reorder = false;
 
+            open_notes.clear();
+
             for (int eventID=0; eventID<eventAmount; eventID++)
             {
 
@@ -211,35 +301,29 @@ bool AriaMaestosa::loadMidiFile(GraphicalSequence* gseq, wxString filepath, std:
                                              tick+drum_note_duration /*temporary end until the corresponding note off event is found*/,
                                              volume);
 
+                    // drum notes have no durations, no note off will be looked for
+                    if (channel != 9) open_notes.push(channel, event->GetNote(), ariaTrack->getNoteAmount() - 1);
+
                     continue;
                 }
                 // ----------------------------------- note off -------------------------------------
                 else if (event->IsNoteOff() or (event->IsNoteOn() and event->GetVelocity() == 0))
                 {
                     if (channel == 9) continue; // drum notes have no durations so dont care about this event
-                    const int note = (131 - event->GetNote());
                     
                     // a note off event was found, find to which note on event it corresponds
-                    // (start iterating from the end, because since events are in order it will probably be found near the end)
-                    for (int n=ariaTrack->getNoteAmount()-1; n>-1; n--)
+                    // (the most recent one of the same key that is still open)
+                    const int n = open_notes.pop(channel, event->GetNote());
+                    if (n == -1)
                     {
-
-                        if (ariaTrack->getNotePitchID(n) == note and
-                           ariaTrack->getNoteEndInMidiTicks(n)==ariaTrack->getNoteStartInMidiTicks(n)+drum_note_duration )
-                        {
-                            ariaTrack->setNoteEnd_import( tick, n );
-
-                            ASSERT_E(ariaTrack->getNoteEndInMidiTicks(n), ==, tick);
-
-                            break;
-                        }//end if
-
-
-                        if (n == 0)
-                        {
-                            warnings.insert( wxString::Format(_("This MIDI file appears to be incorrect; a note at tick %i in channel %i does not appear to have an end"), tick, channel) );
-                        }
-                    } // next
+                        warnings.insert( wxString::Format(_("This MIDI file appears to be incorrect; a note at tick %i in channel %i does not appear to have an end"), tick, channel) );
+                    }
+                    else
+                    {
+                        ASSERT_E(ariaTrack->getNotePitchID(n), ==, 131 - event->GetNote());
+                        ariaTrack->setNoteEnd_import( tick, n );
+                        ASSERT_E(ariaTrack->getNoteEndInMidiTicks(n), ==, tick);
+                    }
 
                     continue;
                 }
@@ -665,26 +749,125 @@ bool AriaMaestosa::loadMidiFile(GraphicalSequence* gseq, wxString filepath, std:
         if (one_track_one_channel) sequence->setChannelManagementType(CHANNEL_AUTO);
     } // end measure data transaction
 
-    // set song length
-    MeasureData* md = sequence->getMeasureData();
-    int measureAmount_i = md->measureAtTick(lastEventTick);
-    
-    std::cout << "[loadMidiFile] song length = " << measureAmount_i << " measures, last_event_tick="
-              << lastEventTick << ", beat length = " << sequence->ticksPerQuarterNote() << std::endl;
+    return lastEventTick;
+}
 
-    gseq->setZoom(100);
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
 
-    if (measureAmount_i < 1) measureAmount_i = 1;
+using namespace AriaMaestosa;
 
+namespace TestMidiFileReader
+{
+    void putNote(jdksmidi::MIDITrack* track, const int channel, const int key, const int start, const int end,
+                 const bool zeroVelocityNoteOff = false)
     {
-        ScopedMeasureTransaction tr(md->startTransaction());
-        tr->setMeasureAmount( measureAmount_i );
+        jdksmidi::MIDITimedBigMessage m;
+        m.SetTime(start);
+        m.SetNoteOn(channel, key, 100);
+        track->PutEvent(m);
+        
+        m.SetTime(end);
+        if (zeroVelocityNoteOff) m.SetNoteOn(channel, key, 0);
+        else                     m.SetNoteOff(channel, key, 0);
+        track->PutEvent(m);
     }
     
-    gseq->setZoom(100);
-
-    sequence->clearUndoStack();
-
-    return true;
+    UNIT_TEST( TestNoteOffMatching )
+    {
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        
+        TestSequenceProvider provider(seq);
+        AriaMaestosa::setCurrentSequenceProvider(&provider);
+        
+        jdksmidi::MIDIMultiTrack jdksequence(1);
+        jdksequence.SetClksPerBeat(960);
+        jdksmidi::MIDITrack* track = jdksequence.GetTrack(0);
+        
+        putNote(track, 0, 60, 0,   5000);       // held while other notes come and go
+        putNote(track, 0, 64, 100, 400);
+        putNote(track, 0, 64, 200, 300, true);  // overlaps the previous one, closes first
+        putNote(track, 0, 67, 500, 600);
+        track->SortEventsOrder();
+        
+        std::set<wxString> warnings;
+        {
+            OwnerPtr<Sequence::Import> import(seq->startImport());
+            importMidiTracks(seq, import, jdksequence, warnings);
+        }
+        
+        require_e(seq->getTrackAmount(), ==, 1, "track was imported");
+        Track* t = seq->getTrack(0);
+        require_e(t->getNoteAmount(), ==, 4, "all notes were imported");
+        
+        require_e(t->getNotePitchID(0), ==, 131 - 60, "note order");
+        require_e(t->getNoteEndInMidiTicks(0), ==, 5000, "held note ends at its own note off");
+        require_e(t->getNoteStartInMidiTicks(1), ==, 100, "note order");
+        require_e(t->getNoteEndInMidiTicks(1), ==, 400, "note off goes to the note still open");
+        require_e(t->getNoteStartInMidiTicks(2), ==, 200, "note order");
+        require_e(t->getNoteEndInMidiTicks(2), ==, 300, "note off goes to the most recent note of that key");
+        require_e(t->getNoteEndInMidiTicks(3), ==, 600, "note end");
+        require(warnings.empty(), "no warnings for a valid file");
+        
+        delete seq;
+    }
+    
+    UNIT_TEST( TestManyOpenNotes )
+    {
+        const int TRACK_COUNT = 2;
+        const int NOTE_COUNT = 200;
+        const int VOICES = 8;
+        
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        
+        TestSequenceProvider provider(seq);
+        AriaMaestosa::setCurrentSequenceProvider(&provider);
+        
+        jdksmidi::MIDIMultiTrack jdksequence(TRACK_COUNT);
+        jdksequence.SetClksPerBeat(960);
+        
+        const int pedalEnd = (NOTE_COUNT/VOICES + 1)*240 + 960*4;
+        for (int trackID=0; trackID<TRACK_COUNT; trackID++)
+        {
+            jdksmidi::MIDITrack* track = jdksequence.GetTrack(trackID);
+            
+            // a pedal note held for the whole track, and chords of several voices that each last a few
+            // beats, so that many notes (some of the same key) are open at once
+            putNote(track, trackID, 30, 0, pedalEnd);
+            for (int n=0; n<NOTE_COUNT; n++)
+            {
+                const int start = (n/VOICES)*240;
+                putNote(track, trackID, 40 + (n % VOICES)*5 + (n/VOICES) % 3, start, start + 960*4);
+            }
+            track->SortEventsOrder();
+        }
+        
+        std::set<wxString> warnings;
+        {
+            OwnerPtr<Sequence::Import> import(seq->startImport());
+            importMidiTracks(seq, import, jdksequence, warnings);
+        }
+        
+        require_e(seq->getTrackAmount(), ==, TRACK_COUNT, "all tracks imported");
+        for (int trackID=0; trackID<TRACK_COUNT; trackID++)
+        {
+            Track* t = seq->getTrack(trackID);
+            require_e(t->getNoteAmount(), ==, NOTE_COUNT + 1, "all notes were imported");
+            
+            int pedalNotes = 0;
+            for (int n=0; n<t->getNoteAmount(); n++)
+            {
+                require_e(t->getNoteEndInMidiTicks(n), >, t->getNoteStartInMidiTicks(n), "notes were closed");
+                if (t->getNotePitchID(n) == 131 - 30)
+                {
+                    require_e(t->getNoteEndInMidiTicks(n), ==, pedalEnd, "held note was closed by its own note off");
+                    pedalNotes++;
+                }
+            }
+            require_e(pedalNotes, ==, 1, "pedal note was imported once");
+        }
+        require(warnings.empty(), "no warnings for a valid file");
+        
+        delete seq;
+    }
 }
-
@@ -24,10 +24,18 @@ namespace AriaMaestosa
 {
     
     class GraphicalSequence;
+    class Sequence;
     
     /** @ingroup io */
     bool loadMidiFile(GraphicalSequence* sequence, wxString filepath, std::set<wxString>& warnings);
     
+    /**
+      * @brief import a MIDI file into a sequence that has no graphical representation.
+      * @note  does not touch the GUI, so it may be called from worker threads (one sequence per thread)
+      * @ingroup io
+      */
+    bool loadMidiFile(Sequence* sequence, wxString filepath, std::set<wxString>& warnings);
+    
 }
 
 #endif
@@ -15,63 +15,193 @@
  */
 
 #include "IO/MidiToMemoryStream.h"
+#include "UnitTest.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sys/stat.h>
+#include <new>
 
 using namespace AriaMaestosa;
 
-MidiToMemoryStream::MidiToMemoryStream() : MIDIFileWriteStream()
+MidiToMemoryStream::MidiToMemoryStream(const int initialCapacity) : MIDIFileWriteStream()
 {
-    pos=0;
-    length = 0;
+    m_data     = NULL;
+    m_pos      = 0;
+    m_length   = 0;
+    m_capacity = 0;
+
+    if (initialCapacity > 0) reserve(initialCapacity);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+MidiToMemoryStream::~MidiToMemoryStream()
+{
+    free(m_data);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int MidiToMemoryStream::estimateSize(const jdksmidi::MIDIMultiTrack& tracks)
+{
+    // file header, then for each track its header and end-of-track event; a channel event takes at most
+    // 4 bytes with a 1-byte delta time, which covers most events (running status makes them smaller,
+    // longer delta times and meta events make them bigger, and the buffer grows anyway if needed)
+    return 14 + tracks.GetNumTracks()*12 + tracks.GetNumEvents()*5;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiToMemoryStream::reserve(const int capacity)
+{
+    if (capacity <= m_capacity) return;
+
+    char* newData = (char*)realloc(m_data, capacity);
+    if (newData == NULL) throw std::bad_alloc();
+
+    m_data     = newData;
+    m_capacity = capacity;
 }
 
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiToMemoryStream::grow(const int minCapacity)
+{
+    int capacity = std::max(m_capacity*2, 256);
+    if (capacity < minCapacity) capacity = minCapacity;
+    reserve(capacity);
+}
+
+// ----------------------------------------------------------------------------------------------------------
 
 long MidiToMemoryStream::Seek( const long pos_add, const int whence )
 {
 
-    if (whence == SEEK_SET) pos = pos_add; // i think this one is the only once used
-    else if (whence == SEEK_CUR) pos += pos_add;
-    else if (whence == SEEK_END) pos = length-2;
+    if (whence == SEEK_SET) m_pos = pos_add; // i think this one is the only once used
+    else if (whence == SEEK_CUR) m_pos += pos_add;
+    else if (whence == SEEK_END) m_pos = m_length-2;
 
     return 0;
 }
 
+// ----------------------------------------------------------------------------------------------------------
+
 int MidiToMemoryStream::WriteChar( const int c )
 {
+    if (m_pos >= m_capacity) grow(m_pos + 1);
 
-    if (pos==length)
-    {
-        data.push_back(c);
-        length++;
-    }
-    else
-    {
-        data[pos] = c;
-    }
-    pos++;
+    m_data[m_pos++] = (char)c;
+    if (m_pos > m_length) m_length = m_pos;
     return 1;
 }
 
-int MidiToMemoryStream::getDataLength()
+// ----------------------------------------------------------------------------------------------------------
+
+int MidiToMemoryStream::WriteChars( const unsigned char* data, const int count )
 {
-    return length;
+    if (m_pos + count > m_capacity) grow(m_pos + count);
+
+    memcpy(m_data + m_pos, data, count);
+    m_pos += count;
+    if (m_pos > m_length) m_length = m_pos;
+    return count;
 }
 
+// ----------------------------------------------------------------------------------------------------------
+
 void MidiToMemoryStream::storeMidiData(char* midiData)
 {
+    if (m_length > 0) memcpy(midiData, m_data, m_length);
+}
 
-    for (int n=0; n<length; n++)
-    {
-        midiData[n] = data[n];
-    }
+// ----------------------------------------------------------------------------------------------------------
+
+char* MidiToMemoryStream::releaseData()
+{
+    char* out = m_data;
 
+    m_data     = NULL;
+    m_pos      = 0;
+    m_length   = 0;
+    m_capacity = 0;
+
+    return out;
 }
 
-MidiToMemoryStream::~MidiToMemoryStream()
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestMidiToMemoryStream
 {
-}
+    using namespace AriaMaestosa;
 
+    /** the stream as it was before, one push_back per byte, kept as a reference for the test */
+    class ByteVectorStream : public jdksmidi::MIDIFileWriteStream
+    {
+    public:
+        std::vector<char> m_data;
+        int m_pos;
+
+        ByteVectorStream() : m_pos(0) {}
+
+        long Seek(const long pos, const int whence)
+        {
+            if (whence == SEEK_SET) m_pos = pos;
+            return 0;
+        }
+
+        int WriteChar(const int c)
+        {
+            if (m_pos == (int)m_data.size()) m_data.push_back(c);
+            else                             m_data[m_pos] = c;
+            m_pos++;
+            return 1;
+        }
+    };
+
+    void makeTracks(jdksmidi::MIDIMultiTrack& tracks, const int eventCount)
+    {
+        jdksmidi::MIDITrack* track = tracks.GetTrack(0);
+        for (int n=0; n<eventCount/2; n++)
+        {
+            jdksmidi::MIDITimedBigMessage m;
+            m.SetTime(n*10);
+            m.SetNoteOn(n % 16, 40 + n % 50, 100);
+            track->PutEvent(m);
+
+            m.SetTime(n*10 + 5);
+            m.SetNoteOff(n % 16, 40 + n % 50, 0);
+            track->PutEvent(m);
+        }
+    }
+
+    UNIT_TEST( TestWriteSameBytes )
+    {
+        jdksmidi::MIDIMultiTrack tracks(1);
+        makeTracks(tracks, 1000);
+
+        ByteVectorStream reference;
+        jdksmidi::MIDIFileWriteMultiTrack referenceWriter(&tracks, &reference);
+        require(referenceWriter.Write(1, 960), "writing to the reference stream failed");
+
+        // start with a buffer too small, to exercise growth
+        MidiToMemoryStream stream(16);
+        jdksmidi::MIDIFileWriteMultiTrack writer(&tracks, &stream);
+        require(writer.Write(1, 960), "writing to the memory stream failed");
+
+        require_e(stream.getDataLength(), ==, (int)reference.m_data.size(), "same length");
+        require(memcmp(stream.getData(), &reference.m_data[0], stream.getDataLength()) == 0, "same bytes");
+        require_e(stream.getDataLength(), <=, MidiToMemoryStream::estimateSize(tracks), "estimate is an upper bound");
+
+        const int length = stream.getDataLength();
+        char* data = stream.releaseData();
+        require(data != NULL, "buffer handed over");
+        require(memcmp(data, "MThd", 4) == 0, "file header");
+        require_e(stream.getDataLength(), ==, 0, "stream is empty after release");
+        require(memcmp(data + length - 3, "\xFF\x2F\x00", 3) == 0, "ends with end-of-track");
+        free(data);
+    }
+}
 
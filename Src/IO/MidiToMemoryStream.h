@@ -35,23 +35,53 @@ namespace AriaMaestosa
     /**
      * libjdkmidi by default can only save midi bytes to a file.
      * So i wrote this "fake stream" that captures the bytes and stores them in memory rather than to a file.
+     *
+     * The bytes go to a single malloc'd buffer that can be pre-sized with 'estimateSize' and handed over
+     * to the caller with 'releaseData', so a whole song is written without per-byte reallocations and
+     * without a second copy at the end.
      * @ingroup io
      */
     class MidiToMemoryStream : public jdksmidi::MIDIFileWriteStream
     {
-        std::vector<char> data;
-        int pos, length;
-        
+        char* m_data;
+        int   m_pos;
+        int   m_length;
+        int   m_capacity;
+
+        void grow(const int minCapacity);
+
     public:
         LEAK_CHECK();
-        
-        MidiToMemoryStream();
+
+        /** @param initialCapacity  number of bytes to allocate up-front, see 'estimateSize' */
+        MidiToMemoryStream(const int initialCapacity = 0);
         ~MidiToMemoryStream();
-        
+
+        /**
+          * @brief an upper estimate of the size of the MIDI file that will be written from these tracks,
+          *        based on the event count, to be passed to the constructor
+          */
+        static int estimateSize(const jdksmidi::MIDIMultiTrack& tracks);
+
+        /** @brief make sure at least 'capacity' bytes can be written without reallocating */
+        void reserve(const int capacity);
+
         long Seek( const long pos, const int whence );
         int  WriteChar( const int c );
-        int  getDataLength();
+        int  WriteChars( const unsigned char* data, const int count );
+
+        int  getDataLength() const { return m_length; }
+        const char* getData() const { return m_data; }
+
+        /** @brief copy the data to 'midiData', which must be at least 'getDataLength()' bytes long */
         void storeMidiData(char* midiData);
+
+        /**
+          * @brief hand the buffer over to the caller, without copying it.
+          * @return a buffer of 'getDataLength()' bytes (read it before calling this) that the caller
+          *         must 'free()'; the stream is empty afterwards.
+          */
+        char* releaseData();
     };
     
 }
@@ -30,6 +30,7 @@
 
 #include "LeakCheck.h"
 #include <iostream>
+#include <wx/thread.h>
 
 namespace AriaMaestosa
 {
@@ -38,10 +39,14 @@ namespace AriaMaestosa
         
         std::set<MyObject*> g_all_objs;
         
+        // watched objects may be created by worker threads too (e.g. batch import)
+        wxMutex g_all_objs_lock;
+        
         void addObj(MyObject* myObj)
         {
             //std::cout << "addObj " << myObj->file << " (" << myObj->line << ")" << std::endl;
             //g_all_objs.push_back(myObj);
+            wxMutexLocker lock(g_all_objs_lock);
             g_all_objs.insert(myObj);
         }
         
@@ -49,7 +54,10 @@ namespace AriaMaestosa
         {
             //std::cout << "removeObj " << myObj->file << " (" << myObj->line << ")" << std::endl;
             //g_all_objs.remove(myObj);
-            g_all_objs.erase(myObj);
+            {
+                wxMutexLocker lock(g_all_objs_lock);
+                g_all_objs.erase(myObj);
+            }
             delete myObj;
             //std::cout << "removeObj done" << std::endl;
         }
@@ -21,6 +21,7 @@
 #include "Dialogs/WaitWindow.h"
 #include "Midi/CommonMidiUtils.h"
 #include "Midi/MeasureData.h"
+#include "Midi/MidiRouting.h"
 #include "Midi/Players/PlatformMidiManager.h"
 #include "Midi/Sequence.h"
 #include "Midi/Track.h"
@@ -35,6 +36,7 @@
 #include "jdksmidi/fileshow.h"
 #include "jdksmidi/filewritemultitrack.h"
 #include "jdksmidi/msg.h"
+#include "jdksmidi/sequencer.h"
 #include "jdksmidi/sysex.h"
 
 #include <wx/intl.h>
@@ -42,6 +44,7 @@
 #include <wx/msgdlg.h>
 
 #include <iostream>
+#include <queue>
 
 
 /*
@@ -264,32 +267,29 @@ public:
     virtual void pop() = 0;
 };
 
+/**
+  * Pops the events of all sources in time order. Sources are kept in a min-heap ordered by the tick of
+  * their next event, then by their index (so that on ties, the first source goes first), so each event
+  * costs O(log k) for k sources instead of a scan of all sources.
+  */
 void merge( ptr_vector<IMergeSource>& sources )
 {
-    while (true)
+    typedef std::pair<int, int> TickAndSource;
+    std::priority_queue< TickAndSource, std::vector<TickAndSource>, std::greater<TickAndSource> > heap;
+    
+    for (int n=0; n<sources.size(); n++)
     {
-        IMergeSource* min = NULL;
-        int min_tick = -1;
-        for (int n=0; n<sources.size(); n++)
-        {
-            if (sources[n].hasMore())
-            {
-                if (min_tick == -1 or sources[n].getNextTick() < min_tick)
-                {
-                    min_tick = sources[n].getNextTick();
-                    ASSERT_E(min_tick, >=, 0);
-                    min = sources.get(n);
-                }
-            }
-        }
-        
-        if (min == NULL)
-        {
-            // all sources are empty
-            return;
-        }
+        if (sources[n].hasMore()) heap.push( TickAndSource(sources[n].getNextTick(), n) );
+    }
+    
+    while (not heap.empty())
+    {
+        const int n = heap.top().second;
+        ASSERT_E(heap.top().first, >=, 0);
+        heap.pop();
         
-        min->pop();
+        sources[n].pop();
+        if (sources[n].hasMore()) heap.push( TickAndSource(sources[n].getNextTick(), n) );
     }
 }
 
@@ -374,12 +374,257 @@ UNIT_TEST( MergeTest )
 
 // ----------------------------------------------------------------------------------------------------------
 
+/** merge the way it used to be done, scanning all sources for each event; for comparison in tests */
+static void mergeByScanning( ptr_vector<IMergeSource>& sources )
+{
+    while (true)
+    {
+        IMergeSource* min = NULL;
+        int min_tick = -1;
+        for (int n=0; n<sources.size(); n++)
+        {
+            if (sources[n].hasMore() and (min_tick == -1 or sources[n].getNextTick() < min_tick))
+            {
+                min_tick = sources[n].getNextTick();
+                min = sources.get(n);
+            }
+        }
+        
+        if (min == NULL) return;
+        min->pop();
+    }
+}
+
+/** random ticks in increasing order, on a grid so that there are many ties */
+static void makeTestTicks(std::vector< std::vector<int> >& ticks, const int sourceCount, const int eventCount)
+{
+    unsigned int seed = 1234;
+    ticks.resize(sourceCount);
+    for (int s=0; s<sourceCount; s++)
+    {
+        int tick = 0;
+        for (int e=0; e<eventCount; e++)
+        {
+            seed = seed*1103515245 + 12345;
+            tick += ((seed >> 16) % 8)*60;
+            ticks[s].push_back(tick);
+        }
+    }
+}
+
+UNIT_TEST( MergeSameAsScanningTest )
+{
+    class VectorSource : public IMergeSource
+    {
+        const std::vector<int>& m_ticks;
+        int i;
+        int m_id;
+        std::vector<int>& m_output;
+    public:
+        VectorSource(const std::vector<int>& ticks, int id, std::vector<int>& poutput) :
+            m_ticks(ticks), m_output(poutput) { i = 0; m_id = id; }
+        virtual bool hasMore() { return i < (int)m_ticks.size(); }
+        virtual int  getNextTick() { return m_ticks[i]; }
+        virtual void pop() { m_output.push_back(m_id); i++; }
+    };
+    
+    const int SOURCES = 8;
+    const int EVENTS  = 200;
+    std::vector< std::vector<int> > ticks;
+    makeTestTicks(ticks, SOURCES, EVENTS);
+    
+    std::vector<int> heapOrder, scanOrder;
+    ptr_vector<IMergeSource> heapSources, scanSources;
+    for (int s=0; s<SOURCES; s++)
+    {
+        heapSources.push_back( new VectorSource(ticks[s], s, heapOrder) );
+        scanSources.push_back( new VectorSource(ticks[s], s, scanOrder) );
+    }
+    
+    merge( heapSources );
+    mergeByScanning( scanSources );
+    
+    require_e( (int)heapOrder.size(), ==, SOURCES*EVENTS, "All events were merged" );
+    require( heapOrder == scanOrder, "Events are merged in the same order as when scanning all sources" );
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+UNIT_TEST( MultiTrackIteratorTest )
+{
+    const int TRACKS = 8;
+    const int EVENTS = 200;
+    std::vector< std::vector<int> > ticks;
+    makeTestTicks(ticks, TRACKS, EVENTS);
+    
+    jdksmidi::MIDIMultiTrack tracks(TRACKS);
+    for (int t=0; t<TRACKS; t++)
+    {
+        for (int e=0; e<EVENTS; e++)
+        {
+            jdksmidi::MIDITimedBigMessage m;
+            m.SetTime( ticks[t][e] );
+            m.SetNoteOn( t % 16, 60, 100 );
+            tracks.GetTrack(t)->PutEvent( m );
+        }
+    }
+    
+    // expected order : the track with the earliest event, on ties the first track after the previous one
+    std::vector<int> expected;
+    {
+        std::vector<int> next(TRACKS, 0);
+        int current = 0;
+        while (true)
+        {
+            int found = -1;
+            for (int j=0; j<TRACKS; j++)
+            {
+                const int t = (j + current + 1) % TRACKS;
+                if (next[t] < EVENTS and (found == -1 or ticks[t][next[t]] < ticks[found][next[found]])) found = t;
+            }
+            if (found == -1) break;
+            expected.push_back(found);
+            next[found]++;
+            current = found;
+        }
+    }
+    
+    jdksmidi::MIDIMultiTrackIterator iterator(&tracks);
+    iterator.GoToTime(0);
+    std::vector<int> order;
+    jdksmidi::MIDIMultiTrackIteratorState halfway(iterator.GetState());
+    int track;
+    const jdksmidi::MIDITimedBigMessage* msg;
+    do
+    {
+        if (not iterator.GetCurEvent(&track, &msg)) break;
+        order.push_back(track);
+        if ((int)order.size() == TRACKS*EVENTS/2) halfway = iterator.GetState();
+    } while (iterator.GoToNextEvent());
+    
+    require( order == expected, "Events are iterated in time order, tracks with events at the same time in turn" );
+    
+    // a saved state resumes where it was saved
+    iterator.SetState(halfway);
+    std::vector<int> resumed(order.begin(), order.begin() + TRACKS*EVENTS/2 - 1);
+    do
+    {
+        if (not iterator.GetCurEvent(&track, &msg)) break;
+        resumed.push_back(track);
+    } while (iterator.GoToNextEvent());
+    require( resumed == expected, "Iteration resumes from a saved state" );
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+UNIT_TEST( SequencerSeekTest )
+{
+    const int TRACKS   = 4;
+    const int BEAT     = 960;
+    const int MEASURES = 50;
+    const int SEEKS    = 20;
+    
+    // a song with a note on each beat of each track, a pitch bend each measure, tempo changes
+    jdksmidi::MIDIMultiTrack tracks(TRACKS + 1);
+    tracks.SetClksPerBeat(BEAT);
+    for (int measure=0; measure<MEASURES; measure += 16)
+    {
+        jdksmidi::MIDITimedBigMessage m;
+        m.SetTime(measure*4*BEAT);
+        m.SetTempo32((100 + measure % 60) * 32);
+        tracks.GetTrack(0)->PutEvent(m);
+    }
+    for (int t=1; t<=TRACKS; t++)
+    {
+        jdksmidi::MIDITimedBigMessage m;
+        m.SetTime(0);
+        m.SetProgramChange(t % 16, t);
+        tracks.GetTrack(t)->PutEvent(m);
+        m.SetControlChange(t % 16, 7, 100);
+        tracks.GetTrack(t)->PutEvent(m);
+        
+        for (int beat=0; beat<MEASURES*4; beat++)
+        {
+            const int tick = beat*BEAT + t*7;
+            if (beat % 4 == 0)
+            {
+                m.SetTime(tick);
+                m.SetPitchBend(t % 16, (beat*t) % 8192);
+                tracks.GetTrack(t)->PutEvent(m);
+            }
+            m.SetTime(tick);
+            m.SetNoteOn(t % 16, 40 + (beat + t) % 40, 100);
+            tracks.GetTrack(t)->PutEvent(m);
+            m.SetTime(tick + BEAT/2);
+            m.SetNoteOff(t % 16, 40 + (beat + t) % 40, 0);
+            tracks.GetTrack(t)->PutEvent(m);
+        }
+    }
+    
+    std::vector<int> targets;
+    unsigned int seed = 1234;
+    for (int n=0; n<SEEKS; n++)
+    {
+        seed = seed*1103515245 + 12345;
+        targets.push_back((seed >> 8) % (MEASURES*4*BEAT));
+    }
+    
+    // seeking from checkpoints, in random order
+    jdksmidi::MIDISequencer sequencer(&tracks);
+    sequencer.GoToTimeMs(0);
+    
+    std::vector<jdksmidi::MIDISequencerState*> states;
+    for (int n=0; n<SEEKS; n++)
+    {
+        sequencer.GoToTime(targets[n]);
+        states.push_back( new jdksmidi::MIDISequencerState(*sequencer.GetState()) );
+    }
+    
+    // seeking from zero each time, as without checkpoints
+    for (int n=0; n<SEEKS; n++)
+    {
+        jdksmidi::MIDISequencer reference(&tracks);
+        reference.GoToZero();
+        reference.GoToTime(targets[n]);
+        
+        const jdksmidi::MIDISequencerState* state = states[n];
+        const jdksmidi::MIDISequencerState* expected = reference.GetState();
+        require_e( state->cur_clock,   ==, expected->cur_clock,   "Seek reaches the requested time" );
+        require_e( state->cur_time_ms, ==, expected->cur_time_ms, "Time in milliseconds is the same as from zero" );
+        require_e( state->cur_measure, ==, expected->cur_measure, "Measure is the same as from zero" );
+        require_e( state->cur_beat,    ==, expected->cur_beat,    "Beat is the same as from zero" );
+        
+        jdksmidi::MIDIClockTime nextTime = 0, expectedNextTime = 0;
+        require( state->iterator.GetCurEventTime(&nextTime) == expected->iterator.GetCurEventTime(&expectedNextTime)
+                 and nextTime == expectedNextTime, "Next event is the same as from zero" );
+        
+        require_e( state->track_state[0]->tempobpm, ==, expected->track_state[0]->tempobpm,
+                   "Tempo is the same as from zero" );
+        for (int t=1; t<=TRACKS; t++)
+        {
+            require_e( state->track_state[t]->pg, ==, expected->track_state[t]->pg,
+                       "Program is the same as from zero" );
+            require_e( state->track_state[t]->volume, ==, expected->track_state[t]->volume,
+                       "Volume is the same as from zero" );
+            require_e( state->track_state[t]->bender_value, ==, expected->track_state[t]->bender_value,
+                       "Pitch bend is the same as from zero" );
+        }
+    }
+    
+    for (int n=0; n<SEEKS; n++) delete states[n];
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
 bool AriaMaestosa::makeJDKMidiSequence(Sequence* sequence, jdksmidi::MIDIMultiTrack& tracks, bool selectionOnly,
                                        /*out*/int* songLengthInTicks, /*out*/int* startTick,
-                                       /*out*/ int* numTracks, bool playing)
+                                       /*out*/ int* numTracks, bool playing, /*out*/MidiRouting* routing)
 {
     int trackLength = -1;
-    int channel     = 0;
+    
+    MidiRouting singlePort;
+    if (routing == NULL) routing = &singlePort;
+    routing->reset();
     
     int substract_ticks;
     const bool addMetronome = (sequence->playWithMetronome() and playing);
@@ -396,7 +641,7 @@ bool AriaMaestosa::makeJDKMidiSequence(Sequence* sequence, jdksmidi::MIDIMultiTr
     {
         //  ---- add events to tracks
         trackLength = sequence->getCurrentTrack()->addMidiEvents(tracks.GetTrack(sequence->getCurrentTrackID() + 1),
-                                                                 channel,
+                                                                 routing->getNextChannel(),
                                                                  md->getFirstMeasure(),
                                                                  true,
                                                                  *startTick );
@@ -426,15 +671,15 @@ bool AriaMaestosa::makeJDKMidiSequence(Sequence* sequence, jdksmidi::MIDIMultiTr
         {
             bool drum_track = (sequence->getTrack(n)->isNotationTypeEnabled(DRUM));
             
+            // in manual mode, tracks use the channel they were given, on the first port
+            const bool auto_channel = (sequence->getChannelManagementType() == CHANNEL_AUTO);
+            const int port    = (auto_channel and not drum_track ? routing->getNextPort() : 0);
+            const int channel = (drum_track ? MidiRouting::DRUM_CHANNEL : routing->getNextChannel());
+            
             int trackFirstNote = -1;
+            int midiTrack = n+1;
             
-            if (n+1 < tracks.GetNumTracks())
-            {
-                trackLength = sequence->getTrack(n)->addMidiEvents(tracks.GetTrack(n+1), (drum_track ? 9 : channel),
-                                                                   md->getFirstMeasure(), false,
-                                                                   trackFirstNote );
-            }
-            else
+            if (midiTrack >= tracks.GetNumTracks())
             {
                 if (not tooManyChannelsMessageShown)
                 {
@@ -443,10 +688,11 @@ bool AriaMaestosa::makeJDKMidiSequence(Sequence* sequence, jdksmidi::MIDIMultiTr
                     std::cout << "WARNING: this song has too many channels, expect unpredictable output" << std::endl;
                     tooManyChannelsMessageShown = true;
                 }
-                trackLength = sequence->getTrack(n)->addMidiEvents(tracks.GetTrack(1), (drum_track ? 9 : channel),
-                                                                   md->getFirstMeasure(), false,
-                                                                   trackFirstNote );
+                midiTrack = 1;
             }
+            trackLength = sequence->getTrack(n)->addMidiEvents(tracks.GetTrack(midiTrack), channel,
+                                                               md->getFirstMeasure(), false,
+                                                               trackFirstNote );
             
             if ((trackFirstNote<(*startTick) and trackFirstNote != -1) or (*startTick) == -1)
             {
@@ -457,20 +703,18 @@ bool AriaMaestosa::makeJDKMidiSequence(Sequence* sequence, jdksmidi::MIDIMultiTr
             if (trackLength == -1) continue; // nothing to play in track (empty track - skip it)
             if (trackLength > *songLengthInTicks) *songLengthInTicks = trackLength;
             
+            if (midiTrack == n+1) routing->setTrackPort(midiTrack, port);
+            
             if (not drum_track)
             {
-                if (channel > 15 and sequence->getChannelManagementType() == CHANNEL_AUTO)
+                if (routing->isOutOfChannels() and auto_channel and not tooManyChannelsMessageShown)
                 {
-                    if (not tooManyChannelsMessageShown)
-                    {
-                        if (WaitWindow::isShown()) WaitWindow::hide();
-                        wxMessageBox(_("WARNING: this song has too many\nchannels, expect unpredictable output"));
-                        std::cout << "WARNING: this song has too many channels, expect unpredictable output" << std::endl;
-                        tooManyChannelsMessageShown = true;
-                    }
-                    channel = 0;
+                    if (WaitWindow::isShown()) WaitWindow::hide();
+                    wxMessageBox(_("WARNING: this song has too many\nchannels, expect unpredictable output"));
+                    std::cout << "WARNING: this song has too many channels, expect unpredictable output" << std::endl;
+                    tooManyChannelsMessageShown = true;
                 }
-                channel++; if (channel==9) channel++;
+                routing->advance();
             }
         }
         
@@ -924,9 +1168,9 @@ void AriaMaestosa::allocAsMidiBytes(Sequence* sequence, bool selectionOnly, /*ou
     
     makeJDKMidiSequence(sequence, tracks, selectionOnly, songlength, startTick, &numTracks, playing);
     
-    // create the output stream
+    // create the output stream, sized up-front from the event count
     OwnerPtr<MidiToMemoryStream>  out_stream;
-    out_stream = new MidiToMemoryStream();
+    out_stream = new MidiToMemoryStream( MidiToMemoryStream::estimateSize(tracks) );
     
     jdksmidi::MIDIFileWriteMultiTrack writer(
                                             &tracks,
@@ -940,9 +1184,9 @@ void AriaMaestosa::allocAsMidiBytes(Sequence* sequence, bool selectionOnly, /*ou
         return;
     }
     
-    (*midiSongData) = (char*)malloc(out_stream->getDataLength());
-    out_stream->storeMidiData( (*midiSongData) );
+    // hand the stream's buffer over to the caller (who will free() it) instead of copying it
     *datalength = out_stream->getDataLength();
+    (*midiSongData) = out_stream->releaseData();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -963,78 +1207,6 @@ float AriaMaestosa::convertBPMToTempoBend(float tempo)
 
 int AriaMaestosa::getTimeAtTick(int tick, const Sequence* seq)
 {
-    std::vector<float> tempos;
-    std::vector<int> duration;
-    
-    const int tempo_events_amount = seq->getTempoEventAmount();
-    //std::cout << "tempo_events_amount = " << tempo_events_amount << std::endl;
-    if (tempo_events_amount < 1 or (tempo_events_amount == 1 and seq->getTempoEvent(0)->getTick() == 0) )
-    {
-        tempos.push_back(seq->getTempo());
-        duration.push_back(tick);
-    }
-    else
-    {
-        // multiple tempo changes
-        
-        if (tick > seq->getTempoEvent(0)->getTick())
-        {
-            // from beginning to first event
-            tempos.push_back(seq->getTempo());
-            duration.push_back(seq->getTempoEvent(0)->getTick());
-            
-            //std::cout << "Firstly, " << (seq->tempoEvents[0].getTick()) << " ticks at " << seq->getTempo() << std::endl;
-            
-            // other events
-            int n;
-            for (n = 1; n<tempo_events_amount; n++)
-            {
-                if (seq->getTempoEvent(n)->getTick() > tick)
-                {
-                    // this tempo event is only partially used, remove what we had calculated and just to the next part
-                    tempos.pop_back();
-                    duration.pop_back();
-                    break;
-                }
-                else
-                {
-                    tempos.push_back( convertTempoBendToBPM(seq->getTempoEvent(n-1)->getValue()) );
-                    duration.push_back(seq->getTempoEvent(n)->getTick() - seq->getTempoEvent(n-1)->getTick());
-                }
-                //std::cout << (duration[duration.size()-1]) << " ticks at " << (tempos[tempos.size()-1]) << std::endl;
-            }
-            
-            if (seq->getTempoEvent(n-1)->getTick() <= tick)
-            {
-                // after last event
-                tempos.push_back( convertTempoBendToBPM(seq->getTempoEvent(n-1)->getValue()) );
-                duration.push_back( tick - seq->getTempoEvent(n-1)->getTick() );
-            }
-        }
-        else
-        {
-            // tick is before the first event!
-            tempos.push_back(seq->getTempo());
-            duration.push_back(tick);
-        }
-        
-        //std::cout << "Finally, " << (duration[duration.size()-1]) << " ticks at " << (tempos[tempos.size()-1]) << std::endl;
-    }
-    
-    
-    float song_duration = 0;
-    const int amount = tempos.size();
-    for (int n=0; n<amount; n++)
-    {
-        //printf("%i for %i\n", tempos[n], duration[n]);
-        
-        // std::cout << " -- adding " << (int)round( ((float)duration[n] * 60.0f ) / ((float)seq->ticksPerQuarterNote() * (float)tempos[n])) << std::endl;
-        song_duration += ((float)duration[n] * 60.0f ) / ((float)seq->ticksPerQuarterNote() * (float)tempos[n]);
-    }
-    
-    //wxString duration_label = wxString::Format(wxString(_("Song duration :")) + wxT("  %i:%.2i"), (int)(song_duration/60), song_duration%60);
-    //songLength->SetLabel(duration_label);
-    
-    return (int)round(song_duration);
+    return (int)round(seq->getTempoMap().tickToSeconds(tick));
 }
 
@@ -28,6 +28,7 @@ namespace AriaMaestosa
 {
     
     class Sequence; // forward
+    class MidiRouting; // forward
     
     /**
       * @brief used to ease generating midi data
@@ -43,10 +44,13 @@ namespace AriaMaestosa
     
     /**
       * @brief converts an Aria sequence into a libjdkmidi sequence
+      * @param routing if not NULL, channels are assigned over as many output ports as it allows, and it
+      *                receives the port of each track; otherwise all tracks share the 16 channels of one port
       * @ingroup midi
       */
     bool makeJDKMidiSequence(Sequence* sequence, jdksmidi::MIDIMultiTrack& tracks, bool selectionOnly,
-                             /*out*/int* songLengthInTicks, /*out*/int* startTick, /*out*/ int* numTracks, bool playing);
+                             /*out*/int* songLengthInTicks, /*out*/int* startTick, /*out*/ int* numTracks, bool playing,
+                             /*out*/MidiRouting* routing = NULL);
     
     /**
       * @brief For use with the controller editor, when entering tempo bends
@@ -0,0 +1,239 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Midi/ControlEventIndex.h"
+#include "UnitTest.h"
+
+#include <algorithm>
+
+using namespace AriaMaestosa;
+
+const std::vector<int> ControlEventIndex::EMPTY;
+
+// ----------------------------------------------------------------------------------------------------------
+
+ControlEventIndex::ControlEventIndex()
+{
+    m_dirty = true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void ControlEventIndex::rebuild(const ptr_vector<ControllerEvent>& events)
+{
+    // keep the inner vectors (and their capacity) around, edits usually don't change the set of controllers
+    for (unsigned int c=0; c<m_ids.size(); c++) m_ids[c].clear();
+
+    const int count = events.size();
+    for (int n=0; n<count; n++)
+    {
+        const int controller = events[n].getController();
+        ASSERT_E(controller, >=, 0);
+
+        if (controller >= (int)m_ids.size()) m_ids.resize(controller + 1);
+        m_ids[controller].push_back(n);
+    }
+
+    m_dirty = false;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+const std::vector<int>& ControlEventIndex::getEventIDs(const int controller) const
+{
+    ASSERT(not m_dirty);
+
+    if (controller < 0 or controller >= (int)m_ids.size()) return EMPTY;
+    return m_ids[controller];
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int ControlEventIndex::lowerBound(const ptr_vector<ControllerEvent>& events, const int controller,
+                                  const int tick) const
+{
+    const std::vector<int>& ids = getEventIDs(controller);
+
+    int low  = 0;
+    int high = ids.size();
+    while (low < high)
+    {
+        const int mid = low + (high - low)/2;
+        if (events[ids[mid]].getTick() >= tick) high = mid;
+        else                                    low = mid + 1;
+    }
+    return low;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int ControlEventIndex::findEventAt(const ptr_vector<ControllerEvent>& events, const int controller,
+                                   const int tick) const
+{
+    const std::vector<int>& ids = getEventIDs(controller);
+
+    const int n = lowerBound(events, controller, tick);
+    if (n < (int)ids.size() and events[ids[n]].getTick() == tick) return ids[n];
+    return -1;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int ControlEventIndex::lowerBoundByTick(const ptr_vector<ControllerEvent>& events, const int tick)
+{
+    int low  = 0;
+    int high = events.size();
+    while (low < high)
+    {
+        const int mid = low + (high - low)/2;
+        if (events[mid].getTick() >= tick) high = mid;
+        else                               low = mid + 1;
+    }
+    return low;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void ControlEventIndex::findEventsInEffect(const ptr_vector<ControllerEvent>& events, const int tick,
+                                           std::vector<int>& out) const
+{
+    ASSERT(not m_dirty);
+
+    out.clear();
+    for (unsigned int controller=0; controller<m_ids.size(); controller++)
+    {
+        // the event before the first one located after 'tick'
+        const int n = lowerBound(events, controller, tick + 1);
+        if (n > 0) out.push_back(m_ids[controller][n - 1]);
+    }
+
+    std::sort(out.begin(), out.end());
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestControlEventIndex
+{
+
+    UNIT_TEST( TestPerControllerQueries )
+    {
+        ptr_vector<ControllerEvent> events;
+        events.push_back( new ControllerEvent(7,   0,   100) );
+        events.push_back( new ControllerEvent(PSEUDO_CONTROLLER_PITCH_BEND, 0, 64) );
+        events.push_back( new ControllerEvent(PSEUDO_CONTROLLER_PITCH_BEND, 10, 70) );
+        events.push_back( new ControllerEvent(7,   20,  90) );
+        events.push_back( new ControllerEvent(PSEUDO_CONTROLLER_PITCH_BEND, 20, 80) );
+        events.push_back( new ControllerEvent(10,  50,  64) );
+
+        ControlEventIndex index;
+        require(index.isDirty(), "a new index needs to be built");
+        index.rebuild(events);
+        require(not index.isDirty(), "index was built");
+
+        require_e((int)index.getEventIDs(7).size(),  ==, 2, "events are counted per controller");
+        require_e((int)index.getEventIDs(PSEUDO_CONTROLLER_PITCH_BEND).size(), ==, 3,
+                  "events are counted per controller");
+        require_e((int)index.getEventIDs(11).size(), ==, 0, "controllers without events are empty");
+        require_e((int)index.getEventIDs(PSEUDO_CONTROLLER_INSTRUMENT_CHANGE).size(), ==, 0,
+                  "controllers past the last known one are empty");
+
+        require_e(index.getEventIDs(PSEUDO_CONTROLLER_PITCH_BEND)[1], ==, 2, "IDs are in tick order");
+        require_e(index.getEventIDs(PSEUDO_CONTROLLER_PITCH_BEND)[2], ==, 4, "IDs are in tick order");
+
+        require_e(index.lowerBound(events, PSEUDO_CONTROLLER_PITCH_BEND, 5),  ==, 1, "lower bound is correct");
+        require_e(index.lowerBound(events, PSEUDO_CONTROLLER_PITCH_BEND, 99), ==, 3, "lower bound is correct");
+
+        require_e(index.findEventAt(events, 7, 20),  ==, 3,  "event found at exact tick");
+        require_e(index.findEventAt(events, 7, 10),  ==, -1, "events of other controllers are ignored");
+        require_e(index.findEventAt(events, 10, 50), ==, 5,  "event found at exact tick");
+
+        require_e(ControlEventIndex::lowerBoundByTick(events, 20), ==, 3, "lower bound over all controllers");
+        require_e(ControlEventIndex::lowerBoundByTick(events, 51), ==, 6, "lower bound over all controllers");
+
+        std::vector<int> inEffect;
+        index.findEventsInEffect(events, 15, inEffect);
+        require_e((int)inEffect.size(), ==, 2, "one event per controller set before the tick");
+        require_e(inEffect[0], ==, 0, "events in effect are found, in order");
+        require_e(inEffect[1], ==, 2, "the last event of a controller before the tick is in effect");
+
+        index.findEventsInEffect(events, 20, inEffect);
+        require_e((int)inEffect.size(), ==, 2, "one event per controller set at or before the tick");
+        require_e(inEffect[0], ==, 3, "an event located exactly at the tick is in effect");
+        require_e(inEffect[1], ==, 4, "an event located exactly at the tick is in effect");
+
+        index.findEventsInEffect(events, -1, inEffect);
+        require_e((int)inEffect.size(), ==, 0, "no controller is set before the first event");
+
+        // events change : the owner invalidates and the index is rebuilt
+        events.erase(0);
+        index.invalidate();
+        index.rebuild(events);
+        require_e((int)index.getEventIDs(7).size(), ==, 1, "rebuilt index reflects removal");
+        require_e(index.findEventAt(events, 7, 20), ==, 2, "rebuilt index has updated IDs");
+    }
+
+    UNIT_TEST( TestEventsInEffectSameAsScanning )
+    {
+        // volume, pan, pitch bend and instrument changes on most beats
+        const int BEAT   = 960;
+        const int BEATS  = 500;
+        const int STARTS = 50;
+        const int controllers[] = {7, 10, PSEUDO_CONTROLLER_PITCH_BEND, PSEUDO_CONTROLLER_INSTRUMENT_CHANGE};
+
+        ptr_vector<ControllerEvent> events;
+        unsigned int seed = 1234;
+        for (int beat=0; beat<BEATS; beat++)
+        {
+            for (int c=0; c<4; c++)
+            {
+                seed = seed*1103515245 + 12345;
+                if ((seed >> 16) % 4 <= 2 - c/2)
+                {
+                    events.push_back( new ControllerEvent(controllers[c], beat*BEAT + c*BEAT/4, (seed >> 8) % 128) );
+                }
+            }
+        }
+
+        std::vector<int> starts;
+        for (int n=0; n<STARTS; n++)
+        {
+            seed = seed*1103515245 + 12345;
+            starts.push_back((seed >> 8) % (BEATS*BEAT));
+        }
+
+        ControlEventIndex index;
+        index.rebuild(events);
+        std::vector< std::vector<int> > found(STARTS);
+        for (int n=0; n<STARTS; n++) index.findEventsInEffect(events, starts[n], found[n]);
+
+        // going through all events before the starting point, as when starting playback used to
+        for (int n=0; n<STARTS; n++)
+        {
+            std::vector<int> last(PSEUDO_CONTROLLER_INSTRUMENT_CHANGE + 1, -1);
+            const int count = events.size();
+            for (int e=0; e<count and events[e].getTick() <= starts[n]; e++) last[events[e].getController()] = e;
+
+            std::vector<int> expected;
+            for (unsigned int c=0; c<last.size(); c++) if (last[c] != -1) expected.push_back(last[c]);
+            std::sort(expected.begin(), expected.end());
+
+            require(found[n] == expected, "events in effect are the last of each controller before the start");
+        }
+    }
+
+}
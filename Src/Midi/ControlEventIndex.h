@@ -0,0 +1,98 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CONTROL_EVENT_INDEX_H__
+#define __CONTROL_EVENT_INDEX_H__
+
+#include "ptr_vector.h"
+#include "Midi/ControllerEvent.h"
+
+#include <vector>
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief Per-controller index over the control events of a track
+      *
+      * All controller types of a track share a single vector of events sorted by tick; this index keeps,
+      * for each controller type, the IDs of its events in that vector (hence also in tick order), so that
+      * iterating, counting or finding the events of one controller does not need to go through the events
+      * of all the others. As with NoteRangeIndex, the owner must call 'invalidate' whenever events are
+      * added, removed or moved, and the index is then rebuilt lazily, in a single pass, on next use.
+      *
+      * @ingroup midi
+      */
+    class ControlEventIndex
+    {
+        /** for each controller type, IDs of its events in the track's vector, in tick order */
+        std::vector< std::vector<int> > m_ids;
+        bool m_dirty;
+
+        /** returned for controller types that have no events */
+        static const std::vector<int> EMPTY;
+
+    public:
+        LEAK_CHECK();
+
+        ControlEventIndex();
+
+        /** @brief mark the index as out of date, it will be rebuilt on next use */
+        void invalidate() { m_dirty = true; }
+
+        bool isDirty() const { return m_dirty; }
+
+        /** @brief rebuild the index from a vector of control events sorted by tick */
+        void rebuild(const ptr_vector<ControllerEvent>& events);
+
+        /**
+          * @return IDs, in the vector this index was built from, of all events of the given controller,
+          *         in tick order
+          * @pre    the index is not dirty
+          */
+        const std::vector<int>& getEventIDs(const int controller) const;
+
+        /**
+          * @return position, within 'getEventIDs(controller)', of the first event of this controller
+          *         whose tick is greater than or equal to 'tick' (binary search)
+          */
+        int lowerBound(const ptr_vector<ControllerEvent>& events, const int controller, const int tick) const;
+
+        /** @return ID of the event of this controller located exactly at 'tick', or -1 if there is none */
+        int findEventAt(const ptr_vector<ControllerEvent>& events, const int controller, const int tick) const;
+
+        /**
+          * @return index of the first event in 'events', of any controller, whose tick is greater than or
+          *         equal to 'tick' (binary search; does not require the index to be built)
+          */
+        static int lowerBoundByTick(const ptr_vector<ControllerEvent>& events, const int tick);
+
+        /**
+          * @brief find the value of each controller in effect at 'tick', i.e. the last event of each
+          *        controller located at or before it (one binary search per controller type)
+          *
+          * Used to start playback in the middle of a track with the right instrument, volume, pitch bend...
+          *
+          * @param[out] out receives the IDs of these events, in the order of 'events'
+          */
+        void findEventsInEffect(const ptr_vector<ControllerEvent>& events, const int tick,
+                                std::vector<int>& out) const;
+    };
+
+}
+
+#endif
@@ -20,7 +20,10 @@
 #include "Midi/Sequence.h"
 #include "Midi/Track.h"
 #include "Midi/TimeSigChange.h"
+#include "UnitTest.h"
+#include "UnitTestUtils.h"
 
+#include <algorithm>
 #include <iostream>
 #include "irrXML/irrXML.h"
 
@@ -247,11 +250,20 @@ int MeasureData::measureAtTick(int tick) const
             }
         }
         
-        // iterate through measures till we find the one at the given tick
+        // measure start ticks are a running sum of measure lengths, so they are sorted : binary search
+        // for the last measure starting at or before the given tick
         const int amount = m_measure_info.size();
-        for (int n=0; n<amount-1; n++)
+        if (amount > 0 and tick < m_measure_info[amount-1].tick)
         {
-            if ( m_measure_info[n].tick <= tick and m_measure_info[n+1].tick > tick ) return n;
+            int low  = 0;
+            int high = amount - 1;
+            while (low < high)
+            {
+                const int mid = (low + high + 1)/2;
+                if (m_measure_info[mid].tick <= tick) low  = mid;
+                else                                  high = mid - 1;
+            }
+            return low;
         }
 
         // did not find this tick in our current measure set
@@ -343,41 +355,35 @@ int MeasureData::lastTickInMeasure(int id) const
 #pragma mark Time Signature Management
 #endif
 
-int MeasureData::getTimeSigNumerator(int measure) const
+int MeasureData::getTimeSigIndexAt(int measure) const
 {
-    if (measure != -1)
+    // time sig changes are kept sorted by measure : binary search for the last one located at or
+    // before the given measure
+    int low  = 0;
+    int high = m_time_sig_changes.size() - 1;
+    while (low < high)
     {
-        measure += 1;
-        const int timeSigChangeAmount = m_time_sig_changes.size();
-        for (int n=0; n<timeSigChangeAmount; n++)
-        {
-            if (m_time_sig_changes[n].getMeasure() >= measure) return m_time_sig_changes[n-1].getNum();
-        }
-        return m_time_sig_changes[timeSigChangeAmount-1].getNum();
+        const int mid = (low + high + 1)/2;
+        if (m_time_sig_changes[mid].getMeasure() <= measure) low  = mid;
+        else                                                 high = mid - 1;
     }
-    else return m_time_sig_changes[m_selected_time_sig].getNum();
+    return low;
 }
 
 // ----------------------------------------------------------------------------------------------------------
 
-int MeasureData::getTimeSigDenominator(int measure) const
+int MeasureData::getTimeSigNumerator(int measure) const
 {
+    if (measure != -1) return m_time_sig_changes[getTimeSigIndexAt(measure)].getNum();
+    else               return m_time_sig_changes[m_selected_time_sig].getNum();
+}
 
-    if (measure != -1)
-    {
-        measure+=1;
+// ----------------------------------------------------------------------------------------------------------
 
-        const int timeSigChangeAmount = m_time_sig_changes.size();
-        for (int n=0; n<timeSigChangeAmount; n++)
-        {
-            if (m_time_sig_changes[n].getMeasure() >= measure) return m_time_sig_changes[n-1].getDenom();
-        }
-        return m_time_sig_changes[timeSigChangeAmount-1].getDenom();
-    }
-    else
-    {
-        return m_time_sig_changes[m_selected_time_sig].getDenom();
-    }
+int MeasureData::getTimeSigDenominator(int measure) const
+{
+    if (measure != -1) return m_time_sig_changes[getTimeSigIndexAt(measure)].getDenom();
+    else               return m_time_sig_changes[m_selected_time_sig].getDenom();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -888,3 +894,61 @@ float MeasureData::getBeatSize(int numerator, int denominator) const
     return 4.0/(float)denominator;
 }
 
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestMeasureData
+{
+    
+    const int TEST_NUMERATORS[]   = {4, 3, 7, 5, 6};
+    const int TEST_DENOMINATORS[] = {4, 4, 8, 4, 8};
+    const int TEST_METER_COUNT    = 5;
+    
+    /** @brief fill the given sequence with 'measureAmount' measures, changing meter every 'every' measures */
+    void makeMeasures(Sequence* seq, const int measureAmount, const int every)
+    {
+        MeasureData* md = seq->getMeasureData();
+        
+        ScopedMeasureTransaction tr(md->startTransaction());
+        tr->setMeasureAmount(measureAmount);
+        for (int measure=0; measure<measureAmount; measure += every)
+        {
+            const int meter = (measure/every) % TEST_METER_COUNT;
+            if (measure == 0) tr->setTimeSig(TEST_NUMERATORS[meter], TEST_DENOMINATORS[meter]);
+            else              tr->addTimeSigChange(measure, TEST_NUMERATORS[meter], TEST_DENOMINATORS[meter]);
+        }
+    }
+    
+    UNIT_TEST( TestMeasureQueries )
+    {
+        Sequence* seq = new Sequence(NULL, NULL, NULL, NULL, false);
+        TestSequenceProvider provider(seq);
+        AriaMaestosa::setCurrentSequenceProvider(&provider);
+        
+        const int MEASURES = 60;
+        const int EVERY    = 3;
+        makeMeasures(seq, MEASURES, EVERY);
+        
+        MeasureData* md = seq->getMeasureData();
+        require(not md->isMeasureLengthConstant(), "song has meter changes");
+        require_e(md->getTimeSigAmount(), ==, MEASURES/EVERY, "one time sig event per change");
+        
+        for (int measure=0; measure<MEASURES; measure++)
+        {
+            const int meter = (measure/EVERY) % TEST_METER_COUNT;
+            require_e(md->getTimeSigNumerator(measure),   ==, TEST_NUMERATORS[meter],   "numerator of measure");
+            require_e(md->getTimeSigDenominator(measure), ==, TEST_DENOMINATORS[meter], "denominator of measure");
+            
+            const int first = md->firstTickInMeasure(measure);
+            const int last  = md->lastTickInMeasure(measure);
+            require_e(md->measureAtTick(first),    ==, measure, "first tick of a measure");
+            require_e(md->measureAtTick(last - 1), ==, measure, "last tick of a measure");
+            if (measure > 0) require_e(first, ==, md->lastTickInMeasure(measure - 1), "measures are contiguous");
+        }
+        
+        require_e(md->measureAtTick(-50), ==, 0, "ticks before the song start are in the first measure");
+        
+        delete seq;
+    }
+    
+}
@@ -393,6 +393,9 @@ namespace AriaMaestosa
         
         private:
         
+        /** @return ID of the time sig change in effect at the given measure (binary search) */
+        int getTimeSigIndexAt(int measure) const;
+        
         int getMeasureLengthInTicks(int num, int denom) const;
         int getBeatCount(int numerator, int denominator) const;
         float getBeatSize(int numerator, int denominator) const;
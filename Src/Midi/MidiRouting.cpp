@@ -0,0 +1,138 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Midi/MidiRouting.h"
+#include "UnitTest.h"
+#include "Utils.h"
+
+#include <set>
+
+using namespace AriaMaestosa;
+
+// ----------------------------------------------------------------------------------------------------------
+
+MidiRouting::MidiRouting(const int maxPorts)
+{
+    ASSERT_E(maxPorts, >=, 1);
+    m_max_ports = maxPorts;
+    reset();
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiRouting::reset()
+{
+    m_port_amount     = 1;
+    m_next_port       = 0;
+    m_next_channel    = 0;
+    m_out_of_channels = false;
+    m_track_ports.clear();
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiRouting::advance()
+{
+    m_next_channel++;
+    if (m_next_channel == DRUM_CHANNEL) m_next_channel++;
+
+    if (m_next_channel >= CHANNELS_PER_PORT)
+    {
+        m_next_channel = 0;
+        m_next_port++;
+        if (m_next_port >= m_max_ports)
+        {
+            m_next_port = 0;
+            m_out_of_channels = true;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiRouting::setTrackPort(const int track, const int port)
+{
+    ASSERT_E(track, >=, 0);
+    ASSERT_E(port, >=, 0);
+    ASSERT_E(port, <, m_max_ports);
+
+    if (track >= (int)m_track_ports.size()) m_track_ports.resize(track + 1, 0);
+    m_track_ports[track] = port;
+
+    if (port >= m_port_amount) m_port_amount = port + 1;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int MidiRouting::getTrackPort(const int track) const
+{
+    if (track < 0 or track >= (int)m_track_ports.size()) return 0;
+    return m_track_ports[track];
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestMidiRouting
+{
+
+    UNIT_TEST( TestManyTracks )
+    {
+        // 40 melodic tracks on an output with 4 ports, assigned as makeJDKMidiSequence does
+        const int TRACKS = 40;
+        MidiRouting routing(4);
+
+        std::set<int> used;
+        for (int track=1; track<=TRACKS; track++)
+        {
+            const int port    = routing.getNextPort();
+            const int channel = routing.getNextChannel();
+            require(channel != MidiRouting::DRUM_CHANNEL, "the drum channel is not given to melodic tracks");
+            require(used.insert(port*MidiRouting::CHANNELS_PER_PORT + channel).second,
+                    "tracks don't share channels while there are free ones");
+
+            routing.setTrackPort(track, port);
+            routing.advance();
+        }
+
+        require(not routing.isOutOfChannels(), "4 ports have room for 40 tracks");
+        require_e(routing.getPortAmount(), ==, 3, "ports are filled one after the other");
+        require_e(routing.getTrackPort(15), ==, 0, "each port has 15 melodic channels");
+        require_e(routing.getTrackPort(16), ==, 1, "each port has 15 melodic channels");
+        require_e(routing.getTrackPort(TRACKS), ==, 2, "each port has 15 melodic channels");
+        require_e(routing.getTrackPort(0), ==, 0, "tracks without events of their own use the first port");
+        require_e(routing.getTrackPort(TRACKS + 1), ==, 0, "unknown tracks use the first port");
+
+        routing.reset();
+        require_e(routing.getPortAmount(), ==, 1, "reset forgets ports in use");
+        require_e(routing.getNextChannel(), ==, 0, "reset starts over from the first channel");
+        require_e(routing.getTrackPort(TRACKS), ==, 0, "reset forgets track ports");
+    }
+
+    UNIT_TEST( TestSinglePort )
+    {
+        MidiRouting routing;
+        for (int n=0; n<15; n++)
+        {
+            require(not routing.isOutOfChannels(), "a single port has 15 melodic channels");
+            routing.advance();
+        }
+        require(routing.isOutOfChannels(), "channels are shared past 15 melodic tracks");
+        require_e(routing.getNextPort(),    ==, 0, "assignment starts over from the first port");
+        require_e(routing.getNextChannel(), ==, 0, "assignment starts over from the first channel");
+    }
+
+}
@@ -0,0 +1,90 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __MIDI_ROUTING_H__
+#define __MIDI_ROUTING_H__
+
+#include <vector>
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief Assigns the tracks of a song to (output port, channel) pairs
+      *
+      * A MIDI output only has 16 channels, one of which is for drums, so a song with more tracks than that
+      * needs more than one output. When channels are managed automatically, tracks get the channels of the
+      * first port, then of the next one, and so on up to the amount of ports the player can open; only when
+      * all of them are used do tracks start sharing channels. Drum tracks all go to the drum channel of the
+      * first port.
+      *
+      * Players that send events one by one (see PlatformMidiManager::seq_note_on and co.) receive the port
+      * along with the channel, as 'port*CHANNELS_PER_PORT + channel'.
+      *
+      * @ingroup midi
+      */
+    class MidiRouting
+    {
+        int m_max_ports;
+        int m_port_amount;
+        int m_next_port;
+        int m_next_channel;
+        bool m_out_of_channels;
+
+        /** port of each track of the jdksmidi multitrack (tracks past the end use port 0) */
+        std::vector<int> m_track_ports;
+
+    public:
+
+        static const int CHANNELS_PER_PORT = 16;
+        static const int DRUM_CHANNEL = 9;
+
+        /** @param maxPorts amount of output ports the player can send events to */
+        MidiRouting(const int maxPorts = 1);
+
+        /** @brief forget all assignments, the next track gets the first channel of the first port */
+        void reset();
+
+        /** @return the port the next track with a melodic instrument should use */
+        int getNextPort() const { return m_next_port; }
+
+        /** @return the channel the next track with a melodic instrument should use */
+        int getNextChannel() const { return m_next_channel; }
+
+        /** @brief the next (port, channel) pair was given to a track, move to the one after it */
+        void advance();
+
+        /**
+          * @return whether all channels of all ports were given to tracks, in which case the next
+          *         ones are shared with earlier tracks
+          */
+        bool isOutOfChannels() const { return m_out_of_channels; }
+
+        /** @brief set the port the events of a track of the jdksmidi multitrack are sent to */
+        void setTrackPort(const int track, const int port);
+
+        /** @return the port the events of a track of the jdksmidi multitrack are sent to */
+        int getTrackPort(const int track) const;
+
+        /** @return amount of ports used by the song (at least 1) */
+        int getPortAmount() const { return m_port_amount; }
+
+        int getMaxPorts() const { return m_max_ports; }
+    };
+
+}
+
+#endif
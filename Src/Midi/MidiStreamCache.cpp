@@ -0,0 +1,159 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Midi/MidiStreamCache.h"
+#include "UnitTest.h"
+
+#include "jdksmidi/msg.h"
+
+using namespace AriaMaestosa;
+
+// ----------------------------------------------------------------------------------------------------------
+
+MidiStreamCache::Key::Key()
+{
+    m_channel           = -1;
+    m_first_tick        = -1;
+    m_last_tick_in_song = -1;
+    m_volume            = -1;
+    m_drum              = false;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+MidiStreamCache::Key::Key(int channel, int firstTick, int lastTickInSong, int volume, bool drum)
+{
+    m_channel           = channel;
+    m_first_tick        = firstTick;
+    m_last_tick_in_song = lastTickInSong;
+    m_volume            = volume;
+    m_drum              = drum;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool MidiStreamCache::Key::operator==(const Key& other) const
+{
+    return m_channel           == other.m_channel           and
+           m_first_tick        == other.m_first_tick        and
+           m_last_tick_in_song == other.m_last_tick_in_song and
+           m_volume            == other.m_volume            and
+           m_drum              == other.m_drum;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+MidiStreamCache::MidiStreamCache()
+{
+    m_last_event_tick = 0;
+    m_dirty           = true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+jdksmidi::MIDITrack& MidiStreamCache::beginCompile(const Key& key)
+{
+    // keep the allocated events around, a recompiled track usually has about as many events as before
+    m_events.Clear();
+    m_key             = key;
+    m_last_event_tick = 0;
+    m_dirty           = true;
+    return m_events;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiStreamCache::endCompile(const int lastEventTick)
+{
+    m_last_event_tick = lastEventTick;
+    m_dirty           = false;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiStreamCache::copyTo(jdksmidi::MIDITrack* track) const
+{
+    ASSERT(not m_dirty);
+
+    const int count = m_events.GetNumEvents();
+    for (int n=0; n<count; n++)
+    {
+        if (not track->PutEvent( *m_events.GetEvent(n) ))
+        {
+            std::cerr << "Error adding midi event!" << std::endl;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestMidiStreamCache
+{
+
+    UNIT_TEST( TestCompileOnce )
+    {
+        const MidiStreamCache::Key key(3, 0, 9600, 100, false);
+
+        MidiStreamCache cache;
+        require(cache.isDirty(), "a new cache needs to be compiled");
+        require(not cache.isValidFor(key), "a new cache can't be used");
+
+        jdksmidi::MIDITrack& compiled = cache.beginCompile(key);
+        for (int n=0; n<100; n++)
+        {
+            jdksmidi::MIDITimedBigMessage m;
+            m.SetTime(n*96);
+            m.SetNoteOn(3, 60 + n % 12, 100);
+            compiled.PutEvent(m);
+        }
+        cache.endCompile(99*96);
+
+        require(cache.isValidFor(key), "compiled cache can be used with the same settings");
+        require_e(cache.getEventAmount(), ==, 100, "all events were kept");
+        require_e(cache.getLastEventTick(), ==, 99*96, "last event tick was kept");
+
+        require(not cache.isValidFor(MidiStreamCache::Key(4, 0, 9600, 100, false)),
+                "events compiled for another channel can't be used");
+        require(not cache.isValidFor(MidiStreamCache::Key(3, 960, 9600, 100, false)),
+                "events compiled from another starting point can't be used");
+        require(not cache.isValidFor(MidiStreamCache::Key(3, 0, 9600, 50, false)),
+                "events compiled with another track volume can't be used");
+
+        // each use appends the same events
+        jdksmidi::MIDITrack first, second;
+        cache.copyTo(&first);
+        cache.copyTo(&second);
+        cache.copyTo(&second);
+        require_e(first.GetNumEvents(), ==, 100, "events were copied");
+        require_e(second.GetNumEvents(), ==, 200, "events are appended to the track");
+        for (int n=0; n<100; n++)
+        {
+            require_e((int)first.GetEvent(n)->GetTime(), ==, n*96, "events are copied in order");
+            require_e((int)first.GetEvent(n)->GetNote(), ==, 60 + n % 12, "events are copied unchanged");
+            require_e((int)second.GetEvent(100 + n)->GetNote(), ==, 60 + n % 12, "events are copied unchanged");
+        }
+
+        // notes change : the owner invalidates and events are compiled again
+        cache.invalidate();
+        require(not cache.isValidFor(key), "invalidated cache can't be used");
+        cache.beginCompile(key);
+        cache.endCompile(0);
+        require(cache.isValidFor(key), "cache can be used after compiling again");
+        require_e(cache.getEventAmount(), ==, 0, "old events were dropped");
+    }
+
+}
@@ -0,0 +1,102 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __MIDI_STREAM_CACHE_H__
+#define __MIDI_STREAM_CACHE_H__
+
+#include "Utils.h"
+
+#include "jdksmidi/world.h"
+#include "jdksmidi/track.h"
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief Compiled note and controller events of a track, kept from one playback to the next
+      *
+      * Turning the notes and controllers of a track into MIDI events is the costly part of building the
+      * sequence given to the player, and most tracks did not change since the last time playback was
+      * started. The events are compiled once, then copied as-is until the owner calls 'invalidate'
+      * (whenever notes or controllers are added, removed or modified), or until they are requested with
+      * different settings (channel, starting point, end of song, track volume, drum mode), see 'Key'.
+      *
+      * @ingroup midi
+      */
+    class MidiStreamCache
+    {
+    public:
+
+        /** @brief settings the events are compiled with, other than the notes and controllers */
+        struct Key
+        {
+            int  m_channel;
+            int  m_first_tick;
+            int  m_last_tick_in_song;
+            int  m_volume;
+            bool m_drum;
+
+            Key();
+            Key(int channel, int firstTick, int lastTickInSong, int volume, bool drum);
+
+            bool operator==(const Key& other) const;
+        };
+
+    private:
+
+        jdksmidi::MIDITrack m_events;
+        Key  m_key;
+        int  m_last_event_tick;
+        bool m_dirty;
+
+    public:
+        LEAK_CHECK();
+
+        MidiStreamCache();
+
+        /** @brief mark the events as out of date, they will be compiled again on next use */
+        void invalidate() { m_dirty = true; }
+
+        bool isDirty() const { return m_dirty; }
+
+        /** @return whether the cached events can be used as they are for the given settings */
+        bool isValidFor(const Key& key) const { return not m_dirty and m_key == key; }
+
+        /**
+          * @brief empty the cache, to compile events again for the given settings
+          * @return the track to add compiled events to; call 'endCompile' when done
+          */
+        jdksmidi::MIDITrack& beginCompile(const Key& key);
+
+        /** @param lastEventTick tick of the last event that was compiled, as returned with the events */
+        void endCompile(const int lastEventTick);
+
+        /**
+          * @brief append the cached events at the end of the given track
+          * @pre   the cache is valid ('endCompile' was called, and not 'invalidate' since)
+          */
+        void copyTo(jdksmidi::MIDITrack* track) const;
+
+        /** @return tick of the last compiled event, as given to 'endCompile' */
+        int getLastEventTick() const { return m_last_event_tick; }
+
+        /** @return amount of cached events */
+        int getEventAmount() const { return m_events.GetNumEvents(); }
+    };
+
+}
+
+#endif
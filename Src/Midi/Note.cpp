@@ -18,6 +18,7 @@
 
 #include "IO/IOUtils.h"
 #include "Midi/Note.h"
+#include "Midi/NotePool.h"
 #include "Midi/Players/PlatformMidiManager.h"
 #include "Midi/Sequence.h"
 #include "Utils.h"
@@ -29,6 +30,37 @@
 
 using namespace AriaMaestosa;
 
+namespace
+{
+    /** amount of notes the pool makes room for each time it grows */
+    const int NOTES_PER_CHUNK = 1024;
+    
+    NotePool& getNotePool()
+    {
+        // never deleted : notes may still be freed while static objects are destroyed at exit
+        static NotePool* pool = new NotePool(sizeof(Note), NOTES_PER_CHUNK);
+        return *pool;
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void* Note::operator new(size_t size)
+{
+    ASSERT_E(size, ==, sizeof(Note));
+    return getNotePool().allocate();
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void Note::operator delete(void* ptr, size_t size)
+{
+    ASSERT_E(size, ==, sizeof(Note));
+    getNotePool().release(ptr);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
 Note::Note(Track* parent,
            const int pitchID_arg,
            const int startTick_arg,
@@ -160,6 +160,9 @@ namespace AriaMaestosa
     public:
         LEAK_CHECK();
         
+        /** @brief notes are allocated from a shared pool (see NotePool) rather than one by one on the heap */
+        static void* operator new(size_t size);
+        static void  operator delete(void* ptr, size_t size);
 
         void setSelected(const bool selected);
         bool isSelected() const { return m_selected; }
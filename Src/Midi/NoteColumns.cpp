@@ -0,0 +1,155 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Midi/NoteColumns.h"
+#include "UnitTest.h"
+
+#include <algorithm>
+
+using namespace AriaMaestosa;
+
+// ----------------------------------------------------------------------------------------------------------
+
+NoteColumns::NoteColumns()
+{
+    m_dirty = true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void NoteColumns::rebuild(const ptr_vector<Note>& notes)
+{
+    const int count = notes.size();
+    
+    m_tick.resize(count);
+    m_end_tick.resize(count);
+    m_pitch.resize(count);
+    m_volume.resize(count);
+    m_flags.resize(count);
+    
+    for (int n=0; n<count; n++)
+    {
+        const Note& note = notes[n];
+        m_tick[n]     = note.getTick();
+        m_end_tick[n] = note.getEndTick();
+        m_pitch[n]    = note.getPitchID();
+        m_volume[n]   = note.getVolume();
+        m_flags[n]    = (note.isSelected() ? FLAG_SELECTED : 0);
+    }
+    
+    m_dirty = false;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int NoteColumns::findFirstSelected() const
+{
+    ASSERT(not m_dirty);
+    
+    const int count = m_flags.size();
+    for (int n=0; n<count; n++)
+    {
+        if (m_flags[n] & FLAG_SELECTED) return n;
+    }
+    return -1;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestNoteColumns
+{
+    using namespace AriaMaestosa;
+    
+    UNIT_TEST( TestColumnsMatchNotes )
+    {
+        ptr_vector<Note> notes;
+        notes.push_back( new Note(NULL, 60, 0,   100, 80) );
+        notes.push_back( new Note(NULL, 64, 50,  300, 90) );
+        notes.push_back( new Note(NULL, 67, 200, 250, 100) );
+        notes[1].setSelected(true);
+        
+        NoteColumns columns;
+        require(columns.isDirty(), "new columns need to be built");
+        columns.rebuild(notes);
+        require(not columns.isDirty(), "columns were built");
+        
+        require_e(columns.size(), ==, 3, "one entry per note");
+        for (int n=0; n<3; n++)
+        {
+            require_e(columns.getTick(n),    ==, notes[n].getTick(),    "ticks match");
+            require_e(columns.getEndTick(n), ==, notes[n].getEndTick(), "end ticks match");
+            require_e(columns.getPitchID(n), ==, notes[n].getPitchID(), "pitches match");
+            require_e(columns.getVolume(n),  ==, notes[n].getVolume(),  "volumes match");
+            require_e(columns.isSelected(n), ==, notes[n].isSelected(), "selection matches");
+        }
+        require_e(columns.findFirstSelected(), ==, 1, "first selected note is found");
+        
+        // notes change : the owner invalidates and the columns are rebuilt
+        notes[1].setSelected(false);
+        notes.erase(0);
+        columns.invalidate();
+        columns.rebuild(notes);
+        require_e(columns.size(), ==, 2, "rebuilt columns reflect removal");
+        require_e(columns.getPitchID(0), ==, 64, "rebuilt columns are shifted");
+        require_e(columns.findFirstSelected(), ==, -1, "no note is selected anymore");
+    }
+    
+    /** reads the fields a renderer or exporter typically needs, through note objects */
+    long scanNotes(const ptr_vector<Note>& notes)
+    {
+        long checksum = 0;
+        const int count = notes.size();
+        for (int n=0; n<count; n++)
+        {
+            const Note& note = notes[n];
+            if (note.getPitchID() < 40 or note.getPitchID() > 100) continue;
+            checksum += note.getEndTick() - note.getTick() + (note.isSelected() ? note.getVolume() : 0);
+        }
+        return checksum;
+    }
+    
+    /** same as 'scanNotes', through the columns */
+    long scanColumns(const NoteColumns& columns)
+    {
+        long checksum = 0;
+        const int count = columns.size();
+        for (int n=0; n<count; n++)
+        {
+            if (columns.getPitchID(n) < 40 or columns.getPitchID(n) > 100) continue;
+            checksum += columns.getEndTick(n) - columns.getTick(n) + (columns.isSelected(n) ? columns.getVolume(n) : 0);
+        }
+        return checksum;
+    }
+    
+    UNIT_TEST( TestScanSameAsNotes )
+    {
+        const int NOTE_COUNT = 1000;
+        
+        ptr_vector<Note> notes;
+        for (int n=0; n<NOTE_COUNT; n++)
+        {
+            notes.push_back( new Note(NULL, n % 131, n*10, n*10 + 40, n % 128) );
+            if (n % 7 == 0) notes[n].setSelected(true);
+        }
+        
+        NoteColumns columns;
+        columns.rebuild(notes);
+        require_e(scanColumns(columns), ==, scanNotes(notes), "columns give the same results as notes");
+    }
+    
+}
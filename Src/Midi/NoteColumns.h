@@ -0,0 +1,83 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __NOTE_COLUMNS_H__
+#define __NOTE_COLUMNS_H__
+
+#include "ptr_vector.h"
+#include "Midi/Note.h"
+
+#include <vector>
+
+namespace AriaMaestosa
+{
+    
+    /**
+      * @brief Copy of the most used fields of the notes of a track, one contiguous array per field
+      *
+      * Notes themselves stay individual objects (actions keep pointers to them), but code that walks all
+      * the notes of a track reading only their tick, end tick, pitch, volume or selection can read these
+      * arrays instead and avoid following one pointer per note. Entry 'n' describes note 'n' of the
+      * vector the columns were built from (notes in start tick order).
+      *
+      * Like NoteRangeIndex, the columns do not observe the notes : the owner must call 'invalidate'
+      * whenever notes are added, removed, moved or (de)selected, and they are rebuilt lazily on next use.
+      *
+      * @ingroup midi
+      */
+    class NoteColumns
+    {
+        std::vector<int>            m_tick;
+        std::vector<int>            m_end_tick;
+        std::vector<short>          m_pitch;
+        std::vector<short>          m_volume;
+        std::vector<unsigned char>  m_flags;
+        bool m_dirty;
+        
+    public:
+        LEAK_CHECK();
+        
+        enum Flags
+        {
+            FLAG_SELECTED = 1
+        };
+        
+        NoteColumns();
+        
+        /** @brief mark the columns as out of date, they will be rebuilt on next use */
+        void invalidate() { m_dirty = true; }
+        
+        bool isDirty() const { return m_dirty; }
+        
+        /** @brief rebuild the columns from a vector of notes */
+        void rebuild(const ptr_vector<Note>& notes);
+        
+        int size() const { return m_tick.size(); }
+        
+        int   getTick      (const int n) const { return m_tick[n];     }
+        int   getEndTick   (const int n) const { return m_end_tick[n]; }
+        short getPitchID   (const int n) const { return m_pitch[n];    }
+        short getVolume    (const int n) const { return m_volume[n];   }
+        bool  isSelected   (const int n) const { return (m_flags[n] & FLAG_SELECTED) != 0; }
+        
+        /** @return index of the first selected note, or -1 if none is selected */
+        int findFirstSelected() const;
+    };
+    
+}
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Midi/NotePool.h"
+#include "UnitTest.h"
+#include "Utils.h"
+
+#include <set>
+
+using namespace AriaMaestosa;
+
+/** blocks are aligned on this boundary, enough for any member a note may have */
+static const size_t BLOCK_ALIGNMENT = 2*sizeof(void*);
+
+// ----------------------------------------------------------------------------------------------------------
+
+NotePool::NotePool(const size_t blockSize, const int blocksPerChunk)
+{
+    ASSERT_E(blocksPerChunk, >, 0);
+    
+    // each block must at least be able to hold the free list link when it is not used
+    const size_t size = (blockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : blockSize);
+    m_block_size       = (size + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+    m_blocks_per_chunk = blocksPerChunk;
+    m_used_blocks      = 0;
+    m_free             = NULL;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+NotePool::~NotePool()
+{
+    const int count = m_chunks.size();
+    for (int n=0; n<count; n++)
+    {
+        delete[] m_chunks[n];
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void NotePool::addChunk()
+{
+    char* chunk = new char[m_block_size*m_blocks_per_chunk];
+    m_chunks.push_back(chunk);
+    
+    // link the blocks in address order, so that consecutive allocations get consecutive blocks
+    for (int n=m_blocks_per_chunk-1; n>=0; n--)
+    {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + n*m_block_size);
+        block->m_next = m_free;
+        m_free = block;
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void* NotePool::allocate()
+{
+    wxMutexLocker lock(m_lock);
+    
+    if (m_free == NULL) addChunk();
+    
+    FreeBlock* block = m_free;
+    m_free = block->m_next;
+    m_used_blocks++;
+    return block;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void NotePool::release(void* ptr)
+{
+    if (ptr == NULL) return;
+    
+    wxMutexLocker lock(m_lock);
+    
+    ASSERT_E(m_used_blocks, >, 0);
+    
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->m_next = m_free;
+    m_free = block;
+    m_used_blocks--;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestNotePool
+{
+    using namespace AriaMaestosa;
+    
+    UNIT_TEST( TestAllocateAndRelease )
+    {
+        NotePool pool(24, 16);
+        
+        std::vector<char*> blocks;
+        std::set<char*> distinct;
+        for (int n=0; n<40; n++)
+        {
+            char* block = static_cast<char*>(pool.allocate());
+            require(((size_t)block) % BLOCK_ALIGNMENT == 0, "blocks are aligned");
+            blocks.push_back(block);
+            distinct.insert(block);
+        }
+        require_e((int)distinct.size(), ==, 40, "blocks are all different");
+        require_e(pool.getUsedBlockCount(), ==, 40, "used blocks are counted");
+        require_e(pool.getChunkCount(), ==, 3, "pool grew one chunk at a time");
+        require_e(blocks[1] - blocks[0], ==, 32, "blocks of a chunk are contiguous, in allocation order");
+        
+        // released blocks are given back before the pool grows again
+        pool.release(blocks[5]);
+        pool.release(blocks[20]);
+        require_e(pool.getUsedBlockCount(), ==, 38, "released blocks are counted");
+        require(pool.allocate() == blocks[20], "last released block is reused first");
+        require(pool.allocate() == blocks[5],  "released blocks are reused");
+        
+        for (int n=0; n<8; n++) pool.allocate();
+        require_e(pool.getChunkCount(), ==, 3, "free blocks were used before growing");
+        pool.allocate();
+        require_e(pool.getChunkCount(), ==, 4, "pool grows when full");
+    }
+    
+}
@@ -0,0 +1,80 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __NOTE_POOL_H__
+#define __NOTE_POOL_H__
+
+#include <stddef.h>
+#include <vector>
+#include <wx/thread.h>
+
+namespace AriaMaestosa
+{
+    
+    /**
+      * @brief Fixed-size block allocator, used to give memory to Note objects
+      *
+      * Blocks are carved out of large chunks, so notes created together (e.g. when importing a song, in
+      * time order) end up next to each other in memory, and walking the notes of a track touches few
+      * cache lines instead of jumping all over the heap. Freed blocks are kept in a free list and given
+      * back first; chunks are never returned to the system. The address of a block never changes, so
+      * pointers to notes (as kept by actions to be able to undo) stay valid.
+      *
+      * Allocation is protected by a mutex since notes may be created from worker threads (batch import).
+      *
+      * @ingroup midi
+      */
+    class NotePool
+    {
+        struct FreeBlock
+        {
+            FreeBlock* m_next;
+        };
+        
+        std::vector<char*> m_chunks;
+        FreeBlock* m_free;
+        
+        size_t m_block_size;
+        int    m_blocks_per_chunk;
+        int    m_used_blocks;
+        
+        wxMutex m_lock;
+        
+        void addChunk();
+        
+    public:
+        
+        /**
+          * @param blockSize      size of the objects to allocate, in bytes
+          * @param blocksPerChunk amount of objects to make room for each time the pool grows
+          */
+        NotePool(const size_t blockSize, const int blocksPerChunk);
+        ~NotePool();
+        
+        /** @return memory for one object of the size given to the constructor */
+        void* allocate();
+        
+        /** @brief give back memory obtained through 'allocate' */
+        void release(void* block);
+        
+        int getUsedBlockCount() const { return m_used_blocks;   }
+        int getChunkCount()     const { return m_chunks.size(); }
+    };
+    
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Midi/NoteRangeIndex.h"
+#include "UnitTest.h"
+
+#include <algorithm>
+
+using namespace AriaMaestosa;
+
+// ----------------------------------------------------------------------------------------------------------
+
+NoteRangeIndex::NoteRangeIndex()
+{
+    m_leaf_count = 0;
+    m_dirty      = true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void NoteRangeIndex::rebuild(const ptr_vector<Note>& notes)
+{
+    const int count = notes.size();
+    
+    m_leaf_count = 1;
+    while (m_leaf_count < count) m_leaf_count *= 2;
+    
+    // unused leaves get -1 so they are never reported (note end ticks are never negative)
+    m_max_end.assign(m_leaf_count*2, -1);
+    
+    for (int n=0; n<count; n++)
+    {
+        m_max_end[m_leaf_count + n] = notes[n].getEndTick();
+    }
+    for (int node=m_leaf_count-1; node>0; node--)
+    {
+        m_max_end[node] = std::max(m_max_end[node*2], m_max_end[node*2 + 1]);
+    }
+    
+    m_dirty = false;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int NoteRangeIndex::lowerBound(const ptr_vector<Note>& notes, const int tick)
+{
+    int low  = 0;
+    int high = notes.size();
+    while (low < high)
+    {
+        const int mid = low + (high - low)/2;
+        if (notes[mid].getTick() >= tick) high = mid;
+        else                              low = mid + 1;
+    }
+    return low;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void NoteRangeIndex::collect(const int node, const int nodeFrom, const int nodeTo, const int candidateCount,
+                             const int fromTick, std::vector<int>& out) const
+{
+    // skip subtrees that are entirely past the candidates, or where no note ends after 'fromTick'
+    if (nodeFrom >= candidateCount or m_max_end[node] <= fromTick) return;
+    
+    if (node >= m_leaf_count)
+    {
+        out.push_back(nodeFrom);
+        return;
+    }
+    
+    const int middle = (nodeFrom + nodeTo)/2;
+    collect(node*2,     nodeFrom, middle, candidateCount, fromTick, out);
+    collect(node*2 + 1, middle,   nodeTo, candidateCount, fromTick, out);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void NoteRangeIndex::findNotesInRange(const ptr_vector<Note>& notes, const int fromTick, const int toTick,
+                                      std::vector<int>& out) const
+{
+    ASSERT(not m_dirty);
+    ASSERT_E(notes.size(), <=, m_leaf_count);
+    
+    out.clear();
+    if (notes.size() == 0 or toTick <= fromTick) return;
+    
+    // only notes starting before 'toTick' can overlap; among them, keep those that end after 'fromTick'
+    const int candidateCount = lowerBound(notes, toTick);
+    collect(1, 0, m_leaf_count, candidateCount, fromTick, out);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestNoteRangeIndex
+{
+    
+    UNIT_TEST( TestOverlapQuery )
+    {
+        ptr_vector<Note> notes;
+        notes.push_back( new Note(NULL, 100, 0,   1000) ); // long held note
+        notes.push_back( new Note(NULL, 101, 10,  20  ) );
+        notes.push_back( new Note(NULL, 102, 30,  40  ) );
+        notes.push_back( new Note(NULL, 103, 35,  200 ) );
+        notes.push_back( new Note(NULL, 104, 300, 310 ) );
+        
+        NoteRangeIndex index;
+        require(index.isDirty(), "a new index needs to be built");
+        index.rebuild(notes);
+        require(not index.isDirty(), "index was built");
+        
+        std::vector<int> out;
+        index.findNotesInRange(notes, 38, 301, out);
+        require_e((int)out.size(), ==, 4, "overlapping notes were found");
+        require_e(out[0], ==, 0, "long note starting before the range is reported");
+        require_e(out[1], ==, 2, "notes are reported in start order");
+        require_e(out[2], ==, 3, "notes are reported in start order");
+        require_e(out[3], ==, 4, "note starting inside the range is reported");
+        
+        index.findNotesInRange(notes, 20, 30, out);
+        require_e((int)out.size(), ==, 1, "ranges are half-open");
+        require_e(out[0], ==, 0, "only the held note overlaps");
+        
+        index.findNotesInRange(notes, 1000, 2000, out);
+        require_e((int)out.size(), ==, 0, "no note overlaps past the end");
+        
+        require_e(NoteRangeIndex::lowerBound(notes, 35),  ==, 3, "lower bound is correct");
+        require_e(NoteRangeIndex::lowerBound(notes, 500), ==, 5, "lower bound is correct");
+    }
+    
+}
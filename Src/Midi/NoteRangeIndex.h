@@ -0,0 +1,81 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __NOTE_RANGE_INDEX_H__
+#define __NOTE_RANGE_INDEX_H__
+
+#include "ptr_vector.h"
+#include "Midi/Note.h"
+
+#include <vector>
+
+namespace AriaMaestosa
+{
+    
+    /**
+      * @brief Interval index over the notes of a track, answering "which notes overlap [fromTick, toTick)"
+      *
+      * The notes vector of a track is already sorted by start tick; this index augments it with an
+      * implicit segment tree holding the greatest end tick of each subtree, so that overlap queries run
+      * in O(log n + k) instead of scanning from the first note. The index does not observe the notes
+      * itself : the owner must call 'invalidate' whenever notes are added, removed or moved, and the
+      * tree is then rebuilt lazily on the next query.
+      *
+      * @ingroup midi
+      */
+    class NoteRangeIndex
+    {
+        /** 1-based implicit tree; leaves live in [m_leaf_count .. 2*m_leaf_count-1] */
+        std::vector<int> m_max_end;
+        int  m_leaf_count;
+        bool m_dirty;
+        
+        void collect(const int node, const int nodeFrom, const int nodeTo, const int candidateCount,
+                     const int fromTick, std::vector<int>& out) const;
+        
+    public:
+        LEAK_CHECK();
+        
+        NoteRangeIndex();
+        
+        /** @brief mark the index as out of date, it will be rebuilt on next use */
+        void invalidate() { m_dirty = true; }
+        
+        bool isDirty() const { return m_dirty; }
+        
+        /** @brief rebuild the index from a vector of notes sorted by start tick */
+        void rebuild(const ptr_vector<Note>& notes);
+        
+        /**
+          * @brief find all notes that overlap the range [fromTick, toTick)
+          * @param notes     the vector this index was last built from
+          * @param[out] out  receives the IDs of the overlapping notes, in start tick order
+          * @pre   the index is not dirty
+          */
+        void findNotesInRange(const ptr_vector<Note>& notes, const int fromTick, const int toTick,
+                              std::vector<int>& out) const;
+        
+        /**
+          * @return index of the first note in 'notes' whose start tick is greater than or equal
+          *         to 'tick' (binary search; does not require the index to be built)
+          */
+        static int lowerBound(const ptr_vector<Note>& notes, const int tick);
+    };
+    
+}
+
+#endif
@@ -4,12 +4,15 @@
 
 #include <glib.h>
 
+#include "Midi/MidiRouting.h"
 #include "Midi/Players/PlatformMidiManager.h"
 #include "Midi/Players/Alsa/AlsaNotePlayer.h"
 #include "Midi/Players/Alsa/AlsaPort.h"
 
 #include <alsa/asoundlib.h>
 
+#include "jdksmidi/msg.h"
+
 namespace AriaMaestosa
 {
 namespace AlsaPlayerStuff
@@ -44,11 +47,24 @@ int lastPlayedNote = -1, lastChannel;
 StopNoteTimer* stopNoteTimer = NULL;
 MidiContext* context_ref;
 
+/** @return amount of channels over all output ports of the Aria client */
+int channel_amount()
+{
+    return MidiRouting::CHANNELS_PER_PORT * context_ref->ports.size();
+}
+
+/** @brief send the event from the output port of the given song port (events of port 0 if it's not open) */
+void set_source_port(snd_seq_event_t* event, const int port)
+{
+    event->source = context_ref->address;
+    if (port > 0 and port < (int)context_ref->ports.size()) event->source.port = context_ref->ports[port];
+}
+
 void allSoundOff()
 {
     if (not sound_available) return;
 
-    for (int channel=0; channel<16; channel++)
+    for (int channel=0; channel<channel_amount(); channel++)
     {
         PlatformMidiManager::get()->seq_controlchange(0x78 /*120*/ /* all sound off */, 0, channel);
     }
@@ -58,7 +74,7 @@ void resetAllControllers()
 {
     if (not sound_available) return;
 
-    for (int channel=0; channel<16; channel++)
+    for (int channel=0; channel<channel_amount(); channel++)
     {
         seq_controlchange(0x78 /*120*/ /* all sound off */, 0, channel);
         seq_controlchange(0x79 /*121*/ /* reset controllers */, 0, channel);
@@ -142,11 +158,11 @@ void seq_note_on(const int note, const int volume, const int channel)
     snd_seq_ev_clear(&event);
 
     event.queue  = SND_SEQ_QUEUE_DIRECT;
-    event.source = context_ref->address;
+    set_source_port(&event, channel / MidiRouting::CHANNELS_PER_PORT);
 
     snd_seq_ev_set_subs(&event);
     snd_seq_ev_set_direct(&event);
-    snd_seq_ev_set_noteon(&event, channel, note, volume);
+    snd_seq_ev_set_noteon(&event, channel % MidiRouting::CHANNELS_PER_PORT, note, volume);
 
     snd_seq_event_output_direct(context_ref->sequencer, &event);
     snd_seq_drain_output(context_ref->sequencer);
@@ -160,11 +176,11 @@ void seq_note_off(const int note, const int channel)
     snd_seq_ev_clear(&event);
 
     event.queue  = SND_SEQ_QUEUE_DIRECT;
-    event.source = context_ref->address;
+    set_source_port(&event, channel / MidiRouting::CHANNELS_PER_PORT);
 
     snd_seq_ev_set_subs(&event);
     snd_seq_ev_set_direct(&event);
-    snd_seq_ev_set_noteoff(&event, channel, note, 0 /*velocity*/);
+    snd_seq_ev_set_noteoff(&event, channel % MidiRouting::CHANNELS_PER_PORT, note, 0 /*velocity*/);
 
     snd_seq_event_output_direct(context_ref->sequencer, &event);
     snd_seq_drain_output(context_ref->sequencer);
@@ -177,11 +193,11 @@ void seq_prog_change(const int instrumentID, const int channel)
     snd_seq_ev_clear(&event);
 
     event.queue  = SND_SEQ_QUEUE_DIRECT;
-    event.source = context_ref->address;
+    set_source_port(&event, channel / MidiRouting::CHANNELS_PER_PORT);
 
     snd_seq_ev_set_subs(&event);
     snd_seq_ev_set_direct(&event);
-    snd_seq_ev_set_pgmchange(&event, channel, instrumentID);
+    snd_seq_ev_set_pgmchange(&event, channel % MidiRouting::CHANNELS_PER_PORT, instrumentID);
 
     if (snd_seq_event_output_direct(context_ref->sequencer, &event) < 0)
     {
@@ -197,11 +213,11 @@ void seq_controlchange(const int controller, const int value, const int channel)
     snd_seq_ev_clear(&event);
 
     event.queue  = SND_SEQ_QUEUE_DIRECT;
-    event.source = context_ref->address;
+    set_source_port(&event, channel / MidiRouting::CHANNELS_PER_PORT);
 
     snd_seq_ev_set_subs(&event);
     snd_seq_ev_set_direct(&event);
-    snd_seq_ev_set_controller(&event, channel, controller, value);
+    snd_seq_ev_set_controller(&event, channel % MidiRouting::CHANNELS_PER_PORT, controller, value);
 
     if (snd_seq_event_output_direct(context_ref->sequencer, &event) < 0)
     {
@@ -217,16 +233,130 @@ void seq_pitch_bend(const int value, const int channel)
     snd_seq_ev_clear(&event);
 
     event.queue  = SND_SEQ_QUEUE_DIRECT;
-    event.source = context_ref->address;
+    set_source_port(&event, channel / MidiRouting::CHANNELS_PER_PORT);
 
     snd_seq_ev_set_subs(&event);
     snd_seq_ev_set_direct(&event);
-    snd_seq_ev_set_pitchbend(&event, channel, value);
+    snd_seq_ev_set_pitchbend(&event, channel % MidiRouting::CHANNELS_PER_PORT, value);
 
     snd_seq_event_output_direct(context_ref->sequencer, &event);
     snd_seq_drain_output(context_ref->sequencer);
 }
 
+// ----------------------------------------------------------
+// playback queue functions
+
+#if 0
+#pragma mark -
+#endif
+
+bool queue_start(const int ticksPerBeat, const int microsPerBeat)
+{
+    if (not sound_available or context_ref->queue < 0) return false;
+
+    snd_seq_queue_tempo_t* tempo;
+    snd_seq_queue_tempo_alloca(&tempo);
+    snd_seq_queue_tempo_set_ppq(tempo, ticksPerBeat);
+    snd_seq_queue_tempo_set_tempo(tempo, microsPerBeat);
+
+    if (snd_seq_set_queue_tempo(context_ref->sequencer, context_ref->queue, tempo) < 0)
+    {
+        return false;
+    }
+
+    // 'start' (as opposed to 'continue') rewinds the queue to tick 0
+    if (snd_seq_start_queue(context_ref->sequencer, context_ref->queue, NULL) < 0)
+    {
+        return false;
+    }
+    snd_seq_drain_output(context_ref->sequencer);
+    return true;
+}
+
+bool queue_event(const jdksmidi::MIDITimedBigMessage& ev, const unsigned int tick, const int port)
+{
+    snd_seq_event_t event;
+
+    snd_seq_ev_clear(&event);
+
+    set_source_port(&event, port);
+
+    snd_seq_ev_set_subs(&event);
+    snd_seq_ev_schedule_tick(&event, context_ref->queue, 0 /* absolute */, tick);
+
+    const int channel = ev.GetChannel();
+
+    if (ev.IsNoteOn())
+    {
+        snd_seq_ev_set_noteon(&event, channel, ev.GetNote(), ev.GetVelocity());
+    }
+    else if (ev.IsNoteOff())
+    {
+        snd_seq_ev_set_noteoff(&event, channel, ev.GetNote(), 0 /*velocity*/);
+    }
+    else if (ev.IsControlChange())
+    {
+        snd_seq_ev_set_controller(&event, channel, ev.GetController(), ev.GetControllerValue());
+    }
+    else if (ev.IsPitchBend())
+    {
+        snd_seq_ev_set_pitchbend(&event, channel, ev.GetBenderValue());
+    }
+    else if (ev.IsProgramChange())
+    {
+        snd_seq_ev_set_pgmchange(&event, channel, ev.GetPGValue());
+    }
+    else if (ev.IsTempo())
+    {
+        // addressed to the system timer, which changes the tempo of the queue when the event is due
+        snd_seq_ev_set_queue_tempo(&event, context_ref->queue, ev.GetTempo());
+    }
+    else
+    {
+        return false;
+    }
+
+    // when the output buffer is full, this call drains it (blocking until there is room in the kernel pool)
+    return snd_seq_event_output(context_ref->sequencer, &event) >= 0;
+}
+
+void queue_flush()
+{
+    snd_seq_drain_output(context_ref->sequencer);
+}
+
+bool queue_get_position(int* tick, int64_t* nanos)
+{
+    snd_seq_queue_status_t* status;
+    snd_seq_queue_status_alloca(&status);
+
+    if (snd_seq_get_queue_status(context_ref->sequencer, context_ref->queue, status) < 0)
+    {
+        return false;
+    }
+
+    const snd_seq_real_time_t* real_time = snd_seq_queue_status_get_real_time(status);
+    *tick  = snd_seq_queue_status_get_tick_time(status);
+    *nanos = (int64_t)real_time->tv_sec*1000000000 + real_time->tv_nsec;
+    return true;
+}
+
+void queue_stop()
+{
+    // events still in our output buffer
+    snd_seq_drop_output(context_ref->sequencer);
+
+    // events already handed to the kernel but not delivered yet
+    snd_seq_remove_events_t* remove;
+    snd_seq_remove_events_alloca(&remove);
+    snd_seq_remove_events_set_queue(remove, context_ref->queue);
+    snd_seq_remove_events_set_condition(remove, SND_SEQ_REMOVE_OUTPUT);
+    snd_seq_remove_events(context_ref->sequencer, remove);
+
+    snd_seq_stop_queue(context_ref->sequencer, context_ref->queue, NULL);
+    snd_seq_drain_output(context_ref->sequencer);
+}
+
 
 }
 }
@@ -2,6 +2,9 @@
 #define _alsa_midi_helper_
 
 #include <alsa/asoundlib.h>
+#include <stdint.h>
+
+namespace jdksmidi { class MIDITimedBigMessage; }
 
 namespace AriaMaestosa
 {
@@ -30,11 +33,35 @@ class MidiContext;
         void playNote(int noteNum, int volume, int duration, int channel, int instrument);
         void stopNote();
 
+        // channels 16 and up are those of the following output ports (see MidiRouting)
         void seq_note_on(const int note, const int volume, const int channel);
         void seq_note_off(const int note, const int channel);
         void seq_prog_change(const int instrumentID, const int channel);
         void seq_controlchange(const int controller, const int value, const int channel);
         void seq_pitch_bend(const int value, const int channel);
+        
+        /**
+          * @brief  Set up the resolution and initial tempo of the playback queue, and start it from tick 0
+          * @return false if the queue is not available, in which case direct output must be used
+          */
+        bool queue_start(const int ticksPerBeat, const int microsPerBeat);
+        
+        /**
+          * @brief  Schedule a channel or tempo event at the given tick on the playback queue, sent from
+          *         the given output port (see MidiRouting). Events are only buffered; call queue_flush
+          *         once the batch is complete.
+          * @return false if the event type is not handled
+          */
+        bool queue_event(const jdksmidi::MIDITimedBigMessage& ev, const unsigned int tick, const int port);
+        
+        /** @brief hand all buffered events over to the kernel sequencer */
+        void queue_flush();
+        
+        /** @brief get the current position of the playback queue in ticks and in nanoseconds since start */
+        bool queue_get_position(int* tick, int64_t* nanos);
+        
+        /** @brief drop all events not delivered yet and stop the playback queue */
+        void queue_stop();
     }
 }
 
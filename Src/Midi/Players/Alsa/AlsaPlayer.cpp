@@ -21,12 +21,16 @@
 #include "Midi/Players/Alsa/AlsaNotePlayer.h"
 #include "Midi/Players/Alsa/AlsaPort.h"
 #include "Midi/Players/Sequencer.h"
+#include "Midi/Players/SoftSynth/OfflineRenderer.h"
+#include "Midi/Players/SoftSynth/SoundFont.h"
 #include "IO/IOUtils.h"
 
 #include <alsa/asoundlib.h>
 
 #include "Midi/Players/PlatformMidiManager.h"
 #include "Midi/CommonMidiUtils.h"
+#include "Midi/MeasureData.h"
+#include "Midi/MidiRouting.h"
 #include "Midi/Sequence.h"
 #include "PreferencesData.h"
 #include "GUI/MainFrame.h"
@@ -34,9 +38,11 @@
 #include "IO/IOUtils.h"
 #include "Dialogs/WaitWindow.h"
 
+#include <algorithm>
 #include <iostream>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #include <wx/wx.h>
 #include <wx/utils.h>
@@ -98,15 +104,71 @@ namespace threads
 enum AudioExportEngine
 {
     FLUIDSYNTH = 0,
-    TIMIDITY = 1
+    TIMIDITY = 1,
+    BUILTIN_SYNTH = 2
 };
 
 wxString g_export_audio_filepath;
 AudioExportEngine g_export_engine;
 wxString g_fluisynth_soundfont;
 
+void export_audio_progress(int percent)
+{
+    MAKE_UPDATE_PROGRESSBAR_EVENT(event, percent);
+    getMainFrame()->GetEventHandler()->AddPendingEvent(event);
+}
+
+/** renders the sequence in-process with the built-in SoundFont synthesizer, no temporary MIDI file needed */
+void export_audio_builtin()
+{
+    wxString error;
+    
+    SoundFont font;
+    if (not font.loadFromFile(g_fluisynth_soundfont))
+    {
+        error = font.getError();
+    }
+    else
+    {
+        // like when exporting to MIDI, always start from the first measure
+        MeasureData* measures = g_sequence->getMeasureData();
+        const int firstMeasureValue = measures->getFirstMeasure();
+        measures->setFirstMeasure(0);
+        
+        jdksmidi::MIDIMultiTrack tracks;
+        int length = -1, start = -1, numTracks = -1;
+        makeJDKMidiSequence(g_sequence, tracks, false, &length, &start, &numTracks, false);
+        
+        measures->setFirstMeasure(firstMeasureValue);
+        
+        OfflineRenderer renderer(&font);
+        if (not renderer.renderToWav(&tracks, g_export_audio_filepath, &export_audio_progress))
+        {
+            error = renderer.getError();
+        }
+    }
+    
+    if (not error.IsEmpty())
+    {
+        std::cerr << "An error occured while exporting audio file : " << error.mb_str() << std::endl;
+        
+        MAKE_ASYNC_ERR_MESSAGE_EVENT(errorNotification);
+        errorNotification.SetString(_("An error occured while exporting audio file.") + wxT("\n") + error);
+        getMainFrame()->GetEventHandler()->AddPendingEvent(errorNotification);
+    }
+}
+
 void* export_audio_func( void *ptr )
 {
+    if (g_export_engine == BUILTIN_SYNTH)
+    {
+        export_audio_builtin();
+        
+        MAKE_HIDE_PROGRESSBAR_EVENT(event);
+        getMainFrame()->GetEventHandler()->AddPendingEvent(event);
+        return (void*)NULL;
+    }
+    
     // the file is exported to midi, and then we tell timidity to make it into wav
     wxString tempMidiFile = g_export_audio_filepath.BeforeLast('/') + wxT("/aria_temp_file.mid");
     
@@ -171,6 +233,15 @@ void* export_audio_func( void *ptr )
 
 
 
+/** How far ahead of the ALSA queue position events are scheduled when playing on the queue */
+const int64_t QUEUE_LOOKAHEAD_NS = 500*1000000LL;
+
+/** How often the sequencer thread wakes up to refill the ALSA queue, update the cursor and check for stop */
+const int QUEUE_POLL_PERIOD_MS = 10;
+
+/** Most output ports (of 16 channels each) a song is spread over, when the device has that many */
+const int MAX_OUTPUT_PORTS = 8;
+
 class SequencerThread : public wxThread
 {
     jdksmidi::MIDIMultiTrack* jdkmidiseq;
@@ -178,10 +249,12 @@ class SequencerThread : public wxThread
     int songLengthInTicks;
     bool selectionOnly;
     int m_start_tick;
+    MidiRouting m_routing;
     
 public:
     
-    SequencerThread(const bool selectionOnly)
+    SequencerThread(const bool selectionOnly) :
+        m_routing(std::min(context->getDevicePortAmount(), MAX_OUTPUT_PORTS))
     {
         jdkmidiseq = NULL;
         jdksequencer = NULL;
@@ -200,7 +273,8 @@ public:
         int trackAmount = -1;
         m_start_tick = 0;
         makeJDKMidiSequence(g_sequence, *jdkmidiseq, selectionOnly, &songLengthInTicks,
-                            &m_start_tick, &trackAmount, true /* for playback */);
+                            &m_start_tick, &trackAmount, true /* for playback */, &m_routing);
+        context->openPorts(m_routing.getPortAmount());
 
         //std::cout << "trackAmount=" << trackAmount << " start_tick=" << m_start_tick<<
         //        " songLengthInTicks=" << songLengthInTicks << std::endl;
@@ -223,10 +297,119 @@ public:
         Run();
     }
 
+    /**
+      * @return whether this playback can be scheduled on the ALSA queue. Recording (which plays a
+      *         metronome past the end of the song) and looping need the generic sequencer.
+      */
+    bool canUseQueue()
+    {
+        if (context->queue < 0) return false;
+        if (g_sequence->isLoopEnabled()) return false;
+        if (PlatformMidiManager::get()->isRecording()) return false;
+        return PreferencesData::getInstance()->getBoolValue(SETTING_ID_ALSA_QUEUED_PLAYBACK, true);
+    }
+
+    /**
+      * Plays the sequence by scheduling its events, with tick timestamps, on the ALSA queue a bit ahead of
+      * time. The kernel sequencer then delivers them, so timing does not depend on when this thread wakes up;
+      * the thread only refills the queue in batches and updates the playback cursor. Each event is sent from
+      * the output port of its track, all ports share the queue and are flushed together.
+      *
+      * @return false if the queue could not be started (nothing was played then)
+      */
+    bool playOnQueue()
+    {
+        PlatformMidiManager* manager = PlatformMidiManager::get();
+        const int beatLength = g_sequence->ticksPerQuarterNote();
+
+        int64_t micros_per_beat = 60000000 / std::max(1, g_sequence->getTempo());
+
+        jdksequencer->GoToTimeMs( 0 );
+        if (not AlsaPlayerStuff::queue_start(beatLength, micros_per_beat)) return false;
+
+        // start of the current tempo segment, used to know how far ahead of the queue each event is
+        jdksmidi::MIDIClockTime tempo_tick = 0;
+        int64_t tempo_ns = 0;
+
+        jdksmidi::MIDITimedBigMessage ev;
+        int ev_track;
+        jdksmidi::MIDIClockTime tick = 0;
+        jdksmidi::MIDIClockTime last_tick = 0;
+        bool more_events = true;
+
+        while (manager->seq_must_continue())
+        {
+            int queue_tick;
+            int64_t queue_ns;
+            if (not AlsaPlayerStuff::queue_get_position(&queue_tick, &queue_ns))
+            {
+                std::cerr << "[AlsaPlayer] failed to get queue status, stopping playback" << std::endl;
+                break;
+            }
+
+            // hand over every event due within the look-ahead window, then flush them as one batch
+            bool added = false;
+            while (more_events)
+            {
+                // like the generic sequencer, stop at the end of the song (e.g. the loop-end measure)
+                if (not jdksequencer->GetNextEventTime(&tick) or
+                    (songLengthInTicks >= 0 and (long)tick > (long)songLengthInTicks))
+                {
+                    more_events = false;
+                    break;
+                }
+
+                const int64_t event_ns = tempo_ns + (int64_t)(tick - tempo_tick)*micros_per_beat*1000/beatLength;
+                if (event_ns > queue_ns + QUEUE_LOOKAHEAD_NS) break;
+
+                if (not jdksequencer->GetNextEvent( &ev_track, &ev ))
+                {
+                    more_events = false;
+                    break;
+                }
+
+                if (ev.IsTempo())
+                {
+                    tempo_tick      = tick;
+                    tempo_ns        = event_ns;
+                    micros_per_beat = std::max<int64_t>(1, ev.GetTempo());
+                }
+
+                if (AlsaPlayerStuff::queue_event(ev, tick, m_routing.getTrackPort(ev_track))) added = true;
+                last_tick = tick;
+            }
+            if (added) AlsaPlayerStuff::queue_flush();
+
+            manager->seq_notify_current_tick(queue_tick);
+            manager->seq_notify_accurate_current_tick(queue_tick);
+
+            // done once the last scheduled event was delivered
+            if (not more_events and queue_tick >= (int)last_tick)
+            {
+                manager->seq_notify_current_tick(-1);
+                break;
+            }
+
+            wxThread::Sleep(QUEUE_POLL_PERIOD_MS);
+        }
+
+        AlsaPlayerStuff::queue_stop();
+
+        for (int c=0; c<MidiRouting::CHANNELS_PER_PORT*m_routing.getPortAmount(); c++)
+        {
+            AlsaPlayerStuff::seq_controlchange(123 /* all notes off */, 0, c);
+        }
+
+        return true;
+    }
+
     ExitCode Entry()
     {
-        AriaSequenceTimer timer(g_sequence);
-        timer.run(jdksequencer, songLengthInTicks);
+        if (not canUseQueue() or not playOnQueue())
+        {
+            AriaSequenceTimer timer(g_sequence);
+            timer.run(jdksequencer, songLengthInTicks, &m_routing);
+        }
 
         must_stop = true;
         cleanup_after_playback();
@@ -501,6 +684,11 @@ public:
         wxTextCtrl* m_soundfontTextCtrl;
         wxButton*   m_browseButton;
         
+        static bool usesSoundfont(AudioExportEngine engine)
+        {
+            return engine == FLUIDSYNTH or engine == BUILTIN_SYNTH;
+        }
+        
     public:
         AudioExportDialog(wxWindow* parent) : wxDialog(parent, wxID_ANY, _("Settings"), wxDefaultPosition, 
                                                        wxSize(460, 200), wxDEFAULT_DIALOG_STYLE|wxRESIZE_BORDER|wxCLOSE_BOX)
@@ -517,6 +705,7 @@ public:
             wxArrayString choices;
             choices.Add(wxT("FluidSynth"));
             choices.Add(wxT("TiMidity"));
+            choices.Add(_("Built-in synthesizer"));
             m_radioBox = new wxRadioBox(this, wxID_ANY, _("MIDI Engine"), wxDefaultPosition,
                                                   wxDefaultSize, choices, wxRA_SPECIFY_ROWS);
             m_radioBox->SetSelection(g_export_engine);
@@ -524,7 +713,7 @@ public:
             sizer->Add(m_radioBox, 0, wxEXPAND | wxALL, 5);
             sizer->AddStretchSpacer();
             
-            wxStaticText* soundfontLbl = new wxStaticText(this, wxID_ANY, _("Fluidsynth Soundfont"));
+            wxStaticText* soundfontLbl = new wxStaticText(this, wxID_ANY, _("Soundfont"));
             sizer->Add(soundfontLbl, 0, wxALL, 5);
             
             wxBoxSizer* soundFontSizer = new wxBoxSizer(wxHORIZONTAL);
@@ -540,7 +729,8 @@ public:
         
             sizer->AddStretchSpacer();
             
-            m_soundfontTextCtrl->Enable(g_export_engine == FLUIDSYNTH);
+            m_soundfontTextCtrl->Enable(usesSoundfont(g_export_engine));
+            m_browseButton->Enable(usesSoundfont(g_export_engine));
             
             wxButton* okBtn = new wxButton(this, wxID_OK, _("OK"));
             wxButton* cancelBtn = new wxButton(this, wxID_CANCEL, _("Cancel"));
@@ -575,7 +765,7 @@ public:
             
             //printf("-> %i\n", m_radioBox->GetSelection());
             g_export_engine = (AudioExportEngine)m_radioBox->GetSelection();
-            enable = (g_export_engine == FLUIDSYNTH);
+            enable = usesSoundfont(g_export_engine);
             m_soundfontTextCtrl->Enable(enable);
             m_browseButton->Enable(enable);
         }
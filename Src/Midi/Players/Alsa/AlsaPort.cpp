@@ -61,7 +61,11 @@ void MidiDevice::close()
     {
         snd_seq_unsubscribe_port(midiContext->sequencer, midiContext->subs);
         snd_seq_drop_output(midiContext->sequencer);
-        snd_seq_free_queue(midiContext->sequencer, midiContext->queue);
+        if (midiContext->queue >= 0)
+        {
+            snd_seq_free_queue(midiContext->sequencer, midiContext->queue);
+            midiContext->queue = -1;
+        }
         snd_seq_close(midiContext->sequencer);
     }
 }
@@ -363,6 +367,18 @@ void MidiContext::findDevices()
 
     address.client = snd_seq_client_id (sequencer);
     snd_seq_set_client_pool_output (sequencer, 1024);
+    
+    ports.clear();
+    ports.push_back(address.port);
+
+    // queue on which playback events are scheduled ahead of time, so that the kernel sequencer
+    // delivers them; when it can't be allocated, playback falls back to direct output
+    queue = snd_seq_alloc_named_queue(sequencer, "Aria Queue");
+    if (queue < 0)
+    {
+        std::cerr << "[AlsaPort] failed to allocate an ALSA queue, events will be sent directly" << std::endl;
+        queue = -1;
+    }
 
     destlist = g_array_new(0, 0, sizeof(snd_seq_addr_t));
 }
@@ -386,6 +402,53 @@ void MidiContext::setPlaying(bool playing)
 }
 
 
+int MidiContext::getDevicePortAmount()
+{
+    if (device == NULL) return 1;
+    
+    int amount = 1;
+    int index;
+    while (getDevice(device->client, device->port + amount, index) != NULL) amount++;
+    return amount;
+}
+
+
+void MidiContext::openPorts(const int amount)
+{
+    if (device == NULL) return;
+    
+    while ((int)ports.size() < amount)
+    {
+        const int n = ports.size();
+        
+        char name[32];
+        snprintf(name, 32, "Aria Port %i", n);
+        const int port = snd_seq_create_simple_port(sequencer, name,
+                                                    SND_SEQ_PORT_CAP_WRITE |
+                                                    SND_SEQ_PORT_CAP_SUBS_WRITE |
+                                                    SND_SEQ_PORT_CAP_READ,
+                                                    SND_SEQ_PORT_TYPE_APPLICATION);
+        if (port < 0)
+        {
+            std::cerr << "[AlsaPort] failed to create port " << n << ", its events will go to port 0" << std::endl;
+            return;
+        }
+        
+        // the device may have gone away since 'findDevices', then the port stays unconnected
+        int index;
+        const int destination = (getDevice(device->client, device->port + n, index) != NULL ?
+                                 device->port + n : device->port);
+        if (snd_seq_connect_to(sequencer, port, device->client, destination) < 0)
+        {
+            std::cerr << "[AlsaPort] failed to connect " << name << " to " << device->client << ":"
+                      << destination << std::endl;
+        }
+        
+        ports.push_back(port);
+    }
+}
+
+
 bool MidiContext::openDevice(MidiDevice* device)
 {
     MidiContext::device = device;
@@ -6,6 +6,7 @@
 #include "glib.h"
 #include <wx/string.h>
 #include "ptr_vector.h"
+#include <vector>
 
 #include "jdksmidi/world.h"
 #include "jdksmidi/track.h"
@@ -48,6 +49,9 @@ namespace AriaMaestosa
         int port;
         snd_seq_port_subscribe_t *subs;
         GArray  *destlist;
+        
+        /** ports of the Aria client; output port n of the song (see MidiRouting) is sent from ports[n] */
+        std::vector<int> ports;
 
         MidiContext();
         ~MidiContext();
@@ -59,6 +63,19 @@ namespace AriaMaestosa
 
         bool isPlaying();
         void setPlaying(bool playing);
+        
+        /**
+          * @return amount of writable ports of the opened device's client that follow each other from the
+          *         opened port (e.g. a synth with one port per 16 channels), i.e. how many output ports
+          *         a song can use without channels colliding
+          */
+        int getDevicePortAmount();
+        
+        /**
+          * @brief make sure the Aria client has the given amount of output ports; port n is connected to
+          *        the n-th port of the device from the opened one
+          */
+        void openPorts(const int amount);
 
         void  findDevices ();
         int getDeviceAmount();
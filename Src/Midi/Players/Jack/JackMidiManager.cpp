@@ -6,8 +6,10 @@
 #include <memory>
 #include <exception>
 #include <cassert>
+#include <vector>
 #include <stdint.h>
-#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <jack/jack.h>
 #include <jack/midiport.h>
 #include <wx/wx.h>
@@ -15,193 +17,296 @@
 #include <jdksmidi/multitrack.h>
 #include <jdksmidi/sequencer.h>
 #include "Midi/CommonMidiUtils.h"
+#include "Midi/MidiRouting.h"
 #include "Midi/Sequence.h"
 #include "Midi/Players/PlatformMidiManager.h"
+#include "PreferencesData.h"
 
 
-struct ScopedLocker
+// one event of a pre-rendered song. meta events are kept (with length 0) because they
+// still mark tick/frame correspondences, e.g. at tempo changes.
+struct RenderedEvent
 {
-	~ScopedLocker()
-	{
-		pthread_mutex_unlock(m_mutex);
-	}
-
-	ScopedLocker(pthread_mutex_t* m): m_mutex(m)
-	{
-		if(pthread_mutex_lock(m_mutex) != 0)
-			throw std::exception();
-	}
+	uint64_t frame;
+	uint32_t tick;
+	uint8_t port;
+	uint8_t length;
+	uint8_t data[3];
+};
 
-	private:
-		pthread_mutex_t* m_mutex;
+struct RenderedSong
+{
+	std::vector<RenderedEvent> events; // sorted by frame
+	unsigned generation;
 };
 
 class PrivateJackMidiPlayer
 {
 public:
 	// note:
-	//     0. do not use new, delete, file i/o syscalls, etc. while _mutex is
-	//        being locked.
-	//     1. be careful of priority inversion because handleJack() is running
-	//        on the high priority thread.
+	//     0. handleJack() runs on the realtime thread. it never locks, allocates
+	//        or seeks; songs are rendered beforehand into a flat event array and
+	//        handed over through atomic pointer exchanges:
+	//          - m_pending: published by play(), taken by handleJack().
+	//          - m_retired: the song handleJack() stopped using, deleted by
+	//            the control thread. handleJack() only takes a new song once
+	//            this slot is empty, so nothing is ever freed on the RT thread.
+	//     1. all other member functions must be called from a single (control)
+	//        thread.
+	//     2. output ports are only ever added, never removed: the control thread
+	//        registers a port, then publishes the new port count. each cycle,
+	//        handleJack() writes every event of the period into the buffer of its
+	//        port.
+
+	static const int MAX_PORTS = 8;
 
 	~PrivateJackMidiPlayer()
 	{
 		jack_client_close(m_jack);
-		pthread_cond_destroy(&m_finish);
-		pthread_mutex_destroy(&m_mutex);
-		delete m_sequencer;
+		delete m_current;
+		delete m_pending;
+		delete m_retired;
 	}
 
-	PrivateJackMidiPlayer(): m_playing(false), m_frame(0), m_sequencer(0)
+	// 'portCount' output ports are registered right away, so they can be connected before playing
+	PrivateJackMidiPlayer(int portCount):
+		m_port_count(0), m_pending(0), m_retired(0), m_generation(0), m_finished_generation(0), m_tick(0),
+		m_current(0), m_cursor(0), m_frame(0)
 	{
-		pthread_mutexattr_t mattr;
-		pthread_mutexattr_init(&mattr);
-		pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
-		if(pthread_mutex_init(&m_mutex, &mattr) != 0)
+		m_jack = jack_client_open("aria_maestosa", JackNullOption, NULL);
+		if(m_jack == 0)
 			throw std::exception();
-		pthread_mutexattr_destroy(&mattr);
 		try
 		{
-			if(pthread_cond_init(&m_finish, NULL) != 0)
+			jack_set_process_callback(m_jack, &handleJack, this);
+			if(!addPorts(std::max(1, portCount)))
+				throw std::exception();
+			if(jack_activate(m_jack) != 0)
 				throw std::exception();
-			try
-			{
-				m_jack = jack_client_open("aria_maestosa", JackNullOption, NULL);
-				if(m_jack == 0)
-					throw std::exception();
-				try
-				{
-					jack_set_process_callback(m_jack, &handleJack, this);
-					m_port = jack_port_register(
-						m_jack, "midi_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0
-					);
-					if(m_port == 0)
-						throw std::exception();
-					if(jack_activate(m_jack) != 0)
-						throw std::exception();
-				}
-				catch(...)
-				{
-					jack_client_close(m_jack);
-					throw;
-				}
-			}
-			catch(...)
-			{
-				pthread_cond_destroy(&m_finish);
-				throw;
-			}
 		}
 		catch(...)
 		{
-			pthread_mutex_destroy(&m_mutex);
+			jack_client_close(m_jack);
 			throw;
 		}
 	}
 
-	void play(jdksmidi::MIDIMultiTrack* tracks, uint64_t frame = 0)
+	// the tracks are copied into the rendered song, they need not outlive the playback.
+	// without routing, all tracks go to the first port.
+	void play(jdksmidi::MIDIMultiTrack* tracks, const AriaMaestosa::MidiRouting* routing = 0)
 	{
-		jdksmidi::MIDISequencer* tmp = new jdksmidi::MIDISequencer(tracks);
-		{
-			ScopedLocker lock(&m_mutex);
-			std::swap(tmp, m_sequencer);
-			m_frame = frame;
-			m_playing = true;
-		}
-		delete tmp;
+		if (routing != 0)
+			addPorts(routing->getPortAmount());
+		publish(render(tracks, routing, jack_get_sample_rate(m_jack)));
 	}
 
-	uint64_t stop()
+	int getPortCount()
 	{
-		ScopedLocker lock(&m_mutex);
-		m_playing = false;
-		return m_frame;
+		return m_port_count;
+	}
+
+	void stop()
+	{
+		publish(new RenderedSong());
 	}
 
 	void wait()
 	{
-		ScopedLocker lock(&m_mutex);
-		if(m_playing)
+		while(isPlaying())
 		{
-			pthread_cond_wait(&m_finish, &m_mutex);
+			// the RT thread only picks up a pending song once the previous one was reclaimed
+			reclaim();
+			usleep(1000);
 		}
+		reclaim();
 	}
 
 	bool isPlaying()
 	{
-		ScopedLocker lock(&m_mutex);
-		return m_playing;
+		return __atomic_load_n(&m_finished_generation, __ATOMIC_ACQUIRE) != m_generation;
 	}
 
 	int getTick()
 	{
-		ScopedLocker lock(&m_mutex);
-		assert(m_sequencer != 0);
-		return m_sequencer->GetCurrentMIDIClockTime();
+		reclaim();
+		return __atomic_load_n(&m_tick, __ATOMIC_RELAXED);
 	}
 	
 	private:
+		// register output ports until there are 'count' of them. ports past the
+		// first one are named midi_out_2, midi_out_3...
+		bool addPorts(int count)
+		{
+			while (m_port_count < std::min(count, int(MAX_PORTS)))
+			{
+				char name[32];
+				if (m_port_count == 0)
+					snprintf(name, sizeof(name), "midi_out");
+				else
+					snprintf(name, sizeof(name), "midi_out_%d", m_port_count + 1);
+
+				jack_port_t* port = jack_port_register(
+					m_jack, name, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0
+				);
+				if(port == 0)
+					return false;
+
+				m_ports[m_port_count] = port;
+				__atomic_store_n(&m_port_count, m_port_count + 1, __ATOMIC_RELEASE);
+			}
+			return true;
+		}
+
+		void publish(RenderedSong* song)
+		{
+			reclaim();
+			song->generation = ++m_generation;
+
+			// a song that was published but never picked up is simply replaced
+			RenderedSong* unplayed = __atomic_exchange_n(&m_pending, song, __ATOMIC_ACQ_REL);
+			delete unplayed;
+		}
+
+		// delete the song the RT thread is done with, if any
+		void reclaim()
+		{
+			RenderedSong* old = __atomic_exchange_n(&m_retired, (RenderedSong*)0, __ATOMIC_ACQ_REL);
+			delete old;
+		}
+
+		static RenderedSong* render(jdksmidi::MIDIMultiTrack* tracks, const AriaMaestosa::MidiRouting* routing,
+		                            unsigned srate)
+		{
+			RenderedSong* song = new RenderedSong();
+
+			jdksmidi::MIDISequencer sequencer(tracks);
+			sequencer.GoToTimeMs(0);
+
+			double t;
+			while (sequencer.GetNextEventTimeMs(&t))
+			{
+				int trackId;
+				jdksmidi::MIDITimedBigMessage msg;
+				if (!sequencer.GetNextEvent(&trackId, &msg))
+					break;
+
+				RenderedEvent ev;
+				ev.frame = uint64_t(t * (srate / 1000.0));
+				ev.tick = msg.GetTime();
+				ev.port = (routing != 0 ? routing->getTrackPort(trackId) : 0);
+				ev.length = 0;
+
+				if (not msg.IsMetaEvent())
+				{
+					unsigned l = msg.GetLength();
+					assert(l < 4);
+					ev.length = l;
+					ev.data[0] = msg.GetStatus();
+					ev.data[1] = msg.GetByte1();
+					ev.data[2] = msg.GetByte2();
+				}
+				song->events.push_back(ev);
+			}
+
+			return song;
+		}
+
 		static int handleJack(jack_nframes_t nFrame, void* selfv)
 		{
 			PrivateJackMidiPlayer* self = reinterpret_cast<PrivateJackMidiPlayer*>(selfv);
-			unsigned srate = jack_get_sample_rate(self->m_jack);
-			void* buf = jack_port_get_buffer(self->m_port, nFrame);
-			jack_midi_clear_buffer(buf);
 
-			ScopedLocker lock(&self->m_mutex);
-			if (self->m_playing)
+			// every port is cleared each cycle, even when it gets no event
+			const int portCount = __atomic_load_n(&self->m_port_count, __ATOMIC_ACQUIRE);
+			void* bufs[MAX_PORTS];
+			for (int p = 0; p < portCount; ++p)
 			{
-				// [bgn, end)
-				double bgn = self->m_frame * (1000.0 / srate);
-				double end = (self->m_frame + nFrame) * (1000.0 / srate);
-
-				self->m_sequencer->GoToTimeMs(bgn);
+				bufs[p] = jack_port_get_buffer(self->m_ports[p], nFrame);
+				jack_midi_clear_buffer(bufs[p]);
+			}
 
-				float t;
-				while (self->m_sequencer->GetNextEventTimeMs(&t) && t < end)
+			// switch to a newly published song, once the control thread has reclaimed the previous one
+			if (__atomic_load_n(&self->m_retired, __ATOMIC_ACQUIRE) == 0)
+			{
+				RenderedSong* song = __atomic_exchange_n(&self->m_pending, (RenderedSong*)0, __ATOMIC_ACQ_REL);
+				if (song != 0)
 				{
-					int trackId;
-					jdksmidi::MIDITimedBigMessage msg;
-					self->m_sequencer->GetNextEvent(&trackId, &msg);
+					__atomic_store_n(&self->m_retired, self->m_current, __ATOMIC_RELEASE);
+					self->m_current = song;
+					self->m_cursor = 0;
+					self->m_frame = 0;
+				}
+			}
+
+			const RenderedSong* song = self->m_current;
+			if (song == 0)
+				return 0;
 
-					if (not msg.IsMetaEvent())
+			// [bgn, end)
+			const uint64_t bgn = self->m_frame;
+			const uint64_t end = bgn + nFrame;
+			const RenderedEvent* events = song->events.empty() ? 0 : &song->events[0];
+			const size_t count = song->events.size();
+
+			size_t cursor = self->m_cursor;
+			while (cursor < count && events[cursor].frame < end)
+			{
+				const RenderedEvent& ev = events[cursor];
+				if (ev.length > 0)
+				{
+					// a port that could not be registered falls back to the first one
+					void* buf = bufs[ev.port < portCount ? ev.port : 0];
+					uint8_t* data = jack_midi_event_reserve(buf, ev.frame - bgn, ev.length);
+					if (data != 0)
 					{
-						unsigned l = msg.GetLength();
-						assert(l < 4);
-						uint8_t* ev = jack_midi_event_reserve(
-							buf, int(t * (srate / 1000.0)) - self->m_frame, l
-						);
-						ev[0] = msg.GetStatus();
-						if(l >= 2)
-						{
-							ev[1] = msg.GetByte1();
-						}
-						if(l >= 3)
-						{
-							ev[2] = msg.GetByte2();
-						}
+						for (unsigned n = 0; n < ev.length; ++n)
+							data[n] = ev.data[n];
 					}
 				}
-				self->m_frame += nFrame;
+				++cursor;
+			}
+			self->m_cursor = cursor;
+			self->m_frame = end;
 
-				if(!self->m_sequencer->GetNextEventTimeMs(&t))
-				{
-					self->m_playing = false;
-					pthread_cond_signal(&self->m_finish);
-				}
+			// between two consecutive events the tempo is constant, so the tick is linear in frames
+			uint64_t prevFrame = 0;
+			uint32_t tick = 0;
+			if (cursor > 0)
+			{
+				prevFrame = events[cursor - 1].frame;
+				tick = events[cursor - 1].tick;
+			}
+			if (cursor < count && events[cursor].frame > prevFrame && events[cursor].tick > tick)
+			{
+				const RenderedEvent& next = events[cursor];
+				tick += uint32_t(uint64_t(next.tick - tick) * (end - prevFrame) / (next.frame - prevFrame));
+			}
+			__atomic_store_n(&self->m_tick, int(tick), __ATOMIC_RELAXED);
+
+			if (cursor >= count)
+			{
+				__atomic_store_n(&self->m_finished_generation, song->generation, __ATOMIC_RELEASE);
 			}
 
 			return 0;
 		}
 
 		jack_client_t* m_jack;
-		jack_port_t* m_port;
-		bool m_playing;
+
+		// written by the control thread only, see note 2.
+		jack_port_t* m_ports[MAX_PORTS];
+		int m_port_count;
+
+		// shared between the control thread and the RT thread, only accessed atomically
+		RenderedSong* m_pending;
+		RenderedSong* m_retired;
+		unsigned m_generation; // written by the control thread only
+		unsigned m_finished_generation;
+		int m_tick;
+
+		// only used by the RT thread
+		RenderedSong* m_current;
+		size_t m_cursor;
 		uint64_t m_frame;
-		jdksmidi::MIDISequencer* m_sequencer;
-		pthread_mutex_t m_mutex;
-		pthread_cond_t m_finish;
 };
 
 
@@ -211,13 +316,25 @@ class JackMidiPlayer : public PlatformMidiManager
 {
 	std::auto_ptr<PrivateJackMidiPlayer> player;
 	std::auto_ptr<jdksmidi::MIDIMultiTrack> tracks;
+	MidiRouting routing;
 
 public:
 
+	JackMidiPlayer() : routing(1)
+	{
+	}
+
 	virtual void initMidiPlayer()
 	{
         printf("Initializing JACK Midi Driver\n");
-		player.reset(new PrivateJackMidiPlayer());
+
+		// extra ports are only used when the user asked for them : tracks routed to a port
+		// nothing is connected to would play silently
+		const long portCount = PreferencesData::getInstance()->getIntValue(SETTING_ID_JACK_OUTPUT_PORTS);
+		const int ports = std::max(1, std::min(int(portCount), int(PrivateJackMidiPlayer::MAX_PORTS)));
+
+		player.reset(new PrivateJackMidiPlayer(ports));
+		routing = MidiRouting(ports);
 	}
 
 	virtual void freeMidiPlayer()
@@ -235,18 +352,25 @@ public:
     
 	void resetSync()
 	{
-		jdksmidi::MIDIMultiTrack tracks(1);
+		// one track per port, each turning off the notes of its port
+		const int portCount = player->getPortCount();
+		MidiRouting allPorts(PrivateJackMidiPlayer::MAX_PORTS);
+		jdksmidi::MIDIMultiTrack tracks(portCount);
 		tracks.SetClksPerBeat(960);
-		for (int ch = 0; ch < 16; ++ch)
+		for (int port = 0; port < portCount; ++port)
 		{
-			jdksmidi::MIDITimedBigMessage msg;
-			msg.SetTime(0);
-			msg.SetAllNotesOff(ch);
-			tracks.GetTrack(0)->PutEvent(msg);
+			allPorts.setTrackPort(port, port);
+			for (int ch = 0; ch < 16; ++ch)
+			{
+				jdksmidi::MIDITimedBigMessage msg;
+				msg.SetTime(0);
+				msg.SetAllNotesOff(ch);
+				tracks.GetTrack(port)->PutEvent(msg);
+			}
 		}
 
-		player->play(&tracks);
-		player->wait(); // finish playing before destroying tracks.
+		player->play(&tracks, &allPorts);
+		player->wait(); // make sure all notes are off before anything else is played.
 	}
 
 	virtual void playNote(int note, int vel, int dur, int ch, int inst)
@@ -282,8 +406,8 @@ public:
 		int len = -1;
 		int nTrack = -1;
 		tracks.reset(new jdksmidi::MIDIMultiTrack());
-		makeJDKMidiSequence(seq, *tracks, false, &len, startTick, &nTrack, true);
-		player->play(tracks.get());
+		makeJDKMidiSequence(seq, *tracks, false, &len, startTick, &nTrack, true, &routing);
+		player->play(tracks.get(), &routing);
 
         m_start_tick = *startTick;
 		return true;
@@ -296,8 +420,8 @@ public:
 		int len = -1;
 		int nTrack = -1;
 		tracks.reset(new jdksmidi::MIDIMultiTrack());
-		makeJDKMidiSequence(seq, *tracks, true, &len, startTick, &nTrack, true);
-		player->play(tracks.get());
+		makeJDKMidiSequence(seq, *tracks, true, &len, startTick, &nTrack, true, &routing);
+		player->play(tracks.get(), &routing);
 
         m_start_tick = *startTick;
         
@@ -0,0 +1,198 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Midi/Players/MidiInputRing.h"
+#include "UnitTest.h"
+#include "Utils.h"
+
+#include <wx/thread.h>
+
+using namespace AriaMaestosa;
+
+// ----------------------------------------------------------------------------------------------------------
+
+MidiInputRing::MidiInputRing(const int capacityLog2)
+{
+    ASSERT_E(capacityLog2, >, 0);
+    ASSERT_E(capacityLog2, <, 31);
+
+    m_messages.resize(1 << capacityLog2);
+    m_mask    = (1 << capacityLog2) - 1;
+    m_write   = 0;
+    m_read    = 0;
+    m_dropped = 0;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool MidiInputRing::push(const RecordedMidiMessage& message)
+{
+    // the consumer may move 'm_read' forward meanwhile, which only makes more room
+    const unsigned int read = __atomic_load_n(&m_read, __ATOMIC_ACQUIRE);
+    if (m_write - read > m_mask)
+    {
+        __atomic_store_n(&m_dropped, m_dropped + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    m_messages[m_write & m_mask] = message;
+
+    // publish the message only once it was written
+    __atomic_store_n(&m_write, m_write + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool MidiInputRing::pop(RecordedMidiMessage& out)
+{
+    const unsigned int write = __atomic_load_n(&m_write, __ATOMIC_ACQUIRE);
+    if (write == m_read) return false;
+
+    out = m_messages[m_read & m_mask];
+
+    // give the slot back to the producer only once it was read
+    __atomic_store_n(&m_read, m_read + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void MidiInputRing::clear()
+{
+    __atomic_store_n(&m_write,   0, __ATOMIC_RELEASE);
+    __atomic_store_n(&m_read,    0, __ATOMIC_RELEASE);
+    __atomic_store_n(&m_dropped, 0, __ATOMIC_RELEASE);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+unsigned int MidiInputRing::getDroppedAmount() const
+{
+    return __atomic_load_n(&m_dropped, __ATOMIC_RELAXED);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestMidiInputRing
+{
+
+    RecordedMidiMessage makeMessage(const int n)
+    {
+        RecordedMidiMessage message;
+        message.m_time        = n / 1000.0;
+        message.m_coarse_tick = n;
+        message.m_bytes[0]    = 0x90;
+        message.m_bytes[1]    = n % 128;
+        message.m_bytes[2]    = (n / 128) % 128;
+        message.m_size        = 3;
+        return message;
+    }
+
+    UNIT_TEST( TestOrderAndOverflow )
+    {
+        MidiInputRing ring(3);
+        require_e(ring.getCapacity(), ==, 8, "capacity is a power of two");
+
+        RecordedMidiMessage out;
+        require(not ring.pop(out), "a new queue is empty");
+
+        // go around the buffer many times, with varying amounts of messages waiting
+        int pushed = 0;
+        int popped = 0;
+        for (int round=0; round<50; round++)
+        {
+            for (int n=0; n<round % 8 + 1; n++) require(ring.push(makeMessage(pushed++)), "queue has room");
+            while (ring.pop(out))
+            {
+                require_e(out.m_coarse_tick, ==, popped, "messages come out in order");
+                require_e((int)out.m_bytes[1], ==, popped % 128, "messages come out unchanged");
+                popped++;
+            }
+            require_e(popped, ==, pushed, "all messages came out");
+        }
+
+        for (int n=0; n<8; n++) require(ring.push(makeMessage(n)), "queue has room for its capacity");
+        require(not ring.push(makeMessage(8)), "a full queue refuses messages");
+        require(not ring.push(makeMessage(9)), "a full queue refuses messages");
+        require_e(ring.getDroppedAmount(), ==, 2u, "refused messages are counted");
+
+        require(ring.pop(out), "a full queue gives messages");
+        require_e(out.m_coarse_tick, ==, 0, "the oldest message is kept when the queue is full");
+        require(ring.push(makeMessage(10)), "a message taken out makes room");
+
+        ring.clear();
+        require(not ring.pop(out), "a cleared queue is empty");
+        require_e(ring.getDroppedAmount(), ==, 0u, "clearing forgets dropped messages");
+    }
+
+    UNIT_TEST( TestTwoThreads )
+    {
+        const int COUNT = 200000;
+        MidiInputRing ring(6);
+
+        class Producer : public wxThread
+        {
+            MidiInputRing* m_ring;
+        public:
+            int m_retries;
+
+            Producer(MidiInputRing* ring) : wxThread(wxTHREAD_JOINABLE), m_ring(ring), m_retries(0) {}
+            virtual ExitCode Entry()
+            {
+                for (int n=0; n<COUNT; n++)
+                {
+                    // the real MIDI thread drops the message instead, retry here to check they all arrive
+                    while (not m_ring->push(makeMessage(n)))
+                    {
+                        m_retries++;
+                        wxThread::Yield();
+                    }
+                }
+                return 0;
+            }
+        };
+
+        Producer producer(&ring);
+        producer.Create();
+        producer.Run();
+
+        RecordedMidiMessage out;
+        int popped = 0;
+        bool inOrder = true;
+        while (popped < COUNT)
+        {
+            if (not ring.pop(out))
+            {
+                wxThread::Yield();
+                continue;
+            }
+            if (out.m_coarse_tick != popped or out.m_bytes[1] != popped % 128 or
+                out.m_time != popped / 1000.0)
+            {
+                inOrder = false;
+            }
+            popped++;
+        }
+        producer.Wait();
+
+        require(inOrder, "messages go from one thread to the other unchanged and in order");
+        require(not ring.pop(out), "no message was duplicated");
+        require_e(ring.getDroppedAmount(), ==, (unsigned int)producer.m_retries, "full queue was detected");
+    }
+
+}
@@ -0,0 +1,93 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __MIDI_INPUT_RING_H__
+#define __MIDI_INPUT_RING_H__
+
+#include <vector>
+
+namespace AriaMaestosa
+{
+
+    /** @brief a MIDI message received while recording, with the time it was received at */
+    struct RecordedMidiMessage
+    {
+        /** time since recording started, in seconds, from the timestamps of the MIDI input */
+        double m_time;
+
+        /** tick the sequencer had reached when the message was received (late by up to one sequencer step) */
+        int m_coarse_tick;
+
+        unsigned char m_bytes[3];
+        unsigned char m_size;
+    };
+
+    /**
+      * @brief Lock-free queue of MIDI messages, from the MIDI input thread to the main thread
+      *
+      * There must be a single producer (the MIDI input callback, which calls 'push') and a single consumer
+      * (the main thread, which calls 'pop'). Neither ever waits for the other : the read and write positions
+      * are only ever written by one side, and published with release/acquire semantics. Both positions grow
+      * forever and are wrapped into the fixed-size buffer with a mask, so a full queue is told apart from an
+      * empty one without wasting a slot. When the consumer falls too far behind, new messages are dropped and
+      * counted instead of blocking the MIDI thread.
+      *
+      * @ingroup midi.players
+      */
+    class MidiInputRing
+    {
+        std::vector<RecordedMidiMessage> m_messages;
+        unsigned int m_mask;
+
+        /** written by the producer only; on its own cache line so both sides don't keep stealing it */
+        char m_padding1[64];
+        unsigned int m_write;
+        unsigned int m_dropped;
+
+        /** written by the consumer only */
+        char m_padding2[64];
+        unsigned int m_read;
+        char m_padding3[64];
+
+    public:
+
+        /** @param capacityLog2 the queue holds up to 2^capacityLog2 messages */
+        MidiInputRing(const int capacityLog2 = 14);
+
+        /**
+          * @brief add a message at the end of the queue (producer thread only)
+          * @return false if the queue was full, in which case the message is dropped
+          */
+        bool push(const RecordedMidiMessage& message);
+
+        /**
+          * @brief take the message at the front of the queue (consumer thread only)
+          * @return false if the queue was empty
+          */
+        bool pop(RecordedMidiMessage& out);
+
+        /** @brief empty the queue; neither thread may be using it meanwhile */
+        void clear();
+
+        /** @return amount of messages dropped because the queue was full, since the last 'clear' */
+        unsigned int getDroppedAmount() const;
+
+        int getCapacity() const { return m_messages.size(); }
+    };
+
+}
+
+#endif
@@ -20,6 +20,9 @@
 #include "Actions/AddControlEvent.h"
 #include "Actions/Record.h"
 #include "Midi/Players/PlatformMidiManager.h"
+#include "Midi/Sequence.h"
+#include "Midi/TempoMap.h"
+#include "Midi/Track.h"
 #include "PreferencesData.h"
 #include "ptr_vector.h"
 #include "Utils.h"
@@ -39,6 +42,9 @@ PlatformMidiManager::PlatformMidiManager()
 {
     m_recording = false;
     m_record_action = NULL;
+    m_record_time = 0.0;
+    m_record_time_offset = 0;
+    m_record_time_offset_known = false;
     m_playthrough = PreferencesData::getInstance()->getBoolValue(SETTING_ID_PLAYTHROUGH, true);
 }
 
@@ -145,24 +151,101 @@ void PlatformMidiManager::recordCallback(double deltatime, std::vector<unsigned
                                          void *userData)
 {
     // ---- this function is invoked from a thread!!
+    // Keep it short : the message is queued as is, it will be added to the track by the main thread
+    // (see 'processRecordQueue')
     
     PlatformMidiManager* self = (PlatformMidiManager*)userData;
     
     ASSERT( MAGIC_NUMBER_OK_FOR(*self) );
     
-    // self->m_open_notes
+    // RtMidi gives the time elapsed since the previous message, which is more accurate than the sequencer
+    // position (the sequencer only moves forward once per step)
+    self->m_record_time += deltatime;
+    
     unsigned int nBytes = message->size();
+    if (nBytes < 3) return;
+    
+    RecordedMidiMessage recorded;
+    recorded.m_time        = self->m_record_time;
+    recorded.m_coarse_tick = self->m_start_tick + self->getAccurateTick();
+    recorded.m_bytes[0]    = message->at(0);
+    recorded.m_bytes[1]    = message->at(1);
+    recorded.m_bytes[2]    = message->at(2);
+    recorded.m_size        = 3;
+    self->m_record_input.push(recorded);
+    
+    if (not self->m_playthrough) return;
+    
+    int messageType = message->at(0) & 0xF0;
+    int value = message->at(1);
+    int value2 = message->at(2);
+    
+    // FIXME: we are in a thread, not all players may be thread-safe!!
+    switch (messageType)
+    {
+        case 0x90: // NOTE ON
+        case 0x80: // NOTE OFF
+            if (messageType == 0x90 and value2 > 0)
+            {
+                self->seq_note_on(value, value2, self->m_record_target->getChannel());
+            }
+            else
+            {
+                self->seq_note_off(value, self->m_record_target->getChannel());
+            }
+            break;
+            
+        case 0xE0:
+            self->seq_pitch_bend((value | (value2 << 7)) - 8192, self->m_record_target->getChannel());
+            break;
+            
+        case 0xB0:
+            self->seq_controlchange(value, value2, self->m_record_target->getChannel());
+            break;
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int PlatformMidiManager::getRecordedTick(const RecordedMidiMessage& message)
+{
+    const TempoMap& tempoMap = m_record_target->getSequence()->getTempoMap();
+    const int64_t time_ns = (int64_t)(message.m_time * TempoMap::NANOS_PER_SEC);
+    const int64_t coarse_ns = tempoMap.tickToNanos(message.m_coarse_tick);
     
-    if (nBytes >= 3)
+    // The sequencer position is late by up to one sequencer step, so each message gives a lower bound of
+    // the song time at which recording started; the highest one seen so far is the best estimate. Start
+    // over if the estimate gets far ahead of the sequencer, in case both clocks drift apart.
+    const int64_t estimate = coarse_ns - time_ns;
+    if (not m_record_time_offset_known or estimate > m_record_time_offset or
+        time_ns + m_record_time_offset - coarse_ns > TempoMap::NANOS_PER_SEC/20)
     {
-        int messageType = message->at(0) & 0xF0;
-        int channel = message->at(0) & 0x0F;
-        int value = message->at(1);
-        int value2 = message->at(2);
+        m_record_time_offset = estimate;
+        m_record_time_offset_known = true;
+    }
+    
+    return tempoMap.nanosToTick(time_ns + m_record_time_offset);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void PlatformMidiManager::processRecordQueue()
+{
+    if (m_record_action == NULL) return;
+    
+    const int trackChannel = m_record_target->getChannel();
+    
+    RecordedMidiMessage message;
+    while (m_record_input.pop(message))
+    {
+        int messageType = message.m_bytes[0] & 0xF0;
+        int channel = message.m_bytes[0] & 0x0F;
+        int value = message.m_bytes[1];
+        int value2 = message.m_bytes[2];
         
         //printf("message %x on channel %i = %i %i\n", messageType, channel, value, value2);
         
-        int now_tick = self->m_start_tick + self->getAccurateTick();
+        int now_tick = getRecordedTick(message);
         
         switch (messageType)
         {
@@ -171,40 +254,24 @@ void PlatformMidiManager::recordCallback(double deltatime, std::vector<unsigned
                 if (messageType == 0x90 and value2 > 0)
                 {
                     // Note On
-                    
-                    //printf("NOTE ON on channel %i; note : %i velocity : %i\n", channel, value, value2);
-                    
-                    // FIXME: we are in a thread, not all players may be thread-safe!!
-                    if (self->m_playthrough) self->seq_note_on(value, value2, self->m_record_target->getChannel());
-                    
                     NoteInfo n = {now_tick, value2};
-                    self->m_open_notes[value] = n;
+                    m_open_notes[value] = n;
                 }
                 else
                 {
                     // Note off
-                    
-                    //printf("NOTE OFF on channel %i; note : %i velocity : %i\n", channel, value, value2);
-                    
-                    // FIXME: we are in a thread, not all players may be thread-safe!!
-                    if (self->m_playthrough) self->seq_note_off(value, self->m_record_target->getChannel());
-                    
-                    if (self->m_open_notes.find(value) != self->m_open_notes.end())
+                    std::map<int, NoteInfo>::iterator it = m_open_notes.find(value);
+                    if (it != m_open_notes.end())
                     {
-                        NoteInfo n = self->m_open_notes[value];
-                        self->m_open_notes.erase(value);
+                        NoteInfo n = it->second;
+                        m_open_notes.erase(it);
                         
-                        if (self->m_record_action != NULL)
-                        {
-                            wxMutexLocker lock(self->m_record_action_queue_lock);
-                            int channel = self->m_record_target->getChannel();
-                            // TODO: remove 131 - value old crap
-                            self->m_record_action_queue.push_back(new Action::AddNote((channel == 9 ? value : 131 - value),
-                                                                                      n.m_note_on_tick,
-                                                                                      now_tick,
-                                                                                      n.m_velocity,
-                                                                                      false));
-                        }
+                        // TODO: remove 131 - value old crap
+                        m_record_action->action(new Action::AddNote((trackChannel == 9 ? value : 131 - value),
+                                                                    n.m_note_on_tick,
+                                                                    now_tick,
+                                                                    n.m_velocity,
+                                                                    false));
                     }
                 }
                 break;
@@ -216,65 +283,19 @@ void PlatformMidiManager::recordCallback(double deltatime, std::vector<unsigned
             case 0xE0:
             {
                 float val = ControllerEvent::fromPitchBendValue((value | (value2 << 7)) - 8192);
-                
-                // FIXME: when is m_record_action null?
-                if (self->m_record_action != NULL)
-                {
-                    wxMutexLocker lock(self->m_record_action_queue_lock);
-                    self->m_record_action_queue.push_back(new Action::AddControlEvent(now_tick, val,
-                                                                                      PSEUDO_CONTROLLER_PITCH_BEND));
-                }
-                
-                // FIXME: we are in a thread, not all players may be thread-safe!!
-                if (self->m_playthrough) self->seq_pitch_bend((value | (value2 << 7)) - 8192,
-                                                              self->m_record_target->getChannel());
-
+                m_record_action->action(new Action::AddControlEvent(now_tick, val, PSEUDO_CONTROLLER_PITCH_BEND));
                 break;
             }
             case 0xB0:
-                if (self->m_record_action != NULL)
-                {
-                    wxMutexLocker lock(self->m_record_action_queue_lock);
-                    self->m_record_action_queue.push_back(new Action::AddControlEvent(now_tick,
-                                                                                      127 - value2 /* value */,
-                                                                                      value /* controller ID */));
-                }
-                
-                // FIXME: we are in a thread, not all players may be thread-safe!!
-                if (self->m_playthrough) self->seq_controlchange(value, value2,
-                                                                 self->m_record_target->getChannel());
-
-                
+                m_record_action->action(new Action::AddControlEvent(now_tick,
+                                                                    127 - value2 /* value */,
+                                                                    value /* controller ID */));
                 break;
                 
             default:
                 printf("UNKNOWN EVENT %x on channel %i; value : %i %i\n", messageType, channel, value, value2);
-
         }
     }
-    
-    /*
-    for ( unsigned int i=0; i<nBytes; i++ )
-        std::cout << "Byte " << i << " = " << (int)message->at(i) << ", ";
-    if ( nBytes > 0 )
-        std::cout << "stamp = " << deltatime << std::endl;
-     */
-}
-
-// ----------------------------------------------------------------------------------------------------------
-
-void PlatformMidiManager::processRecordQueue()
-{
-    if (m_record_action == NULL) return;
-    
-    // FIXME: this is a thread, and Sequence/Track are NOT thread-safe!!
-    wxMutexLocker lock(m_record_action_queue_lock);
-    const int count = m_record_action_queue.size();
-    for (int n=0; n<count; n++)
-    {
-        m_record_action->action(m_record_action_queue.get(n));
-    }
-    m_record_action_queue.clearWithoutDeleting();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -322,6 +343,10 @@ bool PlatformMidiManager::startRecording(wxString outputPort, Track* target)
     
     m_recording = true;
     m_record_action = new Action::Record();
+    m_record_input.clear();
+    m_record_time = 0.0;
+    m_record_time_offset_known = false;
+    m_open_notes.clear();
     
     // add the action to the action stack so it can be undone
     m_record_target->action(m_record_action);
@@ -367,9 +392,11 @@ void PlatformMidiManager::stopRecording()
     
     processRecordQueue();
     
-    // it's supposed to have been emptied already but who knows...
-    if (m_record_action_queue.size() > 0) fprintf(stderr, "Why is m_record_action_queue not empty??\n");
-    m_record_action_queue.clearWithoutDeleting();
+    if (m_record_input.getDroppedAmount() > 0)
+    {
+        fprintf(stderr, "[PlatformMidiManager] %u MIDI input messages were lost while recording\n",
+                m_record_input.getDroppedAmount());
+    }
     
     delete m_midi_input;
     m_midi_input = NULL;
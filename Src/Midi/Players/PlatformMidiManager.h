@@ -17,6 +17,7 @@
 #ifndef __PLATFORM_MIDI_MANAGER_H__
 #define __PLATFORM_MIDI_MANAGER_H__
 
+#include <stdint.h>
 #include <vector>
 #include <wx/string.h>
 #include <wx/arrstr.h>
@@ -24,6 +25,7 @@
 #include <map>
 
 #include "Actions/EditAction.h"
+#include "Midi/Players/MidiInputRing.h"
 #include "ptr_vector.h"
 #include "Utils.h"
 
@@ -91,9 +93,17 @@ namespace AriaMaestosa
         /** Used while recording */
         Action::Record* m_record_action;
         
-        ptr_vector<Action::SingleTrackAction> m_record_action_queue;
+        /** Messages received by the MIDI input thread, waiting to be added to the track by the main thread */
+        MidiInputRing m_record_input;
         
-        wxMutex m_record_action_queue_lock;
+        /** Time since recording started, from the MIDI input timestamps. Only used by the MIDI input thread. */
+        double m_record_time;
+        
+        /** Song time, in nanoseconds, at which recording started (estimated while messages arrive) */
+        int64_t m_record_time_offset;
+        bool m_record_time_offset_known;
+        
+        int getRecordedTick(const RecordedMidiMessage& message);
         
     public:
         
@@ -206,13 +216,16 @@ namespace AriaMaestosa
         
         /** This method should be called very regularly while recording, *from the main thread*,
           * so that the PlatformMidiManager can perform tasks that otherwise could not have been done
-          * from the MIDI record thread
+          * from the MIDI record thread. Takes all messages received since the last call and adds them
+          * to the track at once.
           */
         void processRecordQueue();
         
         virtual bool audioExportSetup() { return true; }
         
         // ---------- non-native sequencer interface ---------
+        // When the sequencer was given a MidiRouting using more than one output port, channels 16 and up
+        // are those of the following ports ('port*16 + channel', see MidiRouting).
         virtual void seq_note_on      (const int note, const int volume, const int channel)      { }
         virtual void seq_note_off     (const int note, const int channel)                        { }
         virtual void seq_prog_change  (const int instrument, const int channel)                  { }
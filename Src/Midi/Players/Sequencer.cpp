@@ -19,7 +19,9 @@
 #include "GUI/MainFrame.h"
 #include "Midi/Players/Sequencer.h"
 #include "Midi/CommonMidiUtils.h"
+#include "Midi/MidiRouting.h"
 #include "Midi/Sequence.h"
+#include "Midi/TempoMap.h"
 #include "Midi/Players/PlatformMidiManager.h"
 
 #include "jdksmidi/world.h"
@@ -28,6 +30,9 @@
 #include "jdksmidi/driver.h"
 #include "jdksmidi/process.h"
 
+#include <algorithm>
+#include <vector>
+
 // FIXME: the build system should check for them.
 #ifdef __WXMSW__
 #define HAVE_GETIMEOFDAY 0
@@ -37,12 +42,23 @@
 #define HAVE_FTIME 1
 #endif
 
+#if defined(__WXMSW__) || defined(__APPLE__)
+#define HAVE_CLOCK_NANOSLEEP 0
+#else
+#define HAVE_CLOCK_NANOSLEEP 1
+#endif
+
 #if HAVE_GETIMEOFDAY
 #include <sys/time.h>
 #else
 #include <sys/timeb.h>
 #endif
 
+#if HAVE_CLOCK_NANOSLEEP
+#include <errno.h>
+#include <time.h>
+#endif
+
 namespace AriaMaestosa
 {
 
@@ -130,23 +146,197 @@ class DummyTimer
     long time;
     public:
     void reset_and_start(){ time=0; }
+    void reset(){ time=0; }
     int get_elapsed_millis(){ time+=13; return time; }
 };
 typedef DummyTimer BasicTimer;
 
 #endif
 
+const int64_t NANOS_PER_MILLI = 1000000;
+const int64_t NANOS_PER_SEC   = 1000000000;
+
+/** How often the sequencer thread wakes up when no event is due, to poll for stop and update the cursor */
+const int64_t HOUSEKEEPING_PERIOD_NS = 10*NANOS_PER_MILLI;
+
+#if HAVE_CLOCK_NANOSLEEP
+
+/**
+  * Sleeps until absolute deadlines on the monotonic clock. Since deadlines are absolute, wake-up
+  * latency never accumulates, and the resolution is only limited by the kernel scheduler.
+  */
+class MonotonicClock
+{
+    int64_t m_start_ns;
+    
+    static int64_t now()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec*NANOS_PER_SEC + ts.tv_nsec;
+    }
+    
+public:
+    
+    void reset() { m_start_ns = now(); }
+    
+    int64_t getElapsedNanos() const { return now() - m_start_ns; }
+    
+    void sleepUntil(const int64_t elapsed_ns)
+    {
+        const int64_t deadline = m_start_ns + elapsed_ns;
+        
+        timespec ts;
+        ts.tv_sec  = deadline / NANOS_PER_SEC;
+        ts.tv_nsec = deadline % NANOS_PER_SEC;
+        
+        // if interrupted by a signal, simply resume sleeping; the deadline is absolute so nothing is lost
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    }
+};
+typedef MonotonicClock SequencerClock;
+
+#else
+
+/**
+  * Fallback for platforms without clock_nanosleep : sleeps in steps of at most 10 ms
+  * and measures time with the millisecond timer.
+  */
+class PollingClock
+{
+    BasicTimer m_timer;
+    
+public:
+    
+    void reset() { m_timer.reset_and_start(); }
+    
+    int64_t getElapsedNanos() { return (int64_t)m_timer.get_elapsed_millis()*NANOS_PER_MILLI; }
+    
+    void sleepUntil(const int64_t elapsed_ns)
+    {
+        const int64_t remaining_ms = (elapsed_ns - getElapsedNanos()) / NANOS_PER_MILLI;
+        wxThread::Sleep( (int)std::max<int64_t>(1, std::min<int64_t>(10, remaining_ms)) );
+    }
+};
+typedef PollingClock SequencerClock;
+
+#endif
+
+// ------------------------------------------------------------
+
+static bool tempoEventOrder(const jdksmidi::MIDITimedBigMessage* a, const jdksmidi::MIDITimedBigMessage* b)
+{
+    return a->GetTime() < b->GetTime();
+}
+
+/**
+  * Builds the tempo map of the sequence being played from the tempo events of the multitrack (rather
+  * than from the Sequence, since the multitrack may start at the playback start tick), so that each
+  * event deadline is computed exactly in integer nanoseconds from the start of its tempo segment
+  * instead of being accumulated in floating point.
+  */
+static void buildPlaybackTempoMap(TempoMap& map, const jdksmidi::MIDIMultiTrack* tracks,
+                                  const int initialBpm, const int beatLength)
+{
+    map.reset(initialBpm, beatLength);
+    
+    std::vector<const jdksmidi::MIDITimedBigMessage*> tempo_events;
+    const int trackAmount = tracks->GetNumTracks();
+    for (int t=0; t<trackAmount; t++)
+    {
+        const jdksmidi::MIDITrack* track = tracks->GetTrack(t);
+        const int eventAmount = track->GetNumEvents();
+        for (int e=0; e<eventAmount; e++)
+        {
+            const jdksmidi::MIDITimedBigMessage* msg = track->GetEvent(e);
+            if (msg->IsTempo()) tempo_events.push_back(msg);
+        }
+    }
+    std::stable_sort(tempo_events.begin(), tempo_events.end(), tempoEventOrder);
+    
+    const int tempoAmount = tempo_events.size();
+    for (int n=0; n<tempoAmount; n++)
+    {
+        // MIDI tempo is stored in microseconds per beat, so this is exact
+        map.addTempoChange(tempo_events[n]->GetTime(), (int64_t)tempo_events[n]->GetTempo()*1000);
+    }
+}
+
+// ------------------------------------------------------------
+
+void SequencerTimingStats::reset()
+{
+    event_count       = 0;
+    max_lateness_ns   = 0;
+    total_lateness_ns = 0;
+    for (int n=0; n<BUCKET_COUNT; n++) buckets[n] = 0;
+}
+
+// ------------------------------------------------------------
+
+int SequencerTimingStats::getBucketLimitMicros(const int bucket)
+{
+    static const int limits[BUCKET_COUNT] = { 50, 100, 250, 500, 1000, 2000, 5000, 10000, 20000, -1 };
+    return limits[bucket];
+}
+
+// ------------------------------------------------------------
+
+void SequencerTimingStats::record(const int64_t lateness_ns)
+{
+    const int64_t lateness_us = std::max<int64_t>(0, lateness_ns / 1000);
+    
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 and lateness_us >= getBucketLimitMicros(bucket)) bucket++;
+    
+    buckets[bucket]++;
+    event_count++;
+    total_lateness_ns += lateness_ns;
+    if (lateness_ns > max_lateness_ns) max_lateness_ns = lateness_ns;
+}
+
+// ------------------------------------------------------------
+
+void SequencerTimingStats::print() const
+{
+    if (event_count == 0) return;
+    
+    printf("[AriaSequenceTimer] %li events, mean lateness %.3f ms, max lateness %.3f ms\n", event_count,
+           total_lateness_ns / (double)event_count / NANOS_PER_MILLI, max_lateness_ns / (double)NANOS_PER_MILLI);
+    
+    int previous_limit = 0;
+    for (int n=0; n<BUCKET_COUNT; n++)
+    {
+        const int limit = getBucketLimitMicros(n);
+        if (limit == -1) printf("    >= %6i us : %li\n", previous_limit, buckets[n]);
+        else             printf("    < %7i us : %li\n", limit, buckets[n]);
+        previous_limit = limit;
+    }
+}
+
+// ------------------------------------------------------------
+
 AriaSequenceTimer::AriaSequenceTimer(Sequence* seq)
 {
     m_seq = seq;
 }
 
-BasicTimer* timer = NULL;
+SequencerClock* timer = NULL;
+SequencerTimingStats timing_stats;
+
+const SequencerTimingStats& AriaSequenceTimer::getTimingStats()
+{
+    return timing_stats;
+}
 
 void cleanup_sequencer()
 {
     if (timer != NULL) delete timer;
     timer = NULL;
+    
+#ifdef _MORE_DEBUG_CHECKS
+    timing_stats.print();
+#endif
 }
 
 int count = 0;
@@ -169,7 +359,8 @@ public:
     }
 };
 
-void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int songLengthInTicks)
+void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int songLengthInTicks,
+                            const MidiRouting* routing)
 {
     // Added because I suspect invalid reentrency is the cause of bug #113
     ReentrencyGuard guard;
@@ -186,14 +377,15 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
 
     jdksequencer->GoToTimeMs( 0 );
 
-    int bpm = m_seq->getTempo();
-    const int beatlen = m_seq->ticksPerQuarterNote();
+    // channels of all ports in use (see PlatformMidiManager::seq_note_on)
+    const int channel_amount = MidiRouting::CHANNELS_PER_PORT * (routing == NULL ? 1 : routing->getPortAmount());
 
-    double ticks_per_millis = (double)bpm * (double)beatlen / (double)60000.0;
+    TempoMap tempo_map;
+    buildPlaybackTempoMap(tempo_map, jdksequencer->GetState()->multitrack, m_seq->getTempo(),
+                          m_seq->ticksPerQuarterNote());
+    timing_stats.reset();
 
-    //std::cout << "bpm = " << bpm << " beatlen=" << beatlen << " ticks_per_millis=" << ticks_per_millis << std::endl;
-
-    float next_event_time = 0;
+    int64_t next_event_ns = 0;
 
     jdksmidi::MIDITimedBigMessage ev;
     int ev_track;
@@ -210,13 +402,12 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
     
     long previous_tick = tick;
     
-    next_event_time = tick / ticks_per_millis;
+    next_event_ns = tempo_map.tickToNanos(tick);
     
-    timer = new BasicTimer();
-    timer->reset_and_start();
+    timer = new SequencerClock();
+    timer->reset();
     
-    long total_millis = 0;
-    long last_millis = 0;
+    int64_t total_ns = 0;
     
     int next_metronome_beat = -1;
     int played_metronome_tick = -1;
@@ -226,7 +417,7 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
     while (PlatformMidiManager::get()->seq_must_continue() or PlatformMidiManager::get()->isRecording())
     {
         // process all events that need to be done by the current tick
-        while (next_event_time <= total_millis)
+        while (next_event_ns <= total_ns)
         {
             if (not jdksequencer->GetNextEvent( &ev_track, &ev ))
             {
@@ -261,7 +452,14 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
                     }
                 }
             }
-            const int channel = ev.GetChannel();
+            else
+            {
+                // only actual events count in the statistics
+                timing_stats.record(total_ns - next_event_ns);
+            }
+            
+            const int port    = (routing == NULL ? 0 : routing->getTrackPort(ev_track));
+            const int channel = port*MidiRouting::CHANNELS_PER_PORT + ev.GetChannel();
 
             if (ev.IsNoteOn())
             {
@@ -290,12 +488,7 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
                 const int instrument = ev.GetPGValue();
                 PlatformMidiManager::get()->seq_prog_change(instrument, channel);
             }
-            else if (ev.IsTempo())
-            {
-                //std::cout << "tempo event" << std::endl;
-                const int event_bpm = ev.GetTempo32()/32;
-                ticks_per_millis = (double)event_bpm * (double)beatlen / (double)60000.0;
-            }
+            // tempo events need no handling here, they were all taken into account by the tempo map
             /*
             else if ( ev.IsPolyPressure() )
                 std::cout << "poly pressure" << std::endl;
@@ -357,12 +550,11 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
                     
                     previous_tick = tick;
                     
-                    next_event_time = tick / ticks_per_millis;
+                    next_event_ns = tempo_map.tickToNanos(tick);
                     
                     timer->reset();
                     
-                    total_millis = 0;
-                    last_millis = 0;
+                    total_ns = 0;
                     
                     next_metronome_beat = -1;
                     played_metronome_tick = -1;
@@ -370,7 +562,7 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
                     next_beat = 0;
                     
                     // all notes off on all channels
-                    for (int n = 0; n < 16; n++)
+                    for (int n = 0; n < channel_amount; n++)
                     {
                         PlatformMidiManager::get()->seq_controlchange(0x7B /* all notes off */, 0, n);
                     }
@@ -389,10 +581,8 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
 
             PlatformMidiManager::get()->seq_notify_current_tick(previous_tick);
 
-            //std::cout << "next_event_time was " << next_event_time << " adding " <<
-            //((tick - previous_tick) / ticks_per_millis) << " tick=" << tick <<
-            //" previous_tick=" << previous_tick << "ticks_per_millis=" << ticks_per_millis << std::endl;
-            next_event_time += (tick - previous_tick) / ticks_per_millis;
+            // computed from the tempo map rather than accumulated, so rounding errors don't add up
+            next_event_ns = tempo_map.tickToNanos(tick);
 
             /*
             static int i = 0;
@@ -405,21 +595,19 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
 
         }
         
-        wxThread::Sleep(10);
-        
-        
-        last_millis = total_millis;
+        // sleep until the next event is due, but wake up regularly to check for stop requests
+        // and keep the playback cursor moving
         assert(timer != NULL);
-        const int delta = (timer->get_elapsed_millis() - last_millis);
+        timer->sleepUntil( std::min(next_event_ns, total_ns + HOUSEKEEPING_PERIOD_NS) );
         
-        total_millis += delta;
+        total_ns = timer->getElapsedNanos();
         
-        // FIXME; this will not play well with tempo changes
-        PlatformMidiManager::get()->seq_notify_accurate_current_tick(total_millis*ticks_per_millis);
+        const int current_tick = tempo_map.nanosToTick(total_ns);
+        PlatformMidiManager::get()->seq_notify_accurate_current_tick(current_tick);
         
         if (PlatformMidiManager::get()->isRecording())
         {
-            const int extend_tick = total_millis*ticks_per_millis;
+            const int extend_tick = current_tick;
             if (extend_tick >= next_beat)
             {
                 wxCommandEvent evt(wxEVT_EXTEND_TICK, wxID_ANY);
@@ -432,7 +620,7 @@ void AriaSequenceTimer::run(jdksmidi::MIDISequencer* jdksequencer, const int son
         }
     }
     
-    for (int c=0; c<16; c++)
+    for (int c=0; c<channel_amount; c++)
     {
         PlatformMidiManager::get()->seq_controlchange(123 /* all notes off */, 0, c);
     }
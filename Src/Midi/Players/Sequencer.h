@@ -17,13 +17,44 @@
 #ifndef __ARIA_SEQUENCER_H__
 #define __ARIA_SEQUENCER_H__
 
+#include <stdint.h>
+
 namespace jdksmidi{ class MIDISequencer; }
 
 namespace AriaMaestosa
 {
 
     class Sequence;
+    class MidiRouting;
 
+    /**
+      * @brief Statistics on how late the sequencer thread dispatched events compared to their deadline
+      *
+      * Lateness is sorted into buckets on a roughly logarithmic scale; bucket n counts the events that were
+      * dispatched less than 'getBucketLimitMicros(n)' microseconds late (and more than the previous limit).
+      * The last bucket has no upper limit.
+      */
+    struct SequencerTimingStats
+    {
+        static const int BUCKET_COUNT = 10;
+        
+        long    event_count;
+        long    buckets[BUCKET_COUNT];
+        int64_t max_lateness_ns;
+        int64_t total_lateness_ns;
+        
+        SequencerTimingStats() { reset(); }
+        
+        void reset();
+        void record(const int64_t lateness_ns);
+        
+        /** @return upper limit of the given bucket in microseconds, or -1 for the last bucket */
+        static int getBucketLimitMicros(const int bucket);
+        
+        /** @brief print the histogram to stdout */
+        void print() const;
+    };
+    
     class AriaSequenceTimer
     {
         Sequence* m_seq;
@@ -31,7 +62,20 @@ namespace AriaMaestosa
     public:
 
         AriaSequenceTimer(Sequence* seq);
-        void run(jdksmidi::MIDISequencer* jdksequencer, const int songLengthInTicks);
+        
+        /**
+          * @param routing output port of each track, as set by makeJDKMidiSequence; if NULL, all events go
+          *                to the first port
+          */
+        void run(jdksmidi::MIDISequencer* jdksequencer, const int songLengthInTicks,
+                 const MidiRouting* routing = NULL);
+        
+        /**
+          * @return the event timing statistics of the current (or last) playback.
+          * @note   values are updated from the sequencer thread without locking, read them
+          *         once playback is over for exact figures.
+          */
+        static const SequencerTimingStats& getTimingStats();
     };
 
 }
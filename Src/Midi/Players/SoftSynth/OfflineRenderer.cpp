@@ -0,0 +1,884 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Midi/Players/SoftSynth/OfflineRenderer.h"
+#include "Midi/Players/SoftSynth/SoundFont.h"
+#include "UnitTest.h"
+
+#include "jdksmidi/world.h"
+#include "jdksmidi/multitrack.h"
+#include "jdksmidi/sequencer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <wx/ffile.h>
+#include <wx/intl.h>
+#include <wx/thread.h>
+
+using namespace AriaMaestosa;
+
+namespace
+{
+    const int CHANNEL_AMOUNT  = 16;
+    const int DRUM_CHANNEL    = 9;
+
+    /** maximum amount of simultaneous voices per channel; the oldest voice is stolen past that */
+    const int MAX_VOICES      = 64;
+
+    /** once the last event is played, keep rendering until all voices died out, but not longer than this */
+    const int MAX_TAIL_SECONDS = 10;
+
+    /** global gain applied when mixing channels, leaves headroom for many simultaneous voices */
+    const float MASTER_GAIN   = 0.4f;
+
+    /** envelope level considered silent (-100 dB) */
+    const float SILENCE       = 0.00001f;
+
+    struct SynthEvent
+    {
+        int64_t m_frame;
+        uint8_t m_status;
+        uint8_t m_data1;
+        uint8_t m_data2;
+    };
+
+    float centibelsToGain(const int cb)
+    {
+        return powf(10.0f, -std::max(0, std::min(1440, cb)) / 200.0f);
+    }
+
+    int timecentsToFrames(const int timecents, const int sampleRate)
+    {
+        return std::max(1, (int)(powf(2.0f, timecents / 1200.0f) * sampleRate));
+    }
+
+    // ------------------------------------------------------------------------------------------------------
+
+    /** one sounding sample, with its volume envelope */
+    struct Voice
+    {
+        enum Stage { DELAY, ATTACK, HOLD, DECAY, SUSTAIN, RELEASE, FINISHED };
+
+        const int16_t* m_data;
+        double   m_position;
+        double   m_step;
+        uint32_t m_end;
+        uint32_t m_loop_start;
+        uint32_t m_loop_end;
+        int      m_sample_mode;
+
+        int      m_key;
+        int      m_exclusive_class;
+        bool     m_sustained;   ///< released while the sustain pedal was down
+        float    m_gain_left;
+        float    m_gain_right;
+
+        Stage    m_stage;
+        int      m_stage_frames; ///< frames left in the current timed stage (delay or hold)
+        int      m_hold_frames;
+        float    m_level;
+        float    m_attack_increment;
+        float    m_decay_factor;
+        float    m_sustain_level;
+        int      m_release_frames;
+        float    m_release_factor;
+
+        void release()
+        {
+            if (m_stage == RELEASE or m_stage == FINISHED) return;
+            m_stage = RELEASE;
+            m_release_factor = powf(10.0f, -5.0f / m_release_frames); // -100 dB over the release time
+            m_sustained = false;
+        }
+
+        void advanceEnvelope()
+        {
+            switch (m_stage)
+            {
+                case DELAY:
+                    if (--m_stage_frames <= 0) m_stage = ATTACK;
+                    break;
+                case ATTACK:
+                    m_level += m_attack_increment;
+                    if (m_level >= 1.0f)
+                    {
+                        m_level = 1.0f;
+                        m_stage = HOLD;
+                        m_stage_frames = m_hold_frames;
+                    }
+                    break;
+                case HOLD:
+                    if (--m_stage_frames <= 0) m_stage = DECAY;
+                    break;
+                case DECAY:
+                    m_level *= m_decay_factor;
+                    if (m_level <= m_sustain_level)
+                    {
+                        m_level = m_sustain_level;
+                        m_stage = SUSTAIN;
+                    }
+                    break;
+                case SUSTAIN:
+                    break;
+                case RELEASE:
+                    m_level *= m_release_factor;
+                    if (m_level < SILENCE) m_stage = FINISHED;
+                    break;
+                case FINISHED:
+                    break;
+            }
+        }
+
+        /** add 'frames' frames of this voice to the interleaved stereo buffer */
+        void render(float* out, const int frames, const double pitchRatio, const float channelGain)
+        {
+            const bool loops = (m_sample_mode == 1 or (m_sample_mode == 3 and m_stage != RELEASE)) and
+                               m_loop_end > m_loop_start;
+            const double step = m_step * pitchRatio;
+            const float left  = m_gain_left  * channelGain;
+            const float right = m_gain_right * channelGain;
+
+            for (int n=0; n<frames; n++)
+            {
+                if (m_stage == FINISHED) return;
+
+                const uint32_t index = (uint32_t)m_position;
+                const float fraction = (float)(m_position - index);
+                const float sample   = (m_data[index] + (m_data[index + 1] - m_data[index]) * fraction) / 32768.0f;
+
+                if (m_stage != DELAY)
+                {
+                    out[n*2]     += sample * m_level * left;
+                    out[n*2 + 1] += sample * m_level * right;
+                }
+
+                advanceEnvelope();
+
+                m_position += step;
+                if (loops)
+                {
+                    while (m_position >= m_loop_end) m_position -= (m_loop_end - m_loop_start);
+                }
+                else if (m_position >= m_end - 1)
+                {
+                    m_stage = FINISHED;
+                }
+            }
+        }
+    };
+
+    // ------------------------------------------------------------------------------------------------------
+
+    /** state of one MIDI channel : controllers and sounding voices */
+    class ChannelSynth
+    {
+        const SoundFont* m_font;
+        int m_sample_rate;
+        int m_channel;
+
+        std::vector<SynthEvent> m_events;
+        size_t m_next_event;
+
+        std::vector<Voice> m_voices;
+        std::vector<SoundFontVoiceInfo> m_voice_infos;
+
+        int   m_bank;
+        int   m_program;
+        int   m_volume;
+        int   m_expression;
+        int   m_pan;
+        int   m_pitch_bend;
+        int   m_bend_range;
+        int   m_rpn;
+        bool  m_sustain;
+
+        void resetControllers()
+        {
+            m_volume     = 100;
+            m_expression = 127;
+            m_pan        = 64;
+            m_pitch_bend = 0;
+            m_bend_range = 2;
+            m_rpn        = 0x3FFF;
+            m_sustain    = false;
+        }
+
+        double getPitchRatio() const
+        {
+            return pow(2.0, (m_pitch_bend / 8192.0) * m_bend_range / 12.0);
+        }
+
+        float getChannelGain() const
+        {
+            const float volume     = m_volume / 127.0f;
+            const float expression = m_expression / 127.0f;
+            return volume*volume * expression*expression;
+        }
+
+        void noteOn(const int key, const int velocity)
+        {
+            m_voice_infos.clear();
+            m_font->findVoices(m_bank, m_program, key, velocity, m_voice_infos);
+
+            const int32_t dataLength = m_font->getSampleDataLength();
+
+            for (unsigned int i=0; i<m_voice_infos.size(); i++)
+            {
+                const SoundFontVoiceInfo& info   = m_voice_infos[i];
+                const SoundFontSample&    sample = *info.m_sample;
+                const int* gens = info.m_gens;
+
+                // addresses, with the offsets of the zone applied
+                const int64_t start = (int64_t)sample.m_start + gens[SF_GEN_START_OFFSET] +
+                                      gens[SF_GEN_START_COARSE_OFFSET]*32768;
+                const int64_t end   = (int64_t)sample.m_end + gens[SF_GEN_END_OFFSET] +
+                                      gens[SF_GEN_END_COARSE_OFFSET]*32768;
+                const int64_t loopStart = (int64_t)sample.m_loop_start + gens[SF_GEN_START_LOOP_OFFSET] +
+                                          gens[SF_GEN_START_LOOP_COARSE_OFFSET]*32768;
+                const int64_t loopEnd   = (int64_t)sample.m_loop_end + gens[SF_GEN_END_LOOP_OFFSET] +
+                                          gens[SF_GEN_END_LOOP_COARSE_OFFSET]*32768;
+
+                if (start < 0 or end > dataLength or end - start < 2) continue;
+
+                const int exclusiveClass = gens[SF_GEN_EXCLUSIVE_CLASS];
+                if (exclusiveClass != 0)
+                {
+                    for (unsigned int v=0; v<m_voices.size(); v++)
+                    {
+                        if (m_voices[v].m_exclusive_class == exclusiveClass) m_voices[v].m_stage = Voice::FINISHED;
+                    }
+                }
+
+                Voice voice;
+                voice.m_data        = m_font->getSampleData();
+                voice.m_position    = start;
+                voice.m_end         = end;
+                voice.m_sample_mode = gens[SF_GEN_SAMPLE_MODES] & 3;
+                voice.m_loop_start  = 0;
+                voice.m_loop_end    = 0;
+                // the interpolation reads one point past the loop end
+                if (loopStart >= start and loopEnd < end and loopEnd - loopStart >= 2)
+                {
+                    voice.m_loop_start = loopStart;
+                    voice.m_loop_end   = loopEnd;
+                }
+
+                // pitch
+                const int rootKey = (gens[SF_GEN_OVERRIDING_ROOT_KEY] >= 0 ?
+                                     gens[SF_GEN_OVERRIDING_ROOT_KEY] : sample.m_original_key);
+                const double cents = (key - rootKey) * gens[SF_GEN_SCALE_TUNING] + gens[SF_GEN_COARSE_TUNE]*100 +
+                                     gens[SF_GEN_FINE_TUNE] + sample.m_pitch_correction;
+                voice.m_step = pow(2.0, cents / 1200.0) * sample.m_sample_rate / m_sample_rate;
+
+                // gain : zone attenuation and the default velocity curve, then constant-power pan
+                const float velocityGain = (velocity * velocity) / (127.0f * 127.0f);
+                const float gain = centibelsToGain(gens[SF_GEN_INITIAL_ATTENUATION]) * velocityGain;
+
+                const int pan = std::max(-500, std::min(500, gens[SF_GEN_PAN] + (m_pan - 64) * 500 / 64));
+                const float angle = (pan + 500) / 1000.0f * (float)M_PI / 2.0f;
+                voice.m_gain_left  = gain * cosf(angle);
+                voice.m_gain_right = gain * sinf(angle);
+
+                // volume envelope
+                voice.m_stage            = Voice::DELAY;
+                voice.m_stage_frames     = timecentsToFrames(gens[SF_GEN_DELAY_VOL_ENV], m_sample_rate);
+                voice.m_hold_frames      = timecentsToFrames(gens[SF_GEN_HOLD_VOL_ENV], m_sample_rate);
+                voice.m_level            = 0.0f;
+                voice.m_attack_increment = 1.0f / timecentsToFrames(gens[SF_GEN_ATTACK_VOL_ENV], m_sample_rate);
+                voice.m_decay_factor     = powf(10.0f, -5.0f / timecentsToFrames(gens[SF_GEN_DECAY_VOL_ENV],
+                                                                                  m_sample_rate));
+                voice.m_sustain_level    = centibelsToGain(gens[SF_GEN_SUSTAIN_VOL_ENV]);
+                voice.m_release_frames   = timecentsToFrames(gens[SF_GEN_RELEASE_VOL_ENV], m_sample_rate);
+                voice.m_release_factor   = 1.0f;
+                voice.m_key              = key;
+                voice.m_exclusive_class  = exclusiveClass;
+                voice.m_sustained        = false;
+
+                if (voice.m_stage_frames <= 1) voice.m_stage = Voice::ATTACK;
+
+                if ((int)m_voices.size() >= MAX_VOICES) m_voices.erase(m_voices.begin());
+                m_voices.push_back(voice);
+            }
+        }
+
+        void noteOff(const int key)
+        {
+            for (unsigned int v=0; v<m_voices.size(); v++)
+            {
+                Voice& voice = m_voices[v];
+                if (voice.m_key != key or voice.m_stage == Voice::RELEASE) continue;
+
+                if (m_sustain) voice.m_sustained = true;
+                else           voice.release();
+            }
+        }
+
+        void controlChange(const int controller, const int value)
+        {
+            switch (controller)
+            {
+                case 0:   m_bank = (m_channel == DRUM_CHANNEL ? 128 : value); break;
+                case 6:   if (m_rpn == 0) m_bend_range = value; break;
+                case 7:   m_volume = value;     break;
+                case 10:  m_pan = value;        break;
+                case 11:  m_expression = value; break;
+                case 64:
+                    m_sustain = (value >= 64);
+                    if (not m_sustain)
+                    {
+                        for (unsigned int v=0; v<m_voices.size(); v++)
+                        {
+                            if (m_voices[v].m_sustained) m_voices[v].release();
+                        }
+                    }
+                    break;
+                case 100: m_rpn = (m_rpn & 0x3F80) | value;        break;
+                case 101: m_rpn = (m_rpn & 0x007F) | (value << 7); break;
+                case 120: m_voices.clear(); break; // all sound off
+                case 121: resetControllers(); break;
+                case 123: // all notes off
+                    for (unsigned int v=0; v<m_voices.size(); v++) m_voices[v].release();
+                    break;
+            }
+        }
+
+        void processEvent(const SynthEvent& ev)
+        {
+            switch (ev.m_status & 0xF0)
+            {
+                case 0x90:
+                    if (ev.m_data2 > 0)
+                    {
+                        noteOn(ev.m_data1, ev.m_data2);
+                        break;
+                    }
+                    // note on with velocity 0 is a note off
+                case 0x80:
+                    noteOff(ev.m_data1);
+                    break;
+                case 0xB0:
+                    controlChange(ev.m_data1, ev.m_data2);
+                    break;
+                case 0xC0:
+                    m_program = ev.m_data1;
+                    break;
+                case 0xE0:
+                    m_pitch_bend = ((ev.m_data2 << 7) | ev.m_data1) - 8192;
+                    break;
+            }
+        }
+
+        void renderVoices(float* out, const int frames)
+        {
+            if (frames <= 0 or m_voices.empty()) return;
+
+            const double pitchRatio = getPitchRatio();
+            const float  gain       = getChannelGain();
+            for (unsigned int v=0; v<m_voices.size(); v++)
+            {
+                m_voices[v].render(out, frames, pitchRatio, gain);
+            }
+
+            // forget finished voices
+            unsigned int kept = 0;
+            for (unsigned int v=0; v<m_voices.size(); v++)
+            {
+                if (m_voices[v].m_stage != Voice::FINISHED) m_voices[kept++] = m_voices[v];
+            }
+            m_voices.resize(kept);
+        }
+
+    public:
+
+        ChannelSynth() : m_font(NULL), m_sample_rate(44100), m_channel(0), m_next_event(0)
+        {
+            m_bank    = 0;
+            m_program = 0;
+            resetControllers();
+        }
+
+        void init(const SoundFont* font, const int sampleRate, const int channel)
+        {
+            m_font        = font;
+            m_sample_rate = sampleRate;
+            m_channel     = channel;
+            m_bank        = (channel == DRUM_CHANNEL ? 128 : 0);
+        }
+
+        void addEvent(const SynthEvent& ev) { m_events.push_back(ev); }
+
+        bool isDone() const { return m_next_event >= m_events.size() and m_voices.empty(); }
+
+        /** render the frames [blockStart, blockStart + frames) into the (cleared) interleaved stereo buffer */
+        void renderBlock(const int64_t blockStart, const int frames, float* out)
+        {
+            int position = 0;
+            while (m_next_event < m_events.size() and m_events[m_next_event].m_frame < blockStart + frames)
+            {
+                const int eventPosition = std::max<int64_t>(0, m_events[m_next_event].m_frame - blockStart);
+                renderVoices(out + position*2, eventPosition - position);
+                position = std::max(position, eventPosition);
+
+                processEvent(m_events[m_next_event]);
+                m_next_event++;
+            }
+            renderVoices(out + position*2, frames - position);
+        }
+    };
+
+    // ------------------------------------------------------------------------------------------------------
+
+    /**
+      * Renders the 16 channels of a block in parallel. The calling thread takes part in the work; the
+      * workers wait on a semaphore between blocks.
+      */
+    class ParallelBlockRenderer
+    {
+        class Worker : public wxThread
+        {
+            ParallelBlockRenderer* m_parent;
+        public:
+            Worker(ParallelBlockRenderer* parent) : wxThread(wxTHREAD_JOINABLE), m_parent(parent) {}
+            virtual ExitCode Entry()
+            {
+                m_parent->workerLoop();
+                return 0;
+            }
+        };
+
+        ChannelSynth* m_channels;
+        std::vector<float>* m_buffers;
+        int64_t m_block_start;
+        int     m_frames;
+
+        std::vector<Worker*> m_workers;
+        wxSemaphore m_start;
+        wxSemaphore m_done;
+        wxMutex     m_lock;
+        int         m_next_channel;
+        bool        m_quit;
+
+        void renderChannels()
+        {
+            while (true)
+            {
+                int channel;
+                {
+                    wxMutexLocker lock(m_lock);
+                    channel = m_next_channel++;
+                }
+                if (channel >= CHANNEL_AMOUNT) return;
+
+                std::vector<float>& buffer = m_buffers[channel];
+                std::fill(buffer.begin(), buffer.begin() + m_frames*2, 0.0f);
+                m_channels[channel].renderBlock(m_block_start, m_frames, &buffer[0]);
+            }
+        }
+
+        void workerLoop()
+        {
+            while (true)
+            {
+                m_start.Wait();
+                if (m_quit) return;
+                renderChannels();
+                m_done.Post();
+            }
+        }
+
+    public:
+
+        ParallelBlockRenderer(ChannelSynth* channels, std::vector<float>* buffers) :
+            m_channels(channels), m_buffers(buffers), m_block_start(0), m_frames(0), m_next_channel(0), m_quit(false)
+        {
+            const int cpus = wxThread::GetCPUCount();
+            const int workerAmount = std::max(0, std::min(CHANNEL_AMOUNT, cpus) - 1);
+            for (int n=0; n<workerAmount; n++)
+            {
+                Worker* worker = new Worker(this);
+                if (worker->Create() != wxTHREAD_NO_ERROR or worker->Run() != wxTHREAD_NO_ERROR)
+                {
+                    delete worker;
+                    break;
+                }
+                m_workers.push_back(worker);
+            }
+        }
+
+        ~ParallelBlockRenderer()
+        {
+            m_quit = true;
+            for (unsigned int n=0; n<m_workers.size(); n++) m_start.Post();
+            for (unsigned int n=0; n<m_workers.size(); n++)
+            {
+                m_workers[n]->Wait();
+                delete m_workers[n];
+            }
+        }
+
+        void renderBlock(const int64_t blockStart, const int frames)
+        {
+            m_block_start  = blockStart;
+            m_frames       = frames;
+            m_next_channel = 0;
+
+            for (unsigned int n=0; n<m_workers.size(); n++) m_start.Post();
+            renderChannels();
+            for (unsigned int n=0; n<m_workers.size(); n++) m_done.Wait();
+        }
+    };
+
+    void writeU32(unsigned char* p, const uint32_t value)
+    {
+        p[0] = value & 0xFF;
+        p[1] = (value >> 8) & 0xFF;
+        p[2] = (value >> 16) & 0xFF;
+        p[3] = (value >> 24) & 0xFF;
+    }
+
+    void writeU16(unsigned char* p, const uint16_t value)
+    {
+        p[0] = value & 0xFF;
+        p[1] = (value >> 8) & 0xFF;
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+/** receives the mixed blocks of a rendering */
+class OfflineRenderer::BlockSink
+{
+public:
+    virtual ~BlockSink() {}
+    virtual bool write(const int16_t* samples, const int frames) = 0;
+};
+
+// ----------------------------------------------------------------------------------------------------------
+
+/** streams blocks to a 16 bit stereo WAV file; the sizes in the header are filled in 'finish' */
+class OfflineRenderer::WavSink : public OfflineRenderer::BlockSink
+{
+    wxFFile  m_file;
+    uint32_t m_data_bytes;
+    int      m_sample_rate;
+
+    void writeHeader()
+    {
+        unsigned char header[44];
+        memcpy(header, "RIFF", 4);
+        writeU32(header + 4, 36 + m_data_bytes);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        writeU32(header + 16, 16);                  // fmt chunk size
+        writeU16(header + 20, 1);                   // PCM
+        writeU16(header + 22, 2);                   // channels
+        writeU32(header + 24, m_sample_rate);
+        writeU32(header + 28, m_sample_rate * 4);   // bytes per second
+        writeU16(header + 32, 4);                   // bytes per frame
+        writeU16(header + 34, 16);                  // bits per sample
+        memcpy(header + 36, "data", 4);
+        writeU32(header + 40, m_data_bytes);
+        m_file.Write(header, 44);
+    }
+
+public:
+
+    WavSink(const wxString& path, const int sampleRate) : m_file(path, wxT("wb"))
+    {
+        m_data_bytes  = 0;
+        m_sample_rate = sampleRate;
+        if (m_file.IsOpened()) writeHeader();
+    }
+
+    bool isOpened() const { return m_file.IsOpened(); }
+
+    virtual bool write(const int16_t* samples, const int frames)
+    {
+        std::vector<unsigned char> bytes(frames * 4);
+        for (int n=0; n<frames*2; n++) writeU16(&bytes[n*2], (uint16_t)samples[n]);
+
+        m_data_bytes += bytes.size();
+        return m_file.Write(&bytes[0], bytes.size()) == bytes.size();
+    }
+
+    bool finish()
+    {
+        if (not m_file.Seek(0)) return false;
+        writeHeader();
+        return m_file.Close();
+    }
+};
+
+// ----------------------------------------------------------------------------------------------------------
+
+class OfflineRenderer::BufferSink : public OfflineRenderer::BlockSink
+{
+    std::vector<int16_t>& m_out;
+public:
+    BufferSink(std::vector<int16_t>& out) : m_out(out) { m_out.clear(); }
+
+    virtual bool write(const int16_t* samples, const int frames)
+    {
+        m_out.insert(m_out.end(), samples, samples + frames*2);
+        return true;
+    }
+};
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+OfflineRenderer::OfflineRenderer(const SoundFont* font, const int sampleRate)
+{
+    m_font        = font;
+    m_sample_rate = sampleRate;
+    m_callback    = NULL;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool OfflineRenderer::renderToWav(jdksmidi::MIDIMultiTrack* tracks, const wxString& path,
+                                  ProgressCallback callback)
+{
+    WavSink sink(path, m_sample_rate);
+    if (not sink.isOpened())
+    {
+        m_error = _("Cannot open the output file");
+        return false;
+    }
+
+    m_callback = callback;
+    const bool success = render(tracks, sink);
+    m_callback = NULL;
+
+    if (not success) return false;
+    if (not sink.finish())
+    {
+        m_error = _("Cannot write the output file");
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool OfflineRenderer::renderToBuffer(jdksmidi::MIDIMultiTrack* tracks, std::vector<int16_t>& out)
+{
+    BufferSink sink(out);
+    return render(tracks, sink);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool OfflineRenderer::render(jdksmidi::MIDIMultiTrack* tracks, BlockSink& sink)
+{
+    m_error = wxEmptyString;
+
+    ChannelSynth channels[CHANNEL_AMOUNT];
+    for (int c=0; c<CHANNEL_AMOUNT; c++) channels[c].init(m_font, m_sample_rate, c);
+
+    // ---- convert the sequence to sample frames once, split by channel
+    int64_t lastEventFrame = 0;
+    {
+        jdksmidi::MIDISequencer sequencer(tracks);
+        sequencer.GoToTimeMs(0);
+
+        double timeMs;
+        while (sequencer.GetNextEventTimeMs(&timeMs))
+        {
+            int trackId;
+            jdksmidi::MIDITimedBigMessage msg;
+            if (not sequencer.GetNextEvent(&trackId, &msg)) break;
+            if (msg.IsMetaEvent() or not msg.IsChannelMsg()) continue;
+
+            SynthEvent ev;
+            ev.m_frame  = (int64_t)(timeMs * m_sample_rate / 1000.0 + 0.5);
+            ev.m_status = msg.GetStatus();
+            ev.m_data1  = msg.GetByte1();
+            ev.m_data2  = msg.GetByte2();
+            channels[msg.GetChannel()].addEvent(ev);
+
+            lastEventFrame = std::max(lastEventFrame, ev.m_frame);
+        }
+    }
+
+    // ---- render block by block
+    const int blockFrames = m_sample_rate; // one second
+    const int64_t maxFrames = lastEventFrame + (int64_t)MAX_TAIL_SECONDS * m_sample_rate;
+
+    std::vector<float> buffers[CHANNEL_AMOUNT];
+    for (int c=0; c<CHANNEL_AMOUNT; c++) buffers[c].resize(blockFrames * 2);
+    std::vector<int16_t> mixed(blockFrames * 2);
+
+    ParallelBlockRenderer renderer(channels, buffers);
+
+    int percent = -1;
+    for (int64_t blockStart = 0; blockStart < maxFrames; blockStart += blockFrames)
+    {
+        bool done = true;
+        for (int c=0; c<CHANNEL_AMOUNT; c++) done = done and channels[c].isDone();
+        if (done and blockStart > lastEventFrame) break;
+
+        const int frames = (int)std::min<int64_t>(blockFrames, maxFrames - blockStart);
+        renderer.renderBlock(blockStart, frames);
+
+        for (int n=0; n<frames*2; n++)
+        {
+            float sum = 0.0f;
+            for (int c=0; c<CHANNEL_AMOUNT; c++) sum += buffers[c][n];
+
+            const float value = std::max(-1.0f, std::min(1.0f, sum * MASTER_GAIN));
+            mixed[n] = (int16_t)(value * 32767.0f);
+        }
+
+        if (not sink.write(&mixed[0], frames))
+        {
+            m_error = _("Cannot write the output file");
+            return false;
+        }
+
+        if (m_callback != NULL and lastEventFrame > 0)
+        {
+            const int newPercent = (int)std::min<int64_t>(100, (blockStart + frames) * 100 / lastEventFrame);
+            if (newPercent != percent)
+            {
+                percent = newPercent;
+                m_callback(percent);
+            }
+        }
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestOfflineRenderer
+{
+    using namespace AriaMaestosa;
+
+    /** builds a minimal SoundFont : one preset, one instrument, one looped square wave at 44.1 kHz */
+    std::vector<char> makeTestSoundFont()
+    {
+        std::vector<char> out;
+
+        struct Writer
+        {
+            std::vector<char>& m_out;
+            Writer(std::vector<char>& out) : m_out(out) {}
+            void bytes(const char* data, int size) { m_out.insert(m_out.end(), data, data + size); }
+            void u8(int v)  { m_out.push_back((char)v); }
+            void u16(int v) { u8(v & 0xFF); u8((v >> 8) & 0xFF); }
+            void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+            void name(const char* n) { char buf[20] = {0}; strncpy(buf, n, 19); bytes(buf, 20); }
+            size_t begin(const char* id) { bytes(id, 4); u32(0); return m_out.size(); }
+            void end(size_t start) { const uint32_t size = m_out.size() - start;
+                                     unsigned char* p = (unsigned char*)&m_out[start - 4];
+                                     writeU32(p, size); }
+        };
+        Writer w(out);
+
+        const int sampleLength = 1000;
+
+        const size_t riff = w.begin("RIFF");
+        w.bytes("sfbk", 4);
+
+        const size_t sdta = w.begin("LIST");
+        w.bytes("sdta", 4);
+        const size_t smpl = w.begin("smpl");
+        for (int n=0; n<sampleLength + 46; n++) w.u16((n / 50) % 2 ? 0x4000 : 0xC000);
+        w.end(smpl);
+        w.end(sdta);
+
+        const size_t pdta = w.begin("LIST");
+        w.bytes("pdta", 4);
+
+        size_t chunk = w.begin("phdr");
+        w.name("Test"); w.u16(0); w.u16(0); w.u16(0); w.u32(0); w.u32(0); w.u32(0);
+        w.name("EOP");  w.u16(0); w.u16(0); w.u16(1); w.u32(0); w.u32(0); w.u32(0);
+        w.end(chunk);
+
+        chunk = w.begin("pbag"); w.u16(0); w.u16(0); w.u16(1); w.u16(0); w.end(chunk);
+        chunk = w.begin("pmod"); for (int n=0; n<10; n++) w.u8(0); w.end(chunk);
+        chunk = w.begin("pgen"); w.u16(SF_GEN_INSTRUMENT); w.u16(0); w.u16(0); w.u16(0); w.end(chunk);
+
+        chunk = w.begin("inst");
+        w.name("Square"); w.u16(0);
+        w.name("EOI");    w.u16(1);
+        w.end(chunk);
+
+        chunk = w.begin("ibag"); w.u16(0); w.u16(0); w.u16(2); w.u16(0); w.end(chunk);
+        chunk = w.begin("imod"); for (int n=0; n<10; n++) w.u8(0); w.end(chunk);
+        chunk = w.begin("igen");
+        w.u16(SF_GEN_SAMPLE_MODES); w.u16(1);
+        w.u16(SF_GEN_SAMPLE_ID);    w.u16(0);
+        w.u16(0); w.u16(0);
+        w.end(chunk);
+
+        chunk = w.begin("shdr");
+        w.name("Square"); w.u32(0); w.u32(sampleLength); w.u32(100); w.u32(sampleLength - 100);
+        w.u32(44100); w.u8(69); w.u8(0); w.u16(0); w.u16(1);
+        w.name("EOS"); w.u32(0); w.u32(0); w.u32(0); w.u32(0); w.u32(0); w.u8(0); w.u8(0); w.u16(0); w.u16(0);
+        w.end(chunk);
+
+        w.end(pdta);
+        w.end(riff);
+
+        return out;
+    }
+
+    UNIT_TEST( TestRenderNote )
+    {
+        std::vector<char> data = makeTestSoundFont();
+
+        SoundFont font;
+        require(font.loadFromMemory(&data[0], data.size()), "the test SoundFont is loaded");
+
+        std::vector<SoundFontVoiceInfo> voices;
+        font.findVoices(0, 0, 60, 100, voices);
+        require_e((int)voices.size(), ==, 1, "one voice is found for the note");
+        require_e(voices[0].m_gens[SF_GEN_SAMPLE_MODES], ==, 1, "instrument generators are read");
+
+        // half a second of note at 120 bpm, then silence
+        jdksmidi::MIDIMultiTrack tracks(1);
+        tracks.SetClksPerBeat(960);
+        jdksmidi::MIDITimedBigMessage on, off;
+        on.SetTime(0);
+        on.SetNoteOn(0, 60, 100);
+        off.SetTime(960);
+        off.SetNoteOff(0, 60, 0);
+        tracks.GetTrack(0)->PutEvent(on);
+        tracks.GetTrack(0)->PutEvent(off);
+
+        OfflineRenderer renderer(&font, 44100);
+        std::vector<int16_t> samples;
+        require(renderer.renderToBuffer(&tracks, samples), "rendering succeeds");
+
+        const int frames = samples.size() / 2;
+        require(frames >= 22050, "the whole note was rendered");
+        require(frames < 44100*2, "rendering stops once the note died out");
+
+        int peakDuringNote = 0;
+        for (int n=1000; n<20000; n++) peakDuringNote = std::max(peakDuringNote, abs((int)samples[n*2]));
+        require(peakDuringNote > 1000, "the note is audible");
+
+        int peakAfterRelease = 0;
+        for (int n=24000; n<frames; n++) peakAfterRelease = std::max(peakAfterRelease, abs((int)samples[n*2]));
+        require_e(peakAfterRelease, <, 10, "the note stops after its release");
+    }
+}
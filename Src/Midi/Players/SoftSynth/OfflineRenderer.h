@@ -0,0 +1,78 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __OFFLINE_RENDERER_H__
+#define __OFFLINE_RENDERER_H__
+
+#include <stdint.h>
+#include <vector>
+#include <wx/string.h>
+
+namespace jdksmidi { class MIDIMultiTrack; }
+
+namespace AriaMaestosa
+{
+    class SoundFont;
+
+    /**
+      * @brief Synthesizes a MIDI sequence to 16 bit stereo PCM with a SoundFont, faster than realtime
+      *
+      * Takes the output of makeJDKMidiSequence directly (no temporary MIDI file, no external program).
+      * Each MIDI channel is synthesized independently, so the channels of each block of audio are rendered
+      * in parallel on all available cores; blocks are then mixed and handed to the output one after the
+      * other, so memory use does not depend on the length of the song.
+      *
+      * @ingroup midi.players
+      */
+    class OfflineRenderer
+    {
+        const SoundFont* m_font;
+        int              m_sample_rate;
+        wxString         m_error;
+
+        class BlockSink;
+        class WavSink;
+        class BufferSink;
+
+        bool render(jdksmidi::MIDIMultiTrack* tracks, BlockSink& sink);
+
+    public:
+
+        /** receives the progress of a rendering, in percent; called from the rendering thread */
+        typedef void (*ProgressCallback)(int percent);
+
+        OfflineRenderer(const SoundFont* font, const int sampleRate = 44100);
+
+        /**
+          * @brief render the tracks to a WAV file, streaming each block to disk as it is completed
+          * @return false on error, see 'getError'
+          */
+        bool renderToWav(jdksmidi::MIDIMultiTrack* tracks, const wxString& path,
+                         ProgressCallback callback = NULL);
+
+        /** @brief render the tracks to memory, as interleaved stereo samples */
+        bool renderToBuffer(jdksmidi::MIDIMultiTrack* tracks, std::vector<int16_t>& out);
+
+        const wxString& getError() const { return m_error; }
+
+    private:
+        ProgressCallback m_callback;
+    };
+
+}
+
+#endif
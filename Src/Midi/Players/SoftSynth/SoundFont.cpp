@@ -0,0 +1,430 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Midi/Players/SoftSynth/SoundFont.h"
+
+#include <algorithm>
+#include <cstring>
+#include <wx/ffile.h>
+#include <wx/intl.h>
+
+using namespace AriaMaestosa;
+
+namespace
+{
+    // SoundFont files are little-endian; read byte by byte so this works on any host
+    uint32_t readU32(const char* p)
+    {
+        const unsigned char* u = (const unsigned char*)p;
+        return u[0] | (u[1] << 8) | (u[2] << 16) | ((uint32_t)u[3] << 24);
+    }
+
+    uint16_t readU16(const char* p)
+    {
+        const unsigned char* u = (const unsigned char*)p;
+        return u[0] | (u[1] << 8);
+    }
+
+    int16_t readS16(const char* p)
+    {
+        return (int16_t)readU16(p);
+    }
+
+    const int FULL_RANGE = 127 << 8; // ranges are stored as (low byte, high byte)
+
+    // record sizes of the 'pdta' sub-chunks
+    const uint32_t PHDR_SIZE = 38;
+    const uint32_t BAG_SIZE  = 4;
+    const uint32_t GEN_SIZE  = 4;
+    const uint32_t INST_SIZE = 22;
+    const uint32_t SHDR_SIZE = 46;
+
+    struct Chunk
+    {
+        const char* m_data;
+        uint32_t    m_size;
+
+        Chunk() : m_data(NULL), m_size(0) {}
+    };
+
+    /** @return the amount of records in a chunk, not counting the terminal record, or -1 if malformed */
+    int recordAmount(const Chunk& chunk, const uint32_t recordSize)
+    {
+        if (chunk.m_data == NULL or chunk.m_size % recordSize != 0 or chunk.m_size < 2*recordSize) return -1;
+        return chunk.m_size / recordSize - 1;
+    }
+
+    /** instrument-level defaults from the specification, for the generators the renderer uses */
+    void setInstrumentDefaults(int* gens)
+    {
+        for (int n=0; n<SF_GEN_COUNT; n++) gens[n] = 0;
+        gens[SF_GEN_DELAY_VOL_ENV]       = -12000;
+        gens[SF_GEN_ATTACK_VOL_ENV]      = -12000;
+        gens[SF_GEN_HOLD_VOL_ENV]        = -12000;
+        gens[SF_GEN_DECAY_VOL_ENV]       = -12000;
+        gens[SF_GEN_RELEASE_VOL_ENV]     = -12000;
+        gens[SF_GEN_KEY_RANGE]           = FULL_RANGE;
+        gens[SF_GEN_VEL_RANGE]           = FULL_RANGE;
+        gens[SF_GEN_SCALE_TUNING]        = 100;
+        gens[SF_GEN_OVERRIDING_ROOT_KEY] = -1;
+    }
+
+    /** generators whose preset-level value is added to the instrument-level value */
+    bool isAdditive(const int gen)
+    {
+        switch (gen)
+        {
+            case SF_GEN_PAN:
+            case SF_GEN_DELAY_VOL_ENV:
+            case SF_GEN_ATTACK_VOL_ENV:
+            case SF_GEN_HOLD_VOL_ENV:
+            case SF_GEN_DECAY_VOL_ENV:
+            case SF_GEN_SUSTAIN_VOL_ENV:
+            case SF_GEN_RELEASE_VOL_ENV:
+            case SF_GEN_INITIAL_ATTENUATION:
+            case SF_GEN_COARSE_TUNE:
+            case SF_GEN_FINE_TUNE:
+            case SF_GEN_SCALE_TUNING:
+                return true;
+            default:
+                return false;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+SoundFont::Zone::Zone()
+{
+    for (int n=0; n<SF_GEN_COUNT; n++)
+    {
+        m_gens[n] = 0;
+        m_set[n]  = false;
+    }
+    m_gens[SF_GEN_KEY_RANGE] = FULL_RANGE;
+    m_gens[SF_GEN_VEL_RANGE] = FULL_RANGE;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool SoundFont::Zone::matches(const int key, const int velocity) const
+{
+    const int keys = m_gens[SF_GEN_KEY_RANGE];
+    const int vels = m_gens[SF_GEN_VEL_RANGE];
+    return key      >= (keys & 0xFF) and key      <= (keys >> 8) and
+           velocity >= (vels & 0xFF) and velocity <= (vels >> 8);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool SoundFont::fail(const wxString& message)
+{
+    m_error = message;
+    m_sample_data.clear();
+    m_samples.clear();
+    m_instruments.clear();
+    m_presets.clear();
+    return false;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool SoundFont::loadFromFile(const wxString& path)
+{
+    wxFFile file(path, wxT("rb"));
+    if (not file.IsOpened()) return fail(_("Cannot open the SoundFont file"));
+
+    const wxFileOffset length = file.Length();
+    if (length <= 0 or length > 0x7FFFFFFF) return fail(_("Invalid SoundFont file"));
+
+    std::vector<char> contents(length);
+    if (file.Read(&contents[0], length) != (size_t)length) return fail(_("Cannot read the SoundFont file"));
+
+    return loadFromMemory(&contents[0], length);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool SoundFont::loadFromMemory(const char* data, const uint32_t size)
+{
+    m_error = wxEmptyString;
+
+    if (size < 12 or memcmp(data, "RIFF", 4) != 0 or memcmp(data + 8, "sfbk", 4) != 0)
+    {
+        return fail(_("This file is not a SoundFont 2 file"));
+    }
+
+    const uint32_t riffEnd = std::min<uint32_t>(size, 8 + readU32(data + 4));
+
+    Chunk smpl;
+    Chunk pdta;
+
+    // walk the top-level LIST chunks ('INFO', 'sdta' and 'pdta')
+    uint32_t pos = 12;
+    while (pos + 8 <= riffEnd)
+    {
+        const uint32_t chunkSize = readU32(data + pos + 4);
+        const uint32_t body      = pos + 8;
+        if (chunkSize > riffEnd - body) return fail(_("The SoundFont file is truncated"));
+
+        if (memcmp(data + pos, "LIST", 4) == 0 and chunkSize >= 4)
+        {
+            if (memcmp(data + body, "pdta", 4) == 0)
+            {
+                pdta.m_data = data + body + 4;
+                pdta.m_size = chunkSize - 4;
+            }
+            else if (memcmp(data + body, "sdta", 4) == 0)
+            {
+                uint32_t sub = body + 4;
+                while (sub + 8 <= body + chunkSize)
+                {
+                    const uint32_t subSize = readU32(data + sub + 4);
+                    if (subSize > body + chunkSize - sub - 8) break;
+
+                    if (memcmp(data + sub, "smpl", 4) == 0)
+                    {
+                        smpl.m_data = data + sub + 8;
+                        smpl.m_size = subSize;
+                    }
+                    sub += 8 + subSize + (subSize & 1);
+                }
+            }
+        }
+
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+
+    if (smpl.m_data == NULL or pdta.m_data == NULL) return fail(_("The SoundFont file has no sample data"));
+
+    const uint32_t sampleAmount = smpl.m_size / 2;
+    m_sample_data.resize(sampleAmount);
+    for (uint32_t n=0; n<sampleAmount; n++)
+    {
+        m_sample_data[n] = readS16(smpl.m_data + n*2);
+    }
+
+    return parseHydra(pdta.m_data, pdta.m_size);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void SoundFont::readZones(const char* bags, const char* gens, const uint32_t genAmount,
+                          const uint32_t firstBag, const uint32_t lastBag, const int terminalGen,
+                          std::vector<Zone>& out)
+{
+    Zone global;
+
+    for (uint32_t bag=firstBag; bag<lastBag; bag++)
+    {
+        const uint32_t genFrom = readU16(bags + bag*BAG_SIZE);
+        const uint32_t genTo   = std::min<uint32_t>(readU16(bags + (bag + 1)*BAG_SIZE), genAmount);
+        if (genFrom >= genTo) continue;
+
+        Zone zone = global;
+
+        int lastOperator = -1;
+        for (uint32_t g=genFrom; g<genTo; g++)
+        {
+            const int op = readU16(gens + g*GEN_SIZE);
+            lastOperator = op;
+            if (op >= SF_GEN_COUNT) continue;
+
+            if (op == SF_GEN_KEY_RANGE or op == SF_GEN_VEL_RANGE)
+            {
+                zone.m_gens[op] = readU16(gens + g*GEN_SIZE + 2);
+            }
+            else if (op == SF_GEN_INSTRUMENT or op == SF_GEN_SAMPLE_ID)
+            {
+                zone.m_gens[op] = readU16(gens + g*GEN_SIZE + 2);
+            }
+            else
+            {
+                zone.m_gens[op] = readS16(gens + g*GEN_SIZE + 2);
+            }
+            zone.m_set[op] = true;
+        }
+
+        if (lastOperator == terminalGen)
+        {
+            out.push_back(zone);
+        }
+        else if (bag == firstBag)
+        {
+            // the first zone is global when it does not end with an instrument/sample
+            global = zone;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool SoundFont::parseHydra(const char* data, const uint32_t size)
+{
+    Chunk phdr, pbag, pgen, inst, ibag, igen, shdr;
+
+    uint32_t pos = 0;
+    while (pos + 8 <= size)
+    {
+        const uint32_t chunkSize = readU32(data + pos + 4);
+        if (chunkSize > size - pos - 8) return fail(_("The SoundFont file is truncated"));
+
+        Chunk chunk;
+        chunk.m_data = data + pos + 8;
+        chunk.m_size = chunkSize;
+
+        if      (memcmp(data + pos, "phdr", 4) == 0) phdr = chunk;
+        else if (memcmp(data + pos, "pbag", 4) == 0) pbag = chunk;
+        else if (memcmp(data + pos, "pgen", 4) == 0) pgen = chunk;
+        else if (memcmp(data + pos, "inst", 4) == 0) inst = chunk;
+        else if (memcmp(data + pos, "ibag", 4) == 0) ibag = chunk;
+        else if (memcmp(data + pos, "igen", 4) == 0) igen = chunk;
+        else if (memcmp(data + pos, "shdr", 4) == 0) shdr = chunk;
+
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    const int presetAmount     = recordAmount(phdr, PHDR_SIZE);
+    const int presetBagAmount  = recordAmount(pbag, BAG_SIZE);
+    const int presetGenAmount  = recordAmount(pgen, GEN_SIZE);
+    const int instrumentAmount = recordAmount(inst, INST_SIZE);
+    const int instBagAmount    = recordAmount(ibag, BAG_SIZE);
+    const int instGenAmount    = recordAmount(igen, GEN_SIZE);
+    const int sampleAmount     = recordAmount(shdr, SHDR_SIZE);
+
+    if (presetAmount < 0 or presetBagAmount < 0 or presetGenAmount < 0 or instrumentAmount < 0 or
+        instBagAmount < 0 or instGenAmount < 0 or sampleAmount < 0)
+    {
+        return fail(_("The SoundFont file is corrupted"));
+    }
+
+    // ---- samples
+    const uint32_t dataLength = m_sample_data.size();
+    m_samples.resize(sampleAmount);
+    for (int n=0; n<sampleAmount; n++)
+    {
+        const char* record = shdr.m_data + n*SHDR_SIZE;
+        SoundFontSample& sample = m_samples[n];
+        sample.m_start            = std::min(readU32(record + 20), dataLength);
+        sample.m_end              = std::min(readU32(record + 24), dataLength);
+        sample.m_loop_start       = std::min(readU32(record + 28), dataLength);
+        sample.m_loop_end         = std::min(readU32(record + 32), dataLength);
+        sample.m_sample_rate      = readU32(record + 36);
+        sample.m_original_key     = (unsigned char)record[40];
+        sample.m_pitch_correction = (signed char)record[41];
+
+        if (sample.m_sample_rate == 0)      sample.m_sample_rate = 44100;
+        if (sample.m_original_key > 127)    sample.m_original_key = 60;
+    }
+
+    // ---- instruments
+    m_instruments.resize(instrumentAmount);
+    for (int n=0; n<instrumentAmount; n++)
+    {
+        const uint32_t firstBag = readU16(inst.m_data + n*INST_SIZE + 20);
+        const uint32_t lastBag  = readU16(inst.m_data + (n + 1)*INST_SIZE + 20);
+        if (firstBag > lastBag or lastBag > (uint32_t)instBagAmount) continue;
+
+        readZones(ibag.m_data, igen.m_data, instGenAmount, firstBag, lastBag, SF_GEN_SAMPLE_ID,
+                  m_instruments[n].m_zones);
+    }
+
+    // ---- presets
+    m_presets.resize(presetAmount);
+    for (int n=0; n<presetAmount; n++)
+    {
+        const char* record = phdr.m_data + n*PHDR_SIZE;
+        m_presets[n].m_program = readU16(record + 20);
+        m_presets[n].m_bank    = readU16(record + 22);
+
+        const uint32_t firstBag = readU16(record + 24);
+        const uint32_t lastBag  = readU16(record + PHDR_SIZE + 24);
+        if (firstBag > lastBag or lastBag > (uint32_t)presetBagAmount) continue;
+
+        readZones(pbag.m_data, pgen.m_data, presetGenAmount, firstBag, lastBag, SF_GEN_INSTRUMENT,
+                  m_presets[n].m_zones);
+    }
+
+    if (m_presets.empty()) return fail(_("The SoundFont file contains no preset"));
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+const SoundFont::Preset* SoundFont::findPreset(const int bank, const int program) const
+{
+    const int fallbackBank = (bank >= 128 ? 128 : 0);
+    const Preset* fallback = NULL;
+
+    const int count = m_presets.size();
+    for (int n=0; n<count; n++)
+    {
+        const Preset& preset = m_presets[n];
+        if (preset.m_bank == bank and preset.m_program == program) return &preset;
+
+        if (fallback == NULL and preset.m_bank == fallbackBank and
+            (preset.m_program == program or fallbackBank == 128))
+        {
+            fallback = &preset;
+        }
+    }
+
+    return (fallback != NULL ? fallback : &m_presets[0]);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void SoundFont::findVoices(const int bank, const int program, const int key, const int velocity,
+                           std::vector<SoundFontVoiceInfo>& out) const
+{
+    if (m_presets.empty()) return;
+
+    const Preset* preset = findPreset(bank, program);
+
+    const int presetZoneAmount = preset->m_zones.size();
+    for (int p=0; p<presetZoneAmount; p++)
+    {
+        const Zone& presetZone = preset->m_zones[p];
+        if (not presetZone.matches(key, velocity)) continue;
+
+        const int instrumentId = presetZone.m_gens[SF_GEN_INSTRUMENT];
+        if (instrumentId < 0 or instrumentId >= (int)m_instruments.size()) continue;
+
+        const Instrument& instrument = m_instruments[instrumentId];
+        const int instZoneAmount = instrument.m_zones.size();
+        for (int i=0; i<instZoneAmount; i++)
+        {
+            const Zone& instZone = instrument.m_zones[i];
+            if (not instZone.matches(key, velocity)) continue;
+
+            const int sampleId = instZone.m_gens[SF_GEN_SAMPLE_ID];
+            if (sampleId < 0 or sampleId >= (int)m_samples.size()) continue;
+
+            SoundFontVoiceInfo info;
+            info.m_sample = &m_samples[sampleId];
+
+            setInstrumentDefaults(info.m_gens);
+            for (int g=0; g<SF_GEN_COUNT; g++)
+            {
+                if (instZone.m_set[g]) info.m_gens[g] = instZone.m_gens[g];
+                if (presetZone.m_set[g] and isAdditive(g)) info.m_gens[g] += presetZone.m_gens[g];
+            }
+
+            out.push_back(info);
+        }
+    }
+}
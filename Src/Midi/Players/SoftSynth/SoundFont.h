@@ -0,0 +1,165 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __SOUND_FONT_H__
+#define __SOUND_FONT_H__
+
+#include <stdint.h>
+#include <vector>
+#include <wx/string.h>
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief Generator operators of the SoundFont 2.01 specification that the built-in synth understands
+      * @ingroup midi.players
+      */
+    enum SoundFontGenerator
+    {
+        SF_GEN_START_OFFSET              = 0,
+        SF_GEN_END_OFFSET                = 1,
+        SF_GEN_START_LOOP_OFFSET         = 2,
+        SF_GEN_END_LOOP_OFFSET           = 3,
+        SF_GEN_START_COARSE_OFFSET       = 4,
+        SF_GEN_END_COARSE_OFFSET         = 12,
+        SF_GEN_PAN                       = 17,
+        SF_GEN_DELAY_VOL_ENV             = 33,
+        SF_GEN_ATTACK_VOL_ENV            = 34,
+        SF_GEN_HOLD_VOL_ENV              = 35,
+        SF_GEN_DECAY_VOL_ENV             = 36,
+        SF_GEN_SUSTAIN_VOL_ENV           = 37,
+        SF_GEN_RELEASE_VOL_ENV           = 38,
+        SF_GEN_INSTRUMENT                = 41,
+        SF_GEN_KEY_RANGE                 = 43,
+        SF_GEN_VEL_RANGE                 = 44,
+        SF_GEN_START_LOOP_COARSE_OFFSET  = 45,
+        SF_GEN_INITIAL_ATTENUATION       = 48,
+        SF_GEN_END_LOOP_COARSE_OFFSET    = 50,
+        SF_GEN_COARSE_TUNE               = 51,
+        SF_GEN_FINE_TUNE                 = 52,
+        SF_GEN_SAMPLE_ID                 = 53,
+        SF_GEN_SAMPLE_MODES              = 54,
+        SF_GEN_SCALE_TUNING              = 56,
+        SF_GEN_EXCLUSIVE_CLASS           = 57,
+        SF_GEN_OVERRIDING_ROOT_KEY       = 58,
+
+        SF_GEN_COUNT                     = 61
+    };
+
+    /**
+      * @brief A sample header ('shdr' record) of a SoundFont; positions are in sample points
+      * @ingroup midi.players
+      */
+    struct SoundFontSample
+    {
+        uint32_t m_start;
+        uint32_t m_end;
+        uint32_t m_loop_start;
+        uint32_t m_loop_end;
+        uint32_t m_sample_rate;
+        int      m_original_key;
+        int      m_pitch_correction;
+    };
+
+    /**
+      * @brief Everything needed to start one voice : the sample to play, and the generator values obtained
+      *        by combining an instrument zone with the preset zone that refers to it
+      * @ingroup midi.players
+      */
+    struct SoundFontVoiceInfo
+    {
+        const SoundFontSample* m_sample;
+        int m_gens[SF_GEN_COUNT];
+    };
+
+    /**
+      * @brief A SoundFont 2 bank, loaded entirely in memory for use by the offline renderer
+      *
+      * Only the parts of the format needed to play samples are read : presets, instruments, their zones and
+      * generators, and the 16 bit sample data. Modulators are ignored, the default modulators of the
+      * specification (velocity to attenuation, etc.) are applied by the renderer.
+      *
+      * @ingroup midi.players
+      */
+    class SoundFont
+    {
+        struct Zone
+        {
+            int  m_gens[SF_GEN_COUNT];
+            bool m_set[SF_GEN_COUNT];
+
+            Zone();
+            bool matches(const int key, const int velocity) const;
+        };
+
+        /** zones are stored with the generators of the global zone already merged in */
+        struct Instrument
+        {
+            std::vector<Zone> m_zones;
+        };
+
+        struct Preset
+        {
+            int m_bank;
+            int m_program;
+            std::vector<Zone> m_zones;
+        };
+
+        std::vector<int16_t>         m_sample_data;
+        std::vector<SoundFontSample> m_samples;
+        std::vector<Instrument>      m_instruments;
+        std::vector<Preset>          m_presets;
+        wxString                     m_error;
+
+        bool fail(const wxString& message);
+        bool parseHydra(const char* data, const uint32_t size);
+
+        static void readZones(const char* bags, const char* gens, const uint32_t genAmount,
+                              const uint32_t firstBag, const uint32_t lastBag, const int terminalGen,
+                              std::vector<Zone>& out);
+
+        const Preset* findPreset(const int bank, const int program) const;
+
+    public:
+
+        /** @brief load a .sf2 file; on failure, 'getError' describes the problem */
+        bool loadFromFile(const wxString& path);
+
+        /** @brief load a SoundFont from a buffer holding the contents of a .sf2 file */
+        bool loadFromMemory(const char* data, const uint32_t size);
+
+        const wxString& getError() const { return m_error; }
+
+        const int16_t* getSampleData() const { return m_sample_data.empty() ? NULL : &m_sample_data[0]; }
+        uint32_t getSampleDataLength() const { return m_sample_data.size(); }
+
+        /**
+          * @brief find the voices to start for a note.
+          *
+          * If the requested bank does not have the program, falls back to bank 0 (or 128 for percussion
+          * banks), then to the first preset of the font.
+          *
+          * @param[out] out  receives one entry per matching instrument zone
+          */
+        void findVoices(const int bank, const int program, const int key, const int velocity,
+                        std::vector<SoundFontVoiceInfo>& out) const;
+    };
+
+}
+
+#endif
@@ -45,6 +45,9 @@ const int CURRENT_FILE_VERSION = 4;
 #include <wx/msgdlg.h>
 #include "irrXML/irrXML.h"
 
+#include <algorithm>
+#include <vector>
+
 using namespace AriaMaestosa;
 
 // ----------------------------------------------------------------------------------------------------------
@@ -66,6 +69,7 @@ Sequence::Sequence(IPlaybackModeListener* playbackListener, IActionStackListener
     m_playback_start_tick       = 0;
     m_default_key_type          = KEY_TYPE_C;
     m_default_key_symbol_amount = 0;
+    m_undo_memory_budget        = DEFAULT_UNDO_MEMORY_BUDGET;
     
     m_sequence_filename     = new Model<wxString>( _("Untitled") );
     channelManagement = CHANNEL_AUTO;
@@ -182,6 +186,7 @@ void Sequence::setChannelManagementType(ChannelManagementType type)
 void Sequence::setTicksPerQuarterNote(int res)
 {
     m_quarterNoteResolution = res;
+    m_tempo_map.invalidate();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -251,6 +256,7 @@ void Sequence::scale(float factor,
 void Sequence::setTempo(int tmp)
 {
     m_tempo = tmp;
+    m_tempo_map.invalidate();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -276,6 +282,37 @@ float Sequence::getTempoAtTick(const int tick) const
 
 // ----------------------------------------------------------------------------------------------------------
 
+static bool tempoChangeOrder(const std::pair<int, float>& a, const std::pair<int, float>& b)
+{
+    return a.first < b.first;
+}
+
+const TempoMap& Sequence::getTempoMap() const
+{
+    if (m_tempo_map.isDirty())
+    {
+        // tempo events should already be in order, but see 'sortTempoEvents'
+        std::vector< std::pair<int, float> > changes;
+        const int amount = m_tempo_events.size();
+        changes.reserve(amount);
+        for (int n=0; n<amount; n++)
+        {
+            changes.push_back( std::make_pair(m_tempo_events[n].getTick(),
+                                              convertTempoBendToBPM(m_tempo_events[n].getValue())) );
+        }
+        std::stable_sort(changes.begin(), changes.end(), tempoChangeOrder);
+        
+        m_tempo_map.reset(m_tempo, m_quarterNoteResolution);
+        for (int n=0; n<amount; n++)
+        {
+            m_tempo_map.addTempoChangeBPM(changes[n].first, changes[n].second);
+        }
+    }
+    return m_tempo_map;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
 void Sequence::addTempoEvent(ControllerEvent* evt, wxFloat64* previousValue)
 {
     // add to any track, they will redirect tempo events to the right one.
@@ -288,6 +325,7 @@ void Sequence::addTempoEvent(ControllerEvent* evt, wxFloat64* previousValue)
 void Sequence::addTempoEvent_import( ControllerEvent* evt )
 {
     m_tempo_events.push_back(evt);
+    m_tempo_map.invalidate();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -297,14 +335,15 @@ void Sequence::addTempoEvent_import( ControllerEvent* evt )
  */
 void Sequence::sortTempoEvents()
 {
-    m_tempo_events.insertionSort();
+    m_tempo_events.mergeSort();
+    m_tempo_map.invalidate();
 }
 
 // ----------------------------------------------------------------------------------------------------------
 
 void Sequence::sortTextEvents()
 {
-    m_text_events.insertionSort();
+    m_text_events.mergeSort();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -471,6 +510,14 @@ void Sequence::action( Action::MultiTrackAction* actionObj)
     addToUndoStack( actionObj );
     actionObj->setParentSequence(this, new SequenceVisitor(this));
     actionObj->perform();
+    trimUndoStack();
+    
+    for (int n=0; n<tracks.size(); n++)
+    {
+        tracks[n].invalidateNoteIndex();
+        tracks[n].invalidateControlEventIndex();
+    }
+    m_tempo_map.invalidate();
     
     if (m_action_stack_listener != NULL) m_action_stack_listener->onActionStackChanged();
     
@@ -492,10 +539,48 @@ void Sequence::addToUndoStack( Action::EditAction* actionObj )
         undoStack.swap(undoStack.size() - 1, undoStack.size() - 2);
     }
     
+    if (m_action_stack_listener != NULL) m_action_stack_listener->onActionStackChanged();
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+size_t Sequence::getUndoStackMemoryUsage() const
+{
+    size_t total = 0;
+    const int count = undoStack.size();
+    for (int n=0; n<count; n++)
+    {
+        total += undoStack[n].getMemoryUsage();
+    }
+    return total;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void Sequence::trimUndoStack()
+{
+    if (undoStack.size() <= MIN_UNDO_LEVELS) return;
+    
     // remove old actions from undo stack, to not take memory uselessly
-    if (undoStack.size() > 8) undoStack.erase(0);
+    size_t total = getUndoStackMemoryUsage();
+    bool trimmed = false;
+    while (undoStack.size() > MAX_UNDO_LEVELS or
+           (total > m_undo_memory_budget and undoStack.size() > MIN_UNDO_LEVELS))
+    {
+        total -= undoStack[0].getMemoryUsage();
+        undoStack.erase(0);
+        trimmed = true;
+    }
     
-    if (m_action_stack_listener != NULL) m_action_stack_listener->onActionStackChanged();
+    if (trimmed and m_action_stack_listener != NULL) m_action_stack_listener->onActionStackChanged();
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void Sequence::setUndoMemoryBudget(const size_t bytes)
+{
+    m_undo_memory_budget = bytes;
+    trimUndoStack();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -518,6 +603,13 @@ void Sequence::undo()
     
     lastAction->undo();
     undoStack.erase( undoStack.size() - 1 );
+    
+    for (int n=0; n<tracks.size(); n++)
+    {
+        tracks[n].invalidateNoteIndex();
+        tracks[n].invalidateControlEventIndex();
+    }
+    m_tempo_map.invalidate();
 
     if (m_seq_data_listener != NULL) m_seq_data_listener->onSequenceDataChanged();
     
@@ -895,6 +987,7 @@ bool Sequence::readFromFile(irr::io::IrrXMLReader* xml, GraphicalSequence* gseq)
             m_tempo = 120;
             std::cerr << "Missing info from file: main tempo" << std::endl;
         }
+        m_tempo_map.invalidate();
         
         const char* fileFormatVersion = xml->getAttributeValue("fileFormatVersion");
         int fileversion = -1;
@@ -1088,6 +1181,7 @@ bool Sequence::readFromFile(irr::io::IrrXMLReader* xml, GraphicalSequence* gseq)
                             else
                             {
                                 m_tempo_events.push_back( temp );
+                                m_tempo_map.invalidate();
                             }
                         }
                         else if (text_mode)
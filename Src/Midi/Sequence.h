@@ -28,6 +28,7 @@ namespace irr { namespace io {
 
 #include "AriaCore.h"
 #include "Actions/EditAction.h"
+#include "Midi/TempoMap.h"
 #include "Midi/Track.h"
 #include "ptr_vector.h"
 #include "Utils.h"
@@ -45,6 +46,16 @@ namespace AriaMaestosa
 
     const int DEFAULT_SONG_LENGTH = 12;
     
+    /** Memory, in bytes, the undo stack may use before its oldest actions are dropped */
+    const size_t DEFAULT_UNDO_MEMORY_BUDGET = 64*1024*1024;
+    
+    /** Amount of undo levels that are always kept, whatever memory they use */
+    const int MIN_UNDO_LEVELS = 8;
+    
+    /** Amount of undo levels after which the oldest are dropped whatever memory they use, in case some
+      * action underestimates what it keeps */
+    const int MAX_UNDO_LEVELS = 256;
+    
     namespace Action { class AddControllerSlide; }
     
     /**
@@ -123,6 +134,9 @@ namespace AriaMaestosa
         ChannelManagementType channelManagement;
 
         ptr_vector<Action::EditAction> undoStack;
+        
+        /** Memory, in bytes, the undo stack may use (see 'trimUndoStack') */
+        size_t m_undo_memory_budget;
 
         IPlaybackModeListener* m_playback_listener;
         
@@ -149,6 +163,9 @@ namespace AriaMaestosa
         ptr_vector<ControllerEvent> m_tempo_events;
         ptr_vector<TextEvent>       m_text_events;
 
+        /** tick <-> time conversions, rebuilt lazily from the main tempo and 'm_tempo_events' */
+        mutable TempoMap m_tempo_map;
+
         /** this object is to be modified by MainFrame, to remember where to save this sequence */
         wxString m_filepath;
         
@@ -230,6 +247,24 @@ namespace AriaMaestosa
         /** @brief you do not need to call this yourself, Track::action and Sequence::action do. */
         void addToUndoStack( Action::EditAction* action );
         
+        /**
+          * @brief drop the oldest actions of the undo stack until the memory they keep fits in the undo
+          *        memory budget; the latest MIN_UNDO_LEVELS actions are always kept, and no more than
+          *        MAX_UNDO_LEVELS actions are ever kept.
+          * @note  you do not need to call this yourself, Track::action and Sequence::action do once the
+          *        action was performed (its memory usage is only known then)
+          */
+        void trimUndoStack();
+        
+        /** @return memory, in bytes, kept by the actions of the undo stack */
+        size_t getUndoStackMemoryUsage() const;
+        
+        size_t getUndoMemoryBudget() const { return m_undo_memory_budget; }
+        void   setUndoMemoryBudget(const size_t bytes);
+        
+        /** @return amount of actions that can currently be undone */
+        int getUndoLevelCount() const { return undoStack.size(); }
+        
         Action::EditAction* getLatestAction()
         {
             if (undoStack.size() == 0) return NULL;
@@ -319,6 +354,12 @@ namespace AriaMaestosa
         /** @return the tempo at any tick (not necessarily a tick where there is a tempo change event) */
         float getTempoAtTick(const int tick) const;
         
+        /** @return the tempo map of this sequence, first rebuilt if tempo events changed since the last call */
+        const TempoMap& getTempoMap() const;
+        
+        /** @brief must be called after modifying tempo events other than through this class or actions */
+        void invalidateTempoMap() { m_tempo_map.invalidate(); }
+        
         void  addTempoEvent(ControllerEvent* evt, wxFloat64* previousValue);
         void sortTempoEvents();
         void sortTextEvents();
@@ -327,9 +368,9 @@ namespace AriaMaestosa
         
         int                    getTempoEventAmount() const { return m_tempo_events.size();  }
         const ControllerEvent* getTempoEvent(int id) const { return m_tempo_events.getConst(id); }
-        void eraseTempoEvent(int id) { m_tempo_events.erase(id); }
-        void setTempoEventValue(int id, int newValue) { m_tempo_events[id].setValue(newValue); }
-        void setTempoEventTick (int id, int newTick)  { m_tempo_events[id].setTick(newTick);  }
+        void eraseTempoEvent(int id) { m_tempo_events.erase(id); m_tempo_map.invalidate(); }
+        void setTempoEventValue(int id, int newValue) { m_tempo_events[id].setValue(newValue); m_tempo_map.invalidate(); }
+        void setTempoEventTick (int id, int newTick)  { m_tempo_events[id].setTick(newTick);   m_tempo_map.invalidate(); }
         ControllerEvent* getTempoEventAt(int tick);
 
         /** @return Returns the old value there was, if any, before this new event replaces it.*/
@@ -350,9 +391,10 @@ namespace AriaMaestosa
         {
             ControllerEvent* evt = m_tempo_events.get(id);
             m_tempo_events.markToBeRemoved(id);
+            m_tempo_map.invalidate();
             return evt;
         }
-        void removeMarkedTempoEvents()        { m_tempo_events.removeMarked();      }
+        void removeMarkedTempoEvents()        { m_tempo_events.removeMarked(); m_tempo_map.invalidate(); }
 
         TextEvent* extractTextEvent(int id)
         {
@@ -0,0 +1,189 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Midi/TempoMap.h"
+#include "UnitTest.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace AriaMaestosa;
+
+// ----------------------------------------------------------------------------------------------------------
+
+TempoMap::TempoMap()
+{
+    reset(120, 960);
+    m_dirty = true;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int64_t TempoMap::ticksToNanos(const int64_t ticks, const int64_t nsPerBeat) const
+{
+    // split to avoid overflowing on long segments
+    const int64_t beats = ticks / m_beat_length;
+    const int64_t rest  = ticks % m_beat_length;
+    return beats*nsPerBeat + rest*nsPerBeat/m_beat_length;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void TempoMap::reset(const double initialBpm, const int beatLength)
+{
+    m_beat_length = std::max(1, beatLength);
+
+    m_segments.clear();
+
+    Segment first;
+    first.m_tick        = 0;
+    first.m_start_ns    = 0;
+    first.m_ns_per_beat = 0;
+    m_segments.push_back(first);
+    addTempoChangeBPM(0, initialBpm);
+
+    m_dirty = false;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void TempoMap::addTempoChange(const int tick, const int64_t nsPerBeat)
+{
+    Segment& last = m_segments[m_segments.size() - 1];
+    ASSERT_E(tick, >=, last.m_tick);
+
+    if (tick <= last.m_tick)
+    {
+        last.m_ns_per_beat = std::max<int64_t>(1, nsPerBeat);
+        return;
+    }
+
+    Segment segment;
+    segment.m_tick        = tick;
+    segment.m_start_ns    = last.m_start_ns + ticksToNanos(tick - last.m_tick, last.m_ns_per_beat);
+    segment.m_ns_per_beat = std::max<int64_t>(1, nsPerBeat);
+    m_segments.push_back(segment);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void TempoMap::addTempoChangeBPM(const int tick, const double bpm)
+{
+    addTempoChange(tick, (int64_t)round(60.0*NANOS_PER_SEC / std::max(1.0, bpm)));
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int TempoMap::findSegmentByTick(const int tick) const
+{
+    int low  = 0;
+    int high = m_segments.size() - 1;
+    while (low < high)
+    {
+        const int mid = (low + high + 1)/2;
+        if (m_segments[mid].m_tick <= tick) low  = mid;
+        else                                high = mid - 1;
+    }
+    return low;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int TempoMap::findSegmentByTime(const int64_t ns) const
+{
+    int low  = 0;
+    int high = m_segments.size() - 1;
+    while (low < high)
+    {
+        const int mid = (low + high + 1)/2;
+        if (m_segments[mid].m_start_ns <= ns) low  = mid;
+        else                                  high = mid - 1;
+    }
+    return low;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int64_t TempoMap::tickToNanos(const int tick) const
+{
+    const Segment& segment = m_segments[findSegmentByTick(tick)];
+    return segment.m_start_ns + ticksToNanos(tick - segment.m_tick, segment.m_ns_per_beat);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int TempoMap::nanosToTick(const int64_t ns) const
+{
+    const Segment& segment = m_segments[findSegmentByTime(ns)];
+    return segment.m_tick + (int)((ns - segment.m_start_ns)*m_beat_length / segment.m_ns_per_beat);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+double TempoMap::getTempoAtTick(const int tick) const
+{
+    return 60.0*NANOS_PER_SEC / m_segments[findSegmentByTick(tick)].m_ns_per_beat;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestTempoMap
+{
+
+    UNIT_TEST( TestTempoChanges )
+    {
+        TempoMap map;
+        require(map.isDirty(), "a new map needs to be built");
+
+        // 960 ticks per beat : 4 beats at 120 BPM (2 s), 4 beats at 60 BPM (4 s), then 240 BPM
+        map.reset(120, 960);
+        map.addTempoChangeBPM(3840, 60);
+        map.addTempoChangeBPM(7680, 240);
+        require(not map.isDirty(), "map was built");
+        require_e(map.getSegmentAmount(), ==, 3, "one segment per tempo");
+
+        require_e(map.tickToNanos(0),      ==, 0,                            "song starts at time 0");
+        require_e(map.tickToNanos(1920),   ==, TempoMap::NANOS_PER_SEC,      "first segment is at 120 BPM");
+        require_e(map.tickToNanos(3840),   ==, 2*TempoMap::NANOS_PER_SEC,    "segments are accumulated");
+        require_e(map.tickToNanos(4800),   ==, 3*TempoMap::NANOS_PER_SEC,    "second segment is at 60 BPM");
+        require_e(map.tickToNanos(7680+960*4), ==, 7*TempoMap::NANOS_PER_SEC, "last segment extends forever");
+
+        require_e(map.nanosToTick(0),                          ==, 0,    "time to tick is the inverse");
+        require_e(map.nanosToTick(3*TempoMap::NANOS_PER_SEC),  ==, 4800, "time to tick is the inverse");
+        require_e(map.secondsToTick(6.5),                      ==, 7680 + 1920, "time to tick is the inverse");
+
+        require_e((int)round(map.getTempoAtTick(3839)), ==, 120, "tempo before a change");
+        require_e((int)round(map.getTempoAtTick(3840)), ==, 60,  "tempo at a change");
+        require_e((int)round(map.getTempoAtTick(99999)), ==, 240, "tempo after the last change");
+    }
+
+    UNIT_TEST( TestChangeAtSameTick )
+    {
+        TempoMap map;
+        map.reset(120, 480);
+
+        // a tempo event at tick 0 replaces the song tempo
+        map.addTempoChangeBPM(0, 60);
+        require_e(map.getSegmentAmount(), ==, 1, "change at same tick replaces the segment");
+        require_e(map.tickToNanos(480), ==, TempoMap::NANOS_PER_SEC, "replaced tempo is used");
+
+        require_e(map.nanosToTick(-1), <=, 0, "times before the song start map to the first segment");
+    }
+
+}
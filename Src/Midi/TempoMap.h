@@ -0,0 +1,105 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __TEMPO_MAP_H__
+#define __TEMPO_MAP_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief Converts between ticks and elapsed time, taking all tempo changes into account
+      *
+      * The song is cut into segments of constant tempo; each segment remembers the time (in integer
+      * nanoseconds) elapsed from the start of the song to its first tick, so that a conversion is a
+      * binary search for the segment followed by one multiplication, instead of summing all previous
+      * tempo changes. Like NoteRangeIndex, the map does not observe the tempo events itself : the owner
+      * rebuilds it (with 'reset' then 'addTempoChange') after calling 'invalidate'.
+      *
+      * @ingroup midi
+      */
+    class TempoMap
+    {
+        struct Segment
+        {
+            int     m_tick;
+            int64_t m_start_ns;
+            int64_t m_ns_per_beat;
+        };
+
+        std::vector<Segment> m_segments;
+        int  m_beat_length;
+        bool m_dirty;
+
+        int64_t ticksToNanos(const int64_t ticks, const int64_t nsPerBeat) const;
+
+        /** @return index of the last segment for which 'key(segment) <= value' (0 if none) */
+        int findSegmentByTick(const int tick) const;
+        int findSegmentByTime(const int64_t ns) const;
+
+    public:
+
+        static const int64_t NANOS_PER_SEC = 1000000000;
+
+        TempoMap();
+
+        /** @brief mark the map as out of date, the owner will rebuild it on next use */
+        void invalidate() { m_dirty = true; }
+
+        bool isDirty() const { return m_dirty; }
+
+        /**
+          * @brief start building a new map
+          * @param initialBpm tempo at the start of the song, in beats per minute
+          * @param beatLength number of ticks in a quarter note
+          */
+        void reset(const double initialBpm, const int beatLength);
+
+        /**
+          * @brief add a tempo change; changes must be added in tick order. A change at the same tick
+          *        as the previous one replaces it.
+          */
+        void addTempoChange(const int tick, const int64_t nsPerBeat);
+
+        /** @brief same as above, with the tempo given in beats per minute */
+        void addTempoChangeBPM(const int tick, const double bpm);
+
+        /** @return time elapsed from the start of the song to the given tick, in nanoseconds */
+        int64_t tickToNanos(const int tick) const;
+
+        /** @return the tick being played after the given time has elapsed from the start of the song */
+        int nanosToTick(const int64_t ns) const;
+
+        /** @return time elapsed from the start of the song to the given tick, in seconds */
+        double tickToSeconds(const int tick) const { return tickToNanos(tick) / (double)NANOS_PER_SEC; }
+
+        /** @return the tick being played after the given number of seconds */
+        int secondsToTick(const double seconds) const { return nanosToTick((int64_t)(seconds*NANOS_PER_SEC)); }
+
+        /** @return the tempo, in beats per minute, at any tick */
+        double getTempoAtTick(const int tick) const;
+
+        /** @return number of segments of constant tempo */
+        int getSegmentAmount() const { return m_segments.size(); }
+    };
+
+}
+
+#endif
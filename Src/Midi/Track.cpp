@@ -151,6 +151,10 @@ void Track::action( Action::SingleTrackAction* actionObj)
     actionObj->setParentTrack(this, new TrackVisitor(this));
     m_sequence->addToUndoStack( actionObj );
     actionObj->perform();
+    m_sequence->trimUndoStack();
+    invalidateNoteIndex();
+    invalidateControlEventIndex();
+    m_sequence->invalidateTempoMap();
     
     ASSERT(m_sequence->invariant());
 }
@@ -182,6 +186,8 @@ const GraphicalTrack* Track::getGraphics() const
 
 bool Track::addNote(Note* note, bool check_for_overlapping_notes)
 {
+    invalidateNoteIndex();
+    
     // if we're importing, just push it to the end, we know they're in time order
     if (m_sequence->isImportMode())
     {
@@ -190,67 +196,64 @@ bool Track::addNote(Note* note, bool check_for_overlapping_notes)
         return true;
     }
 
-    bool noteAdded=false;
-
     //------------------------ place note on -----------------------
-    // iterate through notes to place them in order
-    const int noteAmount = m_notes.size();
-    for (int n=0; n<noteAmount; n++)
+    // binary search for the insertion point; new notes go after any existing note with the same tick
+    const int noteOnPos = findNoteStartUpperBound(note->getTick());
+
+    // check for overlapping notes
+    // the only time where this is not checked is when pasting, because it is then logical that notes are pasted on top of their originals
+    if (check_for_overlapping_notes)
     {
-        // check for overlapping notes
-        // the only time where this is not checked is when pasting, because it is then logical that notes are pasted on top of their originals
-        if (check_for_overlapping_notes and m_notes[n].getTick() == note->getTick() and
-            m_notes[n].getPitchID() == note->getPitchID() and
-           (not m_editor_mode[GUITAR] or m_notes[n].getString() == note->getString()) /*in guitar mode string must also match to be considered overlapping*/ )
+        // all notes starting at the same tick are contiguous and immediately precede the insertion point
+        for (int n=noteOnPos-1; n>=0 and m_notes[n].getTick() == note->getTick(); n--)
         {
-            std::cout << "overlapping notes: rejected" << std::endl;
-            return false;
+            if (m_notes[n].getPitchID() == note->getPitchID() and
+                (not m_editor_mode[GUITAR] or m_notes[n].getString() == note->getString()) /*in guitar mode string must also match to be considered overlapping*/ )
+            {
+                std::cout << "overlapping notes: rejected" << std::endl;
+                return false;
+            }
         }
+    }
 
-        if (m_notes[n].getTick() > note->getTick())
-        {
+    m_notes.add(note, noteOnPos);
 
-            m_notes.add(note, n);
-            noteAdded=true;
-            break;
-        }//endif
+    //------------------------ place note off -----------------------
+    m_note_off.add(note, findNoteEndUpperBound(note->getEndTick()));
 
+    return true;
+}
 
-    }//next
+// ----------------------------------------------------------------------------------------------------------
 
-    if (!noteAdded)
+int Track::findNoteStartUpperBound(const int tick) const
+{
+    // first note whose start tick is strictly greater than 'tick'
+    int low  = 0;
+    int high = m_notes.size();
+    while (low < high)
     {
-        // add note at the end, or if the track does not yet contain any note
-        // (both cases in which the for loop either won't find a location for the note, or won't iterate at all)
-        m_notes.push_back(note);
+        const int mid = low + (high - low)/2;
+        if (m_notes[mid].getTick() > tick) high = mid;
+        else                               low = mid + 1;
     }
+    return low;
+}
 
-    //------------------------ place note off -----------------------
-    // iterate through notes to place them in order
-
-    noteAdded = false;
-
-    const int noteOffAmount = m_note_off.size();
-    for (int n=0; n<noteOffAmount; n++)
-    {
-        if (m_note_off[n].getEndTick() > note->getEndTick())
-        {
-            m_note_off.add(note, n);
-            noteAdded = true;
-            break;
-        }//endif
-    }//next
+// ----------------------------------------------------------------------------------------------------------
 
-    if (not noteAdded)
+int Track::findNoteEndUpperBound(const int endTick) const
+{
+    // first note off whose end tick is strictly greater than 'endTick'
+    int low  = 0;
+    int high = m_note_off.size();
+    while (low < high)
     {
-        // add note at the end, or if the track does not yet contain any note
-        // (both cases in which the for loop either won't find a location for the note, or won't iterate at all)
-        m_note_off.push_back(note);
+        const int mid = low + (high - low)/2;
+        if (m_note_off[mid].getEndTick() > endTick) high = mid;
+        else                                        low = mid + 1;
     }
-
-
-    return true;
-
+    return low;
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -262,9 +265,17 @@ void Track::addControlEvent( ControllerEvent* evt, wxFloat64* previousValue )
     if (previousValue != NULL) *previousValue = -1;
 
     // tempo events
-    if (evt->getController() == PSEUDO_CONTROLLER_TEMPO) vector = &m_sequence->m_tempo_events;
+    if (evt->getController() == PSEUDO_CONTROLLER_TEMPO)
+    {
+        vector = &m_sequence->m_tempo_events;
+        m_sequence->invalidateTempoMap();
+    }
     // controller and pitch bend events
-    else vector = &m_control_events;
+    else
+    {
+        vector = &m_control_events;
+        invalidateControlEventIndex();
+    }
 
     // don't bother checking order if we're importing, we know its in time order and all
     // FIXME - what about 'addControlEvent_import' ??
@@ -277,29 +288,21 @@ void Track::addControlEvent( ControllerEvent* evt, wxFloat64* previousValue )
     ASSERT_E(evt->getController(),<,205);
     ASSERT_E(evt->getValue(),<,128);
 
-    const int eventAmount=vector->size();
-    for (int n=0; n<eventAmount; n++)
+    // the new event goes before all events at the same tick or later
+    const int position = ControlEventIndex::lowerBoundByTick(*vector, evt->getTick());
+    
+    // if there is already an event of same type at same time, remove it first
+    for (int n=position; n<vector->size() and (*vector)[n].getTick() == evt->getTick(); n++)
     {
-        if ( (*vector)[n].getTick() == evt->getTick())
+        if ((*vector)[n].getController() == evt->getController())
         {
-            // if there is already an even of same type at same time, remove it first
-            if ((*vector)[n].getController() == evt->getController() )
-            {
-                if (previousValue != NULL) *previousValue = (*vector)[n].getValue();
-                vector->erase(n);
-            }
-            vector->add( evt, n );
-            return;
+            if (previousValue != NULL) *previousValue = (*vector)[n].getValue();
+            vector->erase(n);
+            break;
         }
-        else if ( (*vector)[n].getTick() > evt->getTick() )
-        {
-            vector->add( evt, n );
-            return;
-        }//endif
-
-    }//next
-
-    vector->push_back( evt );
+    }
+    
+    vector->add( evt, position );
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -308,6 +311,7 @@ void Track::addControlEvent_import(const int x, const wxFloat64 value, const int
 {
     ASSERT(m_sequence->isImportMode()); // not to be used when not importing
     m_control_events.push_back(new ControllerEvent(controller, x, value) );
+    invalidateControlEventIndex();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -330,12 +334,14 @@ void Track::setNoteEnd_import(const int tick, const int noteID)
     ASSERT_E(noteID,>=,0);
 
     m_notes[noteID].setEndTick(tick);
+    invalidateNoteIndex();
 }
 
 // ----------------------------------------------------------------------------------------------------------
 
 void Track::removeNote(const int id)
 {
+    invalidateNoteIndex();
 
     // also delete corresponding note off event
     const int namount = m_note_off.size();
@@ -376,6 +382,7 @@ void Track::markNoteToBeRemoved(const int id)
     }
 
     m_notes.markToBeRemoved(id);
+    invalidateNoteIndex();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -387,6 +394,7 @@ void Track::removeMarkedNotes()
 
     m_notes.removeMarked();
     m_note_off.removeMarked();
+    invalidateNoteIndex();
 
 #ifdef _MORE_DEBUG_CHECKS
     if (m_notes.size() != m_note_off.size())
@@ -406,7 +414,8 @@ int getNoteTick(Note* note)
 
 void Track::reorderNoteVector()
 {
-    m_notes.insertionSort(getNoteTick);
+    m_notes.mergeSort(getNoteTick);
+    invalidateNoteIndex();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -418,14 +427,15 @@ int getNoteEndTick(Note* note)
 
 void Track::reorderNoteOffVector()
 {
-    m_note_off.insertionSort(getNoteEndTick);
+    m_note_off.mergeSort(getNoteEndTick);
 }
 
 // ----------------------------------------------------------------------------------------------------------
 
 void Track::reorderControlVector()
 {
-    m_control_events.insertionSort();
+    m_control_events.mergeSort();
+    invalidateControlEventIndex();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -580,13 +590,9 @@ int Track::getNoteFretConst(const int id) const
 
 int Track::findFirstNoteInRange(const int fromTick, const int toTick) const
 {
-    const int noteAmount = m_notes.size();
-
-    for (int n=0; n<noteAmount; n++)
-    {
-        if (m_notes[n].getTick() >= fromTick and m_notes[n].getTick() < toTick) return n;
-        if (m_notes[n].getTick() >= toTick) return -1;
-    }
+    const int n = NoteRangeIndex::lowerBound(m_notes, fromTick);
+    
+    if (n < m_notes.size() and m_notes[n].getTick() < toTick) return n;
     return -1;
 }
 
@@ -594,18 +600,30 @@ int Track::findFirstNoteInRange(const int fromTick, const int toTick) const
 
 int Track::findLastNoteInRange(const int fromTick, const int toTick) const
 {
-    const int noteAmount = m_notes.size();
-
-    for (int n=noteAmount-1; n>-1; n--)
-    {
-        if (m_notes[n].getTick() >= fromTick and m_notes[n].getTick() < toTick) return n;
-        if (m_notes[n].getTick() < fromTick) return -1;
-    }
+    const int n = NoteRangeIndex::lowerBound(m_notes, toTick) - 1;
+    
+    if (n >= 0 and m_notes[n].getTick() >= fromTick) return n;
     return -1;
 }
 
 // ----------------------------------------------------------------------------------------------------------
 
+const NoteColumns& Track::getNoteColumns() const
+{
+    if (m_note_columns.isDirty()) m_note_columns.rebuild(m_notes);
+    return m_note_columns;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void Track::findNotesInRange(const int fromTick, const int toTick, std::vector<int>& out) const
+{
+    if (m_note_range_index.isDirty()) m_note_range_index.rebuild(m_notes);
+    m_note_range_index.findNotesInRange(m_notes, fromTick, toTick, out);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
 int Track::getControllerEventAmount(const bool isLyrics, const bool isTempo) const
 {
     if (isTempo)       return m_sequence->getTempoEventAmount();
@@ -623,16 +641,27 @@ int Track::getControllerEventAmount(const int controller) const
     }
     else
     {
-        int occurrences = 0;
+        return getControllerEventIDs(controller).size();
+    }
+}
 
-        const int count = m_control_events.size();
-        for (int n=0; n<count; n++)
-        {
-            if (m_control_events[n].getController() == controller) occurrences++;
-        }
+// ----------------------------------------------------------------------------------------------------------
 
-        return occurrences;
-    }
+const std::vector<int>& Track::getControllerEventIDs(const int controller) const
+{
+    ASSERT(not Track::isTempoController(controller));
+    ASSERT_E(controller, !=, PSEUDO_CONTROLLER_LYRICS);
+    
+    updateControlEventIndex();
+    return m_control_event_index.getEventIDs(controller);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int Track::findFirstControllerEventFrom(const int controller, const int tick) const
+{
+    updateControlEventIndex();
+    return m_control_event_index.lowerBound(m_control_events, controller, tick);
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -666,15 +695,9 @@ int Track::getFirstNoteTick(bool selectionOnly) const
 
     if (not selectionOnly) return m_notes[0].getTick();
 
-    const int noteAmount = m_notes.size();
-    int tick = -1;
-
-    for (int n=0; n<noteAmount; n++)
-    {
-        if ( m_notes[n].isSelected() ) return m_notes[n].getTick();
-    }//next
-
-    return tick;
+    const NoteColumns& columns = getNoteColumns();
+    const int n = columns.findFirstSelected();
+    return (n == -1 ? -1 : columns.getTick(n));
 
 }
 
@@ -682,12 +705,7 @@ int Track::getFirstNoteTick(bool selectionOnly) const
 
 int Track::getFirstSelectedNote() const
 {
-    const int count = m_notes.size();
-    for (int n=0; n<count; n++)
-    {
-        if (m_notes[n].isSelected()) return n;
-    }
-    return -1;
+    return getNoteColumns().findFirstSelected();
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -695,6 +713,8 @@ int Track::getFirstSelectedNote() const
 void Track::selectNote(const int id, const bool selected, bool ignoreModifiers)
 {
     ASSERT(id != SELECTED_NOTES); // not supported in this function
+    
+    m_note_columns.invalidate();
 
     if (not ignoreModifiers and not Display::isSelectMorePressed() and
         not Display::isSelectLessPressed())
@@ -1344,16 +1364,11 @@ int getActiveMin(bool have_a, int a, bool have_b, int b, bool have_c, int c)
 
 ControllerEvent* Track::getControllerEventAt(int tick, int idController)
 {
-    const int eventAmount = m_control_events.size();
-    for (int n=0; n<eventAmount; n++)
-    {
-        if (m_control_events[n].getController() == idController and
-            m_control_events[n].getTick() == tick)
-        {
-            return m_control_events.get(n);
-        }
-    }
-    return NULL;
+    updateControlEventIndex();
+    
+    const int id = m_control_event_index.findEventAt(m_control_events, idController, tick);
+    if (id == -1) return NULL;
+    return m_control_events.get(id);
 }
 
 // ----------------------------------------------------------------------------------------------------------
@@ -1364,8 +1379,6 @@ int Track::addMidiEvents(jdksmidi::MIDITrack* midiTrack,
                          bool selectionOnly,
                          int& startTick)
 {
-    const bool DEBUG_NOTE_ORDER = false;
-    
     // ignore track if it has been muted
     // (but for some reason drum track can't be completely omitted)
     // if we only play selection, ignore mute and play anyway
@@ -1392,14 +1405,6 @@ int Track::addMidiEvents(jdksmidi::MIDITrack* midiTrack,
     int firstNoteStartTick = -1;
     int selectedNoteAmount = 0;
 
-    for (int n=0; n<m_notes.size(); n++)
-    {
-        if (m_notes[n].getLength() <= 1)
-        {
-            fprintf(stderr, "EMPTY NOTE\n");
-        }
-    }
-
     if (selectionOnly)
     {
         const int noteAmount = m_notes.size();
@@ -1549,12 +1554,55 @@ int Track::addMidiEvents(jdksmidi::MIDITrack* midiTrack,
         }
     }
 
+    // if muted and drums, return now
+    if (!m_played and m_editor_mode[DRUM] and not selectionOnly) return -1;
+
+    int last_event_tick;
+    if (selectionOnly)
+    {
+        last_event_tick = compileMidiEvents(midiTrack, channel, firstNoteStartTick, lastTickInSong, true);
+    }
+    else
+    {
+        // only compile notes and controllers again if they (or the settings they are compiled with) changed
+        // since the last time, otherwise reuse the events compiled then
+        const MidiStreamCache::Key key(channel, firstNoteStartTick, lastTickInSong, m_volume, m_editor_mode[DRUM]);
+        if (not m_midi_stream_cache.isValidFor(key))
+        {
+            jdksmidi::MIDITrack& compiled = m_midi_stream_cache.beginCompile(key);
+            m_midi_stream_cache.endCompile( compileMidiEvents(&compiled, channel, firstNoteStartTick,
+                                                              lastTickInSong, false) );
+        }
+        m_midi_stream_cache.copyTo(midiTrack);
+        last_event_tick = m_midi_stream_cache.getLastEventTick();
+    }
+
+    if (selectionOnly) startTick = firstNoteStartTick;
+
+    return last_event_tick - firstNoteStartTick;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+int Track::compileMidiEvents(jdksmidi::MIDITrack* midiTrack, const int channel, const int firstNoteStartTick,
+                             const int lastTickInSong, const bool selectionOnly)
+{
+    const bool DEBUG_NOTE_ORDER = false;
+    
+    for (int n=0; n<m_notes.size(); n++)
+    {
+        if (m_notes[n].getLength() <= 1)
+        {
+            fprintf(stderr, "EMPTY NOTE\n");
+        }
+    }
+
     // ----------------------------------- add events in order --------------------------
     /*
      * The way this section works:
      *
-     * there are currently 3 possible source of events in a track (apart those above, like instrument and
-     * track name): note on, note off, controller change.
+     * there are currently 3 possible source of events in a track (apart those added in 'addMidiEvents',
+     * like instrument and track name): note on, note off, controller change.
      * each type of event is stored in its own vector, in time order.
      * the variables below store the current event (i.e. the first event that hasn't yet been added)
      * the section loops, and with it each iteration it checks the current tick of the 3 current events,
@@ -1562,20 +1610,40 @@ int Track::addMidiEvents(jdksmidi::MIDITrack* midiTrack,
      *
      */
 
-    int note_on_id     = 0;
-    int note_off_id    = 0;
-    int control_evt_id = 0;
+    // skip notes that end or start before the area we play
+    int note_on_id     = findNoteStartUpperBound(firstNoteStartTick - 1);
+    int note_off_id    = findNoteEndUpperBound(firstNoteStartTick - 1);
+    int control_evt_id = ControlEventIndex::lowerBoundByTick(m_control_events, firstNoteStartTick);
 
     const int noteOnAmount     = m_notes.size();
     const int noteOffAmount    = m_note_off.size();
     const int controllerAmount = m_control_events.size();
 
+    // controller changes located before the area we play may still affect it : find the value each
+    // controller has when we start, and set it right away (control events are otherwise ignored when only
+    // playing selection, so there also set those located right where we start)
+    if (firstNoteStartTick <= lastTickInSong)
+    {
+        updateControlEventIndex();
+
+        std::vector<int> inEffect;
+        m_control_event_index.findEventsInEffect(m_control_events, firstNoteStartTick, inEffect);
+
+        const int count = inEffect.size();
+        for (int n=0; n<count; n++)
+        {
+            const ControllerEvent& event = m_control_events[inEffect[n]];
+            if (selectionOnly or event.getTick() < firstNoteStartTick)
+            {
+                if (DEBUG_NOTE_ORDER) printf("[DEBUG_NOTE_ORDER] 0 (controller in effect)\n");
+                addControlMidiEvent(midiTrack, channel, event, 0);
+            }
+        }
+    }
+
     // find track end
     int last_event_tick = 0;
 
-    // if muted and drums, return now
-    if (!m_played and m_editor_mode[DRUM] and not selectionOnly) return -1;
-
     //std::cout << "-------------------- TRACK -------------" << std::endl;
     
     if (DEBUG_NOTE_ORDER) printf("---------------- Track <%s> ----------------\n",
@@ -1690,173 +1758,89 @@ int Track::addMidiEvents(jdksmidi::MIDITrack* midiTrack,
         //  ------------------------ add control change event ------------------------
         else if (activeMin == 1)
         {
-            const int controllerID = m_control_events[control_evt_id].getController();
-
-            int time = m_control_events[control_evt_id].getTick() - firstNoteStartTick;
+            // (controller events located before the area we play were added above, when still in effect)
+            const int time = m_control_events[control_evt_id].getTick() - firstNoteStartTick;
 
             // find track end
             if (time > last_event_tick) last_event_tick = time;
 
-            // controller changes happens before the area we play
-            // but perhaps it still is affecting the area we want to play - check for that.
-            bool doAddControlEvent = true;
-            if (time < 0)
+            if ((time + firstNoteStartTick) <= lastTickInSong)
             {
-                if (control_evt_id+1 < controllerAmount)
-                {
-                    doAddControlEvent = false;
-                    int checkEventID = control_evt_id+1;
-
-                    // check if there are other controller events of the same type before the area we play.
-                    while (true)
-                    {
-
-                        if ((m_control_events[checkEventID].getTick() - firstNoteStartTick)<1  and
-                            m_control_events[checkEventID].getController() == controllerID)
-                        {
-                            // the current event has no effect, there is another one later, disregard it.
-                            doAddControlEvent = false;
-                            break;
-                        }
-
-                        if ((m_control_events[checkEventID].getTick() - firstNoteStartTick)>0  and
-                           m_control_events[checkEventID].getController() == controllerID)
-                        {
-                            // there is another event, but it's later so current event is still relevant.
-                            doAddControlEvent = true;
-                            time = 0;
-                            break;
-                        }
-
-                        checkEventID++;
-                        if (not (checkEventID < controllerAmount ))
-                        {
-                            // we reaached the end, there are no other events of the same type
-                            // this one still affects playback of the area that we're playing.
-                            doAddControlEvent = true;
-                            time = 0;
-                            break;
-                        }
-                    }//wend
-                }
-                else
-                {
-                    // there are no other events in track. add it.
-                    doAddControlEvent = true;
-                    time = 0;
-                }
-            }
-            else
-            {
-                doAddControlEvent = true;
-            }
-            
-            // pitch bend
-            if (controllerID == PSEUDO_CONTROLLER_PITCH_BEND)
-            {
-                if (doAddControlEvent and (time + firstNoteStartTick) <= lastTickInSong)
-                {
-                    ASSERT_E(time, >=, debug_curr_time); debug_curr_time = time;
-                    m.SetTime( time );
- 
-                    if (DEBUG_NOTE_ORDER) printf("[DEBUG_NOTE_ORDER] %i (pitch bend)\n", time);
- 
-                    /** In range [-8192, 8191] */
-                    const int pitchBendVal = m_control_events[control_evt_id].getPitchBendValue();
-
-                    m.SetPitchBend(channel, pitchBendVal);
-
-                    if (not midiTrack->PutEvent(m)) { std::cout << "Error adding midi event!" << std::endl; }
-                }
-                control_evt_id++;
-            }
-            else if (controllerID == PSEUDO_CONTROLLER_INSTRUMENT_CHANGE)
-            {
-                if (doAddControlEvent and (time + firstNoteStartTick) <= lastTickInSong)
-                {
-                    ASSERT_E(time, >=, debug_curr_time); debug_curr_time = time;
-                    m.SetTime( time );
-                    m.SetProgramChange(channel, (int)round(m_control_events[control_evt_id].getValue()));
-
-                    if (DEBUG_NOTE_ORDER) printf("[DEBUG_NOTE_ORDER] %i (program change)\n", time);
+                ASSERT_E(time, >=, debug_curr_time); debug_curr_time = time;
+                if (DEBUG_NOTE_ORDER) printf("[DEBUG_NOTE_ORDER] %i (controller)\n", time);
 
-                    if (not midiTrack->PutEvent( m ))
-                    {
-                        std::cerr << "Error adding midi event!" << std::endl;
-                    }
-                }
-                
-                control_evt_id++;
+                addControlMidiEvent(midiTrack, channel, m_control_events[control_evt_id], time);
             }
-            else if (controllerID == 0 /* bank select */)
-            {
-                if (doAddControlEvent and (time + firstNoteStartTick) <= lastTickInSong)
-                {
-                    ASSERT_E(time, >=, debug_curr_time); debug_curr_time = time;
-                    m.SetTime( time );
- 
-                    if (DEBUG_NOTE_ORDER) printf("[DEBUG_NOTE_ORDER] %i (controller)\n", time);
-
-                    m.SetControlChange(channel,
-                                       0, // MSB
-                                       0);
+            control_evt_id++;
+        }// if (note/note off/control)
 
-                    if (not midiTrack->PutEvent( m ))
-                    {
-                        std::cerr << "Error adding midi event!" << std::endl;
-                    }
-                    
-                    m.SetTime( time );
-                    m.SetControlChange(channel,
-                                       32, // for bank select, force writing the LSB
-                                       127 - (int)round(m_control_events[control_evt_id].getValue()) );
+    }//wend
 
-                    if (not midiTrack->PutEvent( m ))
-                    {
-                        std::cerr << "Error adding midi event!" << std::endl;
-                    }
-                }
+    return last_event_tick;
+}
 
-                control_evt_id++;
+// ----------------------------------------------------------------------------------------------------------
 
-            }
-            // other controller
-            else if (controllerID < 128)
-            {
-                if (doAddControlEvent and (time + firstNoteStartTick) <= lastTickInSong)
-                {
-                    ASSERT_E(time, >=, debug_curr_time); debug_curr_time = time;
-                    m.SetTime( time );
- 
-                    if (DEBUG_NOTE_ORDER) printf("[DEBUG_NOTE_ORDER] %i (controller)\n", time);
+void Track::addControlMidiEvent(jdksmidi::MIDITrack* midiTrack, const int channel, const ControllerEvent& event,
+                               const int time)
+{
+    const int controllerID = event.getController();
 
-                    // FIXME: also write fine values
-                    m.SetControlChange(channel,
-                                       controllerID,
-                                       127 - (int)round(m_control_events[control_evt_id].getValue()) );
+    jdksmidi::MIDITimedBigMessage m;
+    m.SetTime( time );
 
-                    if (not midiTrack->PutEvent( m ))
-                    {
-                        std::cerr << "Error adding midi event!" << std::endl;
-                    }
-                }
+    // pitch bend
+    if (controllerID == PSEUDO_CONTROLLER_PITCH_BEND)
+    {
+        /** In range [-8192, 8191] */
+        m.SetPitchBend(channel, event.getPitchBendValue());
 
-                control_evt_id++;
+        if (not midiTrack->PutEvent(m)) { std::cout << "Error adding midi event!" << std::endl; }
+    }
+    else if (controllerID == PSEUDO_CONTROLLER_INSTRUMENT_CHANGE)
+    {
+        m.SetProgramChange(channel, (int)round(event.getValue()));
 
-            }//endif (control/pitch-bend)
-			else
-			{
-				// unexported event
-				control_evt_id++;
-			}
+        if (not midiTrack->PutEvent( m ))
+        {
+            std::cerr << "Error adding midi event!" << std::endl;
+        }
+    }
+    else if (controllerID == 0 /* bank select */)
+    {
+        m.SetControlChange(channel,
+                           0, // MSB
+                           0);
 
-        }// if (note/note off/control)
+        if (not midiTrack->PutEvent( m ))
+        {
+            std::cerr << "Error adding midi event!" << std::endl;
+        }
 
-    }//wend
+        m.SetTime( time );
+        m.SetControlChange(channel,
+                           32, // for bank select, force writing the LSB
+                           127 - (int)round(event.getValue()) );
 
-    if (selectionOnly) startTick = firstNoteStartTick;
+        if (not midiTrack->PutEvent( m ))
+        {
+            std::cerr << "Error adding midi event!" << std::endl;
+        }
+    }
+    // other controller
+    else if (controllerID < 128)
+    {
+        // FIXME: also write fine values
+        m.SetControlChange(channel,
+                           controllerID,
+                           127 - (int)round(event.getValue()) );
 
-    return last_event_tick - firstNoteStartTick;
+        if (not midiTrack->PutEvent( m ))
+        {
+            std::cerr << "Error adding midi event!" << std::endl;
+        }
+    }
+    // else : unexported event
 }
 
 // =======================================================================================================
@@ -1917,7 +1901,10 @@ void Track::saveToFile(wxFileOutputStream& fileout)
             break;
     }
 
-    getGraphics()->saveToFile(fileout);
+    // the GraphicalTrack registers itself as listener; tracks imported headless (e.g. by the batch
+    // converter) don't have one
+    if (m_listener == NULL) saveDefaultViewToFile(fileout);
+    else                    getGraphics()->saveToFile(fileout);
 
     // notes
     const int noteCount = m_notes.size();
@@ -1940,13 +1927,47 @@ void Track::saveToFile(wxFileOutputStream& fileout)
 
 // ----------------------------------------------------------------------------------------------------------
 
+void Track::saveDefaultViewToFile(wxFileOutputStream& fileout)
+{
+    // same layout as GraphicalTrack::saveToFile, with only what the model knows; the missing attributes
+    // get their default values when the file is loaded
+    const NotationType types[] = { SCORE, KEYBOARD, GUITAR, DRUM, CONTROLLER };
+    const wxString names[] = { wxT("score"), wxT("keyboard"), wxT("guitar"), wxT("drum"), wxT("controller") };
+
+    writeData(wxT("  <editors height=\"128\">\n"), fileout);
+    for (int n=0; n<5; n++)
+    {
+        writeData(wxT("    <") + names[n] + wxT(" enabled=\"") +
+                  (isNotationTypeEnabled(types[n]) ? wxT("true") : wxT("false")) + wxT("\"/>\n"), fileout);
+    }
+    writeData(wxT("  </editors>\n"), fileout);
+
+    m_magnetic_grid->saveToFile(fileout);
+
+    writeData( wxT("  <instrument id=\"") + to_wxString( getInstrument() ) + wxT("\"/>\n"), fileout);
+    writeData( wxT("  <drumkit id=\"") + to_wxString( getDrumKit() ) + wxT("\"/>\n"), fileout);
+
+    writeData( wxT("  <guitartuning "), fileout);
+    const int stringCount = m_tuning->tuning.size();
+    for (int n=0; n<stringCount; n++)
+    {
+        writeData(wxT(" string")+ to_wxString((int)n) + wxT("=\"") +
+                  to_wxString((int)m_tuning->tuning[n]) + wxT("\""), fileout );
+    }
+    writeData( wxT("/>\n\n"), fileout);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
 // FIXME(DESIGN): remove references to GraphicalSequence from model classes
 bool Track::readFromFile(irr::io::IrrXMLReader* xml, GraphicalSequence* gseq)
 {
 
     m_notes.clearAndDeleteAll();
     m_note_off.clearWithoutDeleting(); // have already been deleted by previous command
+    invalidateNoteIndex();
     m_control_events.clearAndDeleteAll();
+    invalidateControlEventIndex();
 
     // parse XML file
     do
@@ -2316,6 +2337,7 @@ bool Track::readFromFile(irr::io::IrrXMLReader* xml, GraphicalSequence* gseq)
                     {
                         // controller successfully loaded, add to controllers vector
                         m_control_events.push_back( temp );
+                        invalidateControlEventIndex();
                     }
                 }
 
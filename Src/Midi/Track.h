@@ -26,15 +26,21 @@ namespace irr { namespace io {
 
 namespace jdksmidi { class MIDITrack; }
 
+#include "Midi/ControlEventIndex.h"
 #include "Midi/ControllerEvent.h"
 #include "Midi/DrumChoice.h"
 #include "Midi/GuitarTuning.h"
 #include "Midi/InstrumentChoice.h"
 #include "Midi/MagneticGrid.h"
+#include "Midi/MidiStreamCache.h"
 #include "Midi/Note.h"
+#include "Midi/NoteColumns.h"
+#include "Midi/NoteRangeIndex.h"
 
 #include "ptr_vector.h"
 
+#include <vector>
+
 namespace AriaMaestosa
 {
     
@@ -110,9 +116,37 @@ namespace AriaMaestosa
         /** Same contents as 'm_notes', but sorted according to the end of the notes */
         ptr_vector<Note, REF> m_note_off;
         
+        /** Interval index over 'm_notes', rebuilt lazily after notes change (see 'invalidateNoteIndex') */
+        mutable NoteRangeIndex m_note_range_index;
+        
+        /** Contiguous copy of the hot fields of 'm_notes', rebuilt lazily (see 'getNoteColumns') */
+        mutable NoteColumns m_note_columns;
+        
         /** Holds all controller events from this track */
         ptr_vector<ControllerEvent> m_control_events;
         
+        /** Per-controller index over 'm_control_events', rebuilt lazily (see 'invalidateControlEventIndex') */
+        mutable ControlEventIndex m_control_event_index;
+        
+        void updateControlEventIndex() const
+        {
+            if (m_control_event_index.isDirty()) m_control_event_index.rebuild(m_control_events);
+        }
+        
+        /** MIDI events compiled from notes and controllers on last playback (see 'addMidiEvents') */
+        MidiStreamCache m_midi_stream_cache;
+        
+        /**
+          * @brief add the note and controller events of this track to 'midiTrack'
+          * @return tick of the last event added
+          */
+        int compileMidiEvents(jdksmidi::MIDITrack* midiTrack, const int channel, const int firstNoteStartTick,
+                              const int lastTickInSong, const bool selectionOnly);
+        
+        /** @brief add the MIDI event(s) matching a control event to 'midiTrack', at the given time */
+        void addControlMidiEvent(jdksmidi::MIDITrack* midiTrack, const int channel, const ControllerEvent& event,
+                                 const int time);
+        
         int m_track_id;
         
         /** Only used if in manual channel management mode */
@@ -164,6 +198,15 @@ namespace AriaMaestosa
     
         int computeNoteVolume(int noteId);
         
+        /** @return index of the first note in 'm_notes' that starts strictly after 'tick' (binary search) */
+        int findNoteStartUpperBound(const int tick) const;
+        
+        /** @return index of the first note in 'm_note_off' that ends strictly after 'endTick' (binary search) */
+        int findNoteEndUpperBound(const int endTick) const;
+        
+        /** @brief save the default editor settings, for tracks that were never given a GraphicalTrack */
+        void saveDefaultViewToFile(wxFileOutputStream& fileout);
+        
         
         /** The sequence this track is part of */
         Sequence* m_sequence;
@@ -211,10 +254,21 @@ namespace AriaMaestosa
                 ASSERT( MAGIC_NUMBER_OK() );
                 ASSERT( MAGIC_NUMBER_OK_FOR(*m_track) );
                 ASSERT( MAGIC_NUMBER_OK_FOR(m_track->m_notes) );
+                
+                // the caller may modify the notes, so the range index can no longer be trusted
+                m_track->invalidateNoteIndex();
                 return m_track->m_notes;
             }
-            ptr_vector<Note, REF>&       getNoteOffVector()      { return m_track->m_note_off;       }
-            ptr_vector<ControllerEvent>& getControlEventVector() { return m_track->m_control_events; }
+            ptr_vector<Note, REF>&       getNoteOffVector()
+            {
+                m_track->invalidateNoteIndex();
+                return m_track->m_note_off;
+            }
+            ptr_vector<ControllerEvent>& getControlEventVector()
+            {
+                m_track->invalidateControlEventIndex();
+                return m_track->m_control_events;
+            }
             
             LEAK_CHECK();
         };
@@ -352,6 +406,45 @@ namespace AriaMaestosa
          */
         int findLastNoteInRange(const int fromTick, const int toTick) const;
         
+        /**
+         * @brief Find all notes that overlap the tick range [fromTick, toTick)
+         *
+         * Unlike 'findFirstNoteInRange'/'findLastNoteInRange', which only consider note starts, this
+         * also reports notes that start before 'fromTick' and are still held. Runs in O(log n + k).
+         *
+         * @param[out] out receives the IDs of the matching notes, in time order
+         */
+        void findNotesInRange(const int fromTick, const int toTick, std::vector<int>& out) const;
+        
+        /**
+         * @brief Notify this track that its notes were modified outside of its own methods,
+         *        so that cached note lookups get rebuilt
+         */
+        void invalidateNoteIndex()
+        {
+            m_note_range_index.invalidate();
+            m_note_columns.invalidate();
+            m_midi_stream_cache.invalidate();
+        }
+        
+        /**
+         * @brief Tick, end tick, pitch, volume and selection of all notes, in contiguous arrays
+         *
+         * Faster than going through each note when scanning a whole track. Entry 'n' matches note 'n'.
+         * Not to be used from within an action, since notes may change there without notice.
+         */
+        const NoteColumns& getNoteColumns() const;
+        
+        /**
+         * @brief Notify this track that its control events were modified outside of its own methods,
+         *        so that per-controller lookups get rebuilt
+         */
+        void invalidateControlEventIndex()
+        {
+            m_control_event_index.invalidate();
+            m_midi_stream_cache.invalidate();
+        }
+        
         void playNote(const int id, const bool noteChange=false);
         
         void markNoteToBeRemoved(const int id);
@@ -430,6 +523,19 @@ namespace AriaMaestosa
         
         ControllerEvent* getControllerEventAt(int tick, int idController);
         
+        /**
+          * @return IDs (as accepted by 'getControllerEvent') of all events of the given controller,
+          *         in time order
+          * @pre    'controller' is a controller stored in this track (not tempo nor lyrics)
+          */
+        const std::vector<int>& getControllerEventIDs(const int controller) const;
+        
+        /**
+          * @return position, within 'getControllerEventIDs(controller)', of the first event of
+          *         this controller located at or after 'tick'
+          */
+        int findFirstControllerEventFrom(const int controller, const int tick) const;
+        
         /**
           * @brief get a controller event object
           * @param id of the control event to retrieve (from 0 to count-1)
@@ -511,6 +617,9 @@ namespace AriaMaestosa
         /**
          * @brief Add Midi Events to JDKMidi track object
          * @param channel in manual channel mode, this argument is NOT considered
+         *
+         * Note and controller events are only compiled again if they changed since the last call,
+         * otherwise they are copied from those compiled then.
          */
         int addMidiEvents(jdksmidi::MIDITrack* track, int channel, int firstMeasure,
                           bool selectionOnly, int& startTick); // returns length
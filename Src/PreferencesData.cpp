@@ -284,6 +284,18 @@ void PreferencesData::fillSettingsVector()
                                      _("Automatically launch FluidSynth if needed"),
                                      SETTING_BOOL, SETTING_CATEGORY_AUDIO, wxT("1") );
     m_settings.push_back(launchFluidSynth);
+    
+    Setting* queuedPlayback = new Setting(fromCString(SETTING_ID_ALSA_QUEUED_PLAYBACK),
+                                     _("Schedule playback events on the ALSA sequencer queue"),
+                                     SETTING_BOOL, SETTING_CATEGORY_AUDIO, wxT("1") );
+    m_settings.push_back(queuedPlayback);
+#endif
+
+#ifdef USE_JACK
+    Setting* jackPorts = new Setting(fromCString(SETTING_ID_JACK_OUTPUT_PORTS),
+                                     _("JACK MIDI output ports (songs with more than 15 instruments use the next ones)"),
+                                     SETTING_INT, SETTING_CATEGORY_AUDIO, wxT("1") );
+    m_settings.push_back(jackPorts);
 #endif
 
 #ifndef __WXMAC__
@@ -358,10 +370,10 @@ void PreferencesData::fillSettingsVector()
     
     
 #ifdef __WXGTK__
-    // Default=0 => FLUIDSYNTH
+    // Default=2 => built-in synthesizer (0 is FluidSynth, 1 is TiMidity)
     Setting* audioExportEngine = new Setting(fromCString(SETTING_ID_AUDIO_EXPORT_ENGINE),
                                      wxT("Audio Export Engine"),
-                                     SETTING_INT, SETTING_CATEGORY_HIDDEN, wxT("0"));
+                                     SETTING_INT, SETTING_CATEGORY_HIDDEN, wxT("2"));
     m_settings.push_back( audioExportEngine );
                          
     Setting* fluidsynthSoundfontPath = new Setting(fromCString(SETTING_ID_FLUIDSYNTH_SOUNDFONT_PATH),
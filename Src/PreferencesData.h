@@ -74,6 +74,8 @@ static const wxString SYSTEM_BANK = _("System soundbank");
     EXTERN const char* SETTING_ID_PLAY_DURING_EDIT DEFAULT("playDuringEdit");
     EXTERN const char* SETTING_ID_LANGUAGE         DEFAULT("lang");
     EXTERN const char* SETTING_ID_LAUNCH_FLUIDSYNTH  DEFAULT("launchFluidSynth");
+    EXTERN const char* SETTING_ID_ALSA_QUEUED_PLAYBACK  DEFAULT("alsaQueuedPlayback");
+    EXTERN const char* SETTING_ID_JACK_OUTPUT_PORTS  DEFAULT("jackOutputPorts");
     
 #ifndef __WXMAC__
     EXTERN const char* SETTING_ID_SINGLE_INSTANCE_APPLICATION  DEFAULT("singleInstanceApplication");
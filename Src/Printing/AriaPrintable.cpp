@@ -29,6 +29,11 @@
 #include <wx/printdlg.h>
 #include <wx/graphics.h>
 #include <wx/dcprint.h>
+#include <wx/filename.h>
+
+#if wxCHECK_VERSION(2,9,1) && wxUSE_GRAPHICS_CONTEXT
+#include <wx/dcgraph.h>
+#endif
 
 using namespace AriaMaestosa;
 
@@ -332,10 +337,55 @@ void AriaPrintable::printPage(const int pageNum, wxDC& dc, wxGraphicsContext* gc
 
     dc.SetFont( m_normal_font );
     m_seq->printLinesInArea(dc, gc, pageNum-1, notation_area_y0, notation_area_h, h, x0, x1);
+}
+
+// -------------------------------------------------------------------------------------------------------------
+
+bool AriaPrintable::printToImages(const wxString& directory, const int pageWidth)
+{
+    ASSERT( MAGIC_NUMBER_OK() );
+    ASSERT( m_seq != NULL );
+    ASSERT( m_seq->isLayoutCalculated() );
+    ASSERT( pageWidth > 0 );
+    
+    const int unitWidth  = getUnitWidth();
+    const int unitHeight = getUnitHeight();
+    ASSERT( unitWidth > 0 and unitHeight > 0 );
     
+    // pages are drawn in print units, scaled down to the requested image size
+    const double scale = (double)pageWidth / (double)unitWidth;
+    
+    const int pageAmount = m_seq->getPageAmount();
+    for (int page=1; page<=pageAmount; page++)
+    {
+        wxBitmap bitmap(pageWidth, (int)(unitHeight*scale));
+        if (not bitmap.IsOk()) return false;
+        
+        {
+            // the DCs must be gone before the bitmap is saved, so that everything was drawn into it
+            wxMemoryDC memDC(bitmap);
+            
 #if wxCHECK_VERSION(2,9,1) && wxUSE_GRAPHICS_CONTEXT
-    delete gc;
+            // the wxGCDC owns 'gc' and deletes it along with itself
+            wxGraphicsContext* gc = wxGraphicsContext::Create(memDC);
+            wxGCDC dc(gc);
+            dc.SetUserScale(scale, scale);
+            printPage(page, dc, gc, 0, 0, unitWidth, unitHeight);
+#else
+            memDC.SetUserScale(scale, scale);
+            printPage(page, memDC, NULL, 0, 0, unitWidth, unitHeight);
 #endif
+        }
+        
+        wxFileName file(directory, wxString::Format(wxT("page-%03i.png"), page));
+        if (not bitmap.SaveFile(file.GetFullPath(), wxBITMAP_TYPE_PNG))
+        {
+            std::cerr << "[AriaPrintable] ERROR: could not save " << file.GetFullPath().mb_str() << "\n";
+            return false;
+        }
+    }
+    
+    return true;
 }
     
 // -------------------------------------------------------------------------------------------------------------
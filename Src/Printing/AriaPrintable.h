@@ -129,6 +129,17 @@ namespace AriaMaestosa
           */ 
         wxPrinterError print();
         
+        /**
+          * @brief Render every page offscreen and save them as PNG images, without any print dialog
+          *
+          * Pages are saved as 'page-001.png', 'page-002.png', etc. in the given directory.
+          * @pre  the 'calculateLayout' method of the printable sequence has been called
+          * @param directory  an existing directory where to save the images
+          * @param pageWidth  width of the images, in pixels (their height follows the paper format)
+          * @return whether all pages could be saved
+          */
+        bool printToImages(const wxString& directory, const int pageWidth);
+        
         /** 
           * @return the number of units used horizontally in the coordinate system set-up for
           * the kind of paper that is selected.
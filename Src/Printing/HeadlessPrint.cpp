@@ -0,0 +1,77 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Printing/HeadlessPrint.h"
+
+#include "GUI/GraphicalTrack.h"
+#include "Midi/Sequence.h"
+#include "Midi/Track.h"
+#include "Printing/AriaPrintable.h"
+#include "Printing/SymbolPrinter/SymbolPrintableSequence.h"
+
+#include <iostream>
+#include <wx/filename.h>
+#include <wx/stopwatch.h>
+
+using namespace AriaMaestosa;
+
+// -------------------------------------------------------------------------------------------------------------
+
+bool AriaMaestosa::printToImages(Sequence* seq, const wxString& directory, const int pageWidth)
+{
+    ASSERT(seq != NULL);
+    
+    if (not wxDirExists(directory) and not wxFileName::Mkdir(directory, 0777, wxPATH_MKDIR_FULL))
+    {
+        std::cerr << "Cannot create output directory " << directory.mb_str() << std::endl;
+        return false;
+    }
+    
+    bool success = false;
+    AriaPrintable printable(AbstractPrintableSequence::getTitle(seq), &success);
+    if (not success) return false;
+    
+    SymbolPrintableSequence printableSeq(seq);
+    printable.setSequence(&printableSeq);
+    
+    const int trackAmount = seq->getTrackAmount();
+    for (int n=0; n<trackAmount; n++)
+    {
+        Track* track = seq->getTrack(n);
+        if (track->isNotationTypeEnabled(SCORE))  printableSeq.addTrack(track->getGraphics(), SCORE);
+        if (track->isNotationTypeEnabled(GUITAR)) printableSeq.addTrack(track->getGraphics(), GUITAR);
+    }
+    
+    if (printableSeq.getTrackAmount() == 0)
+    {
+        std::cerr << "No track uses score or tablature view, nothing to print" << std::endl;
+        return false;
+    }
+    
+    wxStopWatch watch;
+    printableSeq.calculateLayout();
+    const long layoutTime = watch.Time();
+    
+    watch.Start();
+    success = printable.printToImages(directory, pageWidth);
+    const long renderTime = watch.Time();
+    
+    std::cout << "Printed " << printableSeq.getPageAmount() << " pages (" << printableSeq.getTrackAmount()
+              << " tracks) : layout in " << layoutTime << " ms, rendering in " << renderTime << " ms"
+              << std::endl;
+    
+    return success;
+}
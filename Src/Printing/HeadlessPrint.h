@@ -0,0 +1,41 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __HEADLESS_PRINT_H__
+#define __HEADLESS_PRINT_H__
+
+#include <wx/string.h>
+
+namespace AriaMaestosa
+{
+    class Sequence;
+    
+    /**
+      * @brief Lays out the score/tablature of a sequence and saves its pages as PNG images, without
+      *        showing any print dialog. Meant for timing and testing the printing module.
+      *
+      * Tracks are printed with the notations (score and/or tablature) enabled in their editor; tracks
+      * using neither are skipped. Timing of the layout and of the rendering is written to stdout.
+      *
+      * @param directory  where to save the pages, as 'page-001.png', etc. (created if needed)
+      * @param pageWidth  width of the images, in pixels
+      * @return whether all pages could be saved
+      * @ingroup printing
+      */
+    bool printToImages(Sequence* seq, const wxString& directory, const int pageWidth = 1240);
+}
+
+#endif
@@ -30,6 +30,7 @@ namespace AriaMaestosa
     class GraphicalTrack;
     class LayoutLine;
     class LayoutElement;
+    class LineAnalysisJob;
     class LineTrackRef;
     class PrintLayoutMeasure;
     class MeasureTrackReference;
@@ -137,6 +138,22 @@ namespace AriaMaestosa
           */
         virtual void earlySetup(const int trackID, GraphicalTrack* track) {}
         
+        /**
+          * @brief Called by the layout code for each track of each line, once the contents of all lines
+          *        are known and before 'calculateHeight' is called for them.
+          *
+          * If this editor needs to analyse the contents of each line, it can prepare this analysis here
+          * (storing what it needs in the 'editor_data' of the LineTrackRef) and return a job that performs
+          * it. Jobs of all lines and tracks are then run in parallel, in worker threads.
+          *
+          * @return a job that only touches data of this line and track (the caller takes ownership of it),
+          *         or NULL if there is nothing to analyse ahead of time
+          */
+        virtual LineAnalysisJob* prepareLine(const int trackID, LineTrackRef& track, LayoutLine& line)
+        {
+            return NULL;
+        }
+        
         /**
           * Classes deriving from EditorPrintable must implemented this method. It will be
           * called by the layout routines for each routine and each track handled by this editor.
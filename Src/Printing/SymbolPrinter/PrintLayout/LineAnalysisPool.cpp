@@ -0,0 +1,178 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Printing/SymbolPrinter/PrintLayout/LineAnalysisPool.h"
+#include "UnitTest.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace AriaMaestosa;
+
+class LineAnalysisPool::Worker : public wxThread
+{
+    LineAnalysisPool* m_parent;
+public:
+    Worker(LineAnalysisPool* parent) : wxThread(wxTHREAD_JOINABLE), m_parent(parent) {}
+    virtual ExitCode Entry()
+    {
+        m_parent->workerLoop();
+        return 0;
+    }
+};
+
+// ----------------------------------------------------------------------------------------------------------
+
+LineAnalysisPool::LineAnalysisPool(const int threadCount)
+{
+    m_thread_count = (threadCount > 0 ? threadCount : std::max(1, wxThread::GetCPUCount()));
+    m_next_job     = 0;
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void LineAnalysisPool::add(LineAnalysisJob* job)
+{
+    m_jobs.push_back(job);
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void LineAnalysisPool::workerLoop()
+{
+    while (true)
+    {
+        int jobID;
+        {
+            wxMutexLocker lock(m_lock);
+            jobID = m_next_job++;
+        }
+        if (jobID >= m_jobs.size()) return;
+
+        m_jobs[jobID].run();
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------
+
+void LineAnalysisPool::run()
+{
+    m_next_job = 0;
+
+    std::vector<Worker*> workers;
+    const int workerAmount = std::min(m_thread_count, m_jobs.size());
+
+    // with a single worker, spare starting a thread
+    if (workerAmount > 1)
+    {
+        for (int n=0; n<workerAmount; n++)
+        {
+            Worker* worker = new Worker(this);
+            if (worker->Create() != wxTHREAD_NO_ERROR or worker->Run() != wxTHREAD_NO_ERROR)
+            {
+                delete worker;
+                break;
+            }
+            workers.push_back(worker);
+        }
+    }
+
+    // if no thread was started, do the work here; otherwise this thread waits for the workers
+    if (workers.empty()) workerLoop();
+
+    for (unsigned int n=0; n<workers.size(); n++)
+    {
+        workers[n]->Wait();
+        delete workers[n];
+    }
+
+    m_jobs.clearAndDeleteAll();
+}
+
+// ----------------------------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------------------------
+
+namespace TestLineAnalysisPool
+{
+
+    class CountingJob : public LineAnalysisJob
+    {
+        int* m_runs;
+        int* m_result;
+        int  m_input;
+    public:
+        CountingJob(int* runs, int* result, const int input) : m_runs(runs), m_result(result), m_input(input) {}
+
+        virtual void run()
+        {
+            (*m_runs)++;
+
+            // some busy work, so workers really run at the same time
+            int sum = 0;
+            for (int n=0; n<=m_input*100; n++) sum = (sum + n*n) % 10007;
+            *m_result = sum;
+        }
+    };
+
+    UNIT_TEST( TestEachJobRunsOnce )
+    {
+        const int JOBS = 500;
+
+        std::vector<int> expected(JOBS, 0);
+        std::vector<int> runs(JOBS, 0);
+        std::vector<int> results(JOBS, -1);
+
+        for (int n=0; n<JOBS; n++)
+        {
+            int unused = 0;
+            CountingJob job(&unused, &expected[n], n);
+            job.run();
+        }
+
+        LineAnalysisPool pool(4);
+        for (int n=0; n<JOBS; n++) pool.add(new CountingJob(&runs[n], &results[n], n));
+        require_e(pool.getJobAmount(), ==, JOBS, "jobs are queued until 'run'");
+
+        pool.run();
+        require_e(pool.getJobAmount(), ==, 0, "jobs are forgotten once done");
+
+        for (int n=0; n<JOBS; n++)
+        {
+            require_e(runs[n], ==, 1, "each job runs exactly once");
+            require_e(results[n], ==, expected[n], "jobs give the same results as when run alone");
+        }
+
+        // the pool can be used again
+        pool.add(new CountingJob(&runs[0], &results[0], 0));
+        pool.run();
+        require_e(runs[0], ==, 2, "a pool can run jobs more than once");
+    }
+
+    UNIT_TEST( TestSingleThread )
+    {
+        int runs = 0;
+        int result = -1;
+
+        LineAnalysisPool pool(1);
+        pool.run();
+        require_e(pool.getJobAmount(), ==, 0, "an empty pool can be run");
+
+        pool.add(new CountingJob(&runs, &result, 3));
+        pool.run();
+        require_e(runs, ==, 1, "jobs run without worker threads");
+    }
+
+}
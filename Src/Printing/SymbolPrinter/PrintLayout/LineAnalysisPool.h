@@ -0,0 +1,76 @@
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along
+ with this program; if not, write to the Free Software Foundation, Inc.,
+ 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __LINE_ANALYSIS_POOL_H__
+#define __LINE_ANALYSIS_POOL_H__
+
+#include "ptr_vector.h"
+#include <wx/thread.h>
+
+namespace AriaMaestosa
+{
+
+    /**
+      * @brief Analysis of one track on one line of a printout, prepared by an EditorPrintable
+      *
+      * Jobs are created on the main thread, then run on any thread, in parallel with the jobs of other
+      * lines and tracks. Thus 'run' may only touch data that belongs to this job alone.
+      * @ingroup printing
+      */
+    class LineAnalysisJob
+    {
+    public:
+        virtual ~LineAnalysisJob() {}
+
+        virtual void run() = 0;
+    };
+
+    /**
+      * @brief Runs the LineAnalysisJob objects of a printout in worker threads
+      *
+      * Jobs are handed out to the workers one at a time, so lines with many notes do not hold back the
+      * others.
+      * @ingroup printing
+      */
+    class LineAnalysisPool
+    {
+        class Worker;
+
+        ptr_vector<LineAnalysisJob> m_jobs;
+        int m_thread_count;
+
+        wxMutex m_lock;
+        int     m_next_job;
+
+        void workerLoop();
+
+    public:
+
+        /** @param threadCount amount of worker threads, or -1 for one per CPU */
+        LineAnalysisPool(const int threadCount = -1);
+
+        /** @brief add a job to run; the pool takes ownership of it */
+        void add(LineAnalysisJob* job);
+
+        int getJobAmount() const { return m_jobs.size(); }
+
+        /** @brief run all jobs added so far and wait until they are all done, then delete them */
+        void run();
+    };
+
+}
+
+#endif
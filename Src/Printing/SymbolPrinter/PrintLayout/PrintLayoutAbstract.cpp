@@ -25,6 +25,7 @@
 #include "Printing/AriaPrintable.h"
 #include "Printing/SymbolPrinter/ScorePrint.h"
 #include "Printing/SymbolPrinter/TabPrint.h"
+#include "Printing/SymbolPrinter/PrintLayout/LineAnalysisPool.h"
 #include "Printing/SymbolPrinter/PrintLayout/PrintLayoutMeasure.h"
 #include "Printing/SymbolPrinter/PrintLayout/PrintLayoutLine.h"
 #include "Printing/SymbolPrinter/SymbolPrintableSequence.h"
@@ -34,6 +35,7 @@
 #include <iostream>
 #include <cmath>
 #include <map>
+#include <wx/stopwatch.h>
 
 #define BE_VERBOSE 0
 
@@ -411,6 +413,40 @@ void PrintLayoutAbstract::terminateLine(LayoutLine* currentLine, ptr_vector<Layo
 
 // -----------------------------------------------------------------------------------------------------
 
+void PrintLayoutAbstract::analyseLines(std::vector<LayoutLine*>& lines)
+{
+    // jobs are prepared here, on the main thread, then run by the pool's workers
+    LineAnalysisPool pool;
+    
+    const int lineAmount = lines.size();
+    for (int l=0; l<lineAmount; l++)
+    {
+        LayoutLine* line = lines[l];
+        
+        const int trackAmount = line->getTrackAmount();
+        for (int n=0; n<trackAmount; n++)
+        {
+            EditorPrintable* editorPrintable = m_sequence->getEditorPrintable(n);
+            LineAnalysisJob* job = editorPrintable->prepareLine(n, line->getLineTrackRef(n), *line);
+            if (job != NULL) pool.add(job);
+        }
+    }
+    
+#if BE_VERBOSE
+    wxStopWatch watch;
+    const int jobAmount = pool.getJobAmount();
+#endif
+    
+    pool.run();
+    
+#if BE_VERBOSE
+    std::cout << "[PrintLayoutAbstract] analysed " << jobAmount << " track lines in "
+              << watch.Time() << " ms" << std::endl;
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------
+
 LayoutElement PrintLayoutAbstract::generateLineHeaderElement() const
 {
     LayoutElement el(LINE_HEADER, -1);
@@ -455,18 +491,16 @@ void PrintLayoutAbstract::layInLinesAndPages(std::vector<LayoutElement>& layoutE
     const int layoutElementsAmount = layoutElements.size();
 
     int current_width = 0;
-    int current_height = 0;
 
     ptr_vector<PrintLayoutMeasure, REF> measures_ref = m_measures.getWeakView();
 
-    // create a first page
-    int current_page = 0;
-    layoutPages.push_back( new LayoutPage() );
+    // ---- Split elements among lines. This only depends on widths, so all lines can be analysed
+    //      before heights (and thus page breaks) are calculated
+    std::vector<LayoutLine*> lines;
     
     // create a first line
     LayoutLine* currentLine = new LayoutLine(m_sequence, measures_ref);
-    layoutPages[current_page].addLine( currentLine );
-    currentLine->setLevelFrom(current_height);
+    lines.push_back( currentLine );
 
     // add line header
     {
@@ -475,15 +509,13 @@ void PrintLayoutAbstract::layInLinesAndPages(std::vector<LayoutElement>& layoutE
     currentLine->addLayoutElement( el );
     }
     
-    bool first_line = true;
-    
     // add layout elements one by one, switching to the next line when there's too many
     // elements on the current one
     for (int n=0; n<layoutElementsAmount; n++)
     {
         if ((n & 3) == 0) // only update progress one element out of 4
         {
-            WaitWindow::setProgress( 60 + n*40/layoutElementsAmount );
+            WaitWindow::setProgress( 60 + n*10/layoutElementsAmount );
         }
 
         int nextWidth = current_width + layoutElements[n].width_in_print_units +
@@ -508,19 +540,9 @@ void PrintLayoutAbstract::layInLinesAndPages(std::vector<LayoutElement>& layoutE
         {
             current_width = 0;
             
-            // terminate current line
-            const int maxLevelHeight = (current_page == 1 ? maxLevelsOnPage1 : maxLevelsOnOtherPages);
-            terminateLine( currentLine, layoutPages, maxLevelHeight,
-                           AriaPrintable::getCurrentPrintable()->hideEmptyTracks() and not first_line,
-                           current_height, current_page );
-            first_line = false;
-            
-            ASSERT(current_height <= (current_page == 1 ? maxLevelsOnPage1 : maxLevelsOnOtherPages));
-            
             // begin new line
             currentLine = new LayoutLine(m_sequence, measures_ref);
-            layoutPages[current_page].addLine( currentLine );
-            currentLine->setLevelFrom(current_height);
+            lines.push_back( currentLine );
 
             if (HEADER_ON_EVERY_LINE)
             {
@@ -537,13 +559,37 @@ void PrintLayoutAbstract::layInLinesAndPages(std::vector<LayoutElement>& layoutE
         current_width += layoutElements[n].width_in_print_units + MARGIN_AT_MEASURE_BEGINNING;
     }
     
-    // ---- for last line processed
-    const int maxLevelHeight = (current_page == 1 ? maxLevelsOnPage1 : maxLevelsOnOtherPages);
-    terminateLine( currentLine, layoutPages, maxLevelHeight,
-                   AriaPrintable::getCurrentPrintable()->hideEmptyTracks() and not first_line,
-                   current_height, current_page );
+    // ---- Analyse the contents of all lines, in parallel
+    WaitWindow::setProgress( 70 );
+    analyseLines(lines);
     
-    ASSERT(current_height <= (current_page == 1 ? maxLevelsOnPage1 : maxLevelsOnOtherPages));
+    // ---- Place lines in pages, switching to the next page when a line doesn't fit
+    int current_height = 0;
+    int current_page = 0;
+    
+    // create a first page
+    layoutPages.push_back( new LayoutPage() );
+    
+    const int lineAmount = lines.size();
+    for (int l=0; l<lineAmount; l++)
+    {
+        if ((l & 3) == 0) // only update progress one line out of 4
+        {
+            WaitWindow::setProgress( 90 + l*10/lineAmount );
+        }
+        
+        currentLine = lines[l];
+        layoutPages[current_page].addLine( currentLine );
+        currentLine->setLevelFrom(current_height);
+        
+        // terminate current line
+        const int maxLevelHeight = (current_page == 1 ? maxLevelsOnPage1 : maxLevelsOnOtherPages);
+        terminateLine( currentLine, layoutPages, maxLevelHeight,
+                       AriaPrintable::getCurrentPrintable()->hideEmptyTracks() and l > 0 /* not first line */,
+                       current_height, current_page );
+        
+        ASSERT(current_height <= (current_page == 1 ? maxLevelsOnPage1 : maxLevelsOnOtherPages));
+    }
     
     
 #ifdef _MORE_DEBUG_CHECKS
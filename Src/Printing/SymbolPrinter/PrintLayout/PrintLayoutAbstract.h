@@ -76,6 +76,14 @@ namespace AriaMaestosa
         /** fills fields containing info about similar measures withing the PrintLayoutMeasure objects */
         //void findSimilarMeasures();
         
+        /**
+          * @brief utility method invoked by 'layInLinesAndPages' once elements were split among lines
+          *
+          * Gives each editor printable the opportunity to analyse each line ahead of time (see
+          * EditorPrintable::prepareLine); this analysis is done in parallel, with one worker per CPU.
+          */
+        void analyseLines(std::vector<LayoutLine*>& lines);
+        
         /** utility method invoked by 'layInLinesAndPages' when a line is complete */
         void terminateLine(LayoutLine* line, ptr_vector<LayoutPage>& layoutPages, const int maxLevelHeight,
                            bool hideEmptyTracks, int& current_height, int& current_page);
@@ -180,6 +180,13 @@ namespace AriaMaestosa
             return m_tracks[trackID];
         }
         
+        LineTrackRef& getLineTrackRef(const int trackID)
+        {
+            ASSERT_E(trackID,>=,0);
+            ASSERT_E(trackID,<,(int)m_tracks.size());
+            return m_tracks[trackID];
+        }
+        
         int getLayoutElementCount() const             { return m_layout_elements.size(); }
         LayoutElement& getLayoutElement(const int id) { return m_layout_elements[id];    }
         
@@ -29,6 +29,7 @@
 #include "Midi/MeasureData.h"
 #include "Midi/Sequence.h"
 #include "Printing/AriaPrintable.h"
+#include "Printing/SymbolPrinter/PrintLayout/LineAnalysisPool.h"
 #include "Printing/SymbolPrinter/PrintLayout/PrintLayoutAbstract.h"
 #include "Printing/SymbolPrinter/PrintLayout/PrintLayoutMeasure.h"
 #include "Printing/SymbolPrinter/PrintLayout/PrintLayoutLine.h"
@@ -115,6 +116,36 @@ namespace AriaMaestosa
         int extra_lines_under_f_score;
         float first_clef_proportion ;
         float second_clef_proportion;
+        
+        /** notes of this line, for each clef (NULL if the clef is not shown), as found in the analyser
+          * of the whole track (used to find silences) */
+        OwnerPtr<ScoreAnalyser> g_clef_notes;
+        OwnerPtr<ScoreAnalyser> f_clef_notes;
+        
+        /** notes of this line, for each clef, once analysed (chords, triplets, beams). This analysis is
+          * done once, during layout, and used both to size the line and to render it. */
+        OwnerPtr<ScoreAnalyser> g_clef_analysis;
+        OwnerPtr<ScoreAnalyser> f_clef_analysis;
+    };
+    
+    /**
+      * @brief Analyses the notes of one line of a score (see ScorePrintable::prepareLine)
+      * @ingroup printing
+      */
+    class ScoreLineAnalysis : public LineAnalysisJob
+    {
+        ScoreData* m_score_data;
+        
+    public:
+        
+        ScoreLineAnalysis(ScoreData* scoreData) : m_score_data(scoreData) {}
+        
+        virtual void run()
+        {
+            // only touches the analysers of this line, which were copied on the main thread
+            if (m_score_data->g_clef_analysis.raw_ptr != NULL) m_score_data->g_clef_analysis->analyseNoteInfo();
+            if (m_score_data->f_clef_analysis.raw_ptr != NULL) m_score_data->f_clef_analysis->analyseNoteInfo();
+        }
     };
     
     // FIXME : find cleaner way to keep info per-track
@@ -747,7 +778,8 @@ namespace AriaMaestosa
                                               currentTrack.getTrack(),
                                               abs(scoreData->extra_lines_above_g_score));
             
-            analyseAndDrawScore(clef, *g_clef_analyser, currentLine, currentTrack.getTrack(),
+            analyseAndDrawScore(clef, *g_clef_analyser, *scoreData->g_clef_notes, *scoreData->g_clef_analysis,
+                                currentLine, currentTrack.getTrack(),
                                 dc, grctx, abs(scoreData->extra_lines_above_g_score),
                                 abs(scoreData->extra_lines_under_g_score),
                                 trackCoords->x0, m_g_clef_y_from, trackCoords->x1, m_g_clef_y_to,
@@ -762,7 +794,8 @@ namespace AriaMaestosa
                                               currentTrack.getTrack(),
                                               abs(scoreData->extra_lines_above_f_score));
             
-            analyseAndDrawScore(clef, *f_clef_analyser, currentLine, currentTrack.getTrack(),
+            analyseAndDrawScore(clef, *f_clef_analyser, *scoreData->f_clef_notes, *scoreData->f_clef_analysis,
+                                currentLine, currentTrack.getTrack(),
                                 dc, grctx, abs(scoreData->extra_lines_above_f_score),
                                 abs(scoreData->extra_lines_under_f_score),
                                 trackCoords->x0, m_f_clef_y_from, trackCoords->x1, m_f_clef_y_to,
@@ -786,11 +819,47 @@ namespace AriaMaestosa
 
     // -------------------------------------------------------------------------------------------
 
-    void ScorePrintable::gatherVerticalSizingInfo(const int trackID, LineTrackRef& lineTrack, LayoutLine& line)
+    LineAnalysisJob* ScorePrintable::prepareLine(const int trackID, LineTrackRef& lineTrack, LayoutLine& line)
     {
         ScoreData* scoreData = new ScoreData();
         lineTrack.editor_data = scoreData;
         
+        const GraphicalTrack* gtrack = lineTrack.getTrack();
+        ASSERT(gtrack->getTrack() == m_track);
+        
+        const MeasureData* md = gtrack->getSequence()->getModel()->getMeasureData();
+        const int fromTick = md->firstTickInMeasure( line.getFirstMeasure() );
+        const int toTick   = md->lastTickInMeasure ( line.getLastMeasure() );
+        
+        // analysers are created here, on the main thread; the job only analyses them
+        if (m_g_clef)
+        {
+            scoreData->g_clef_notes    = g_clef_analyser->getSubset(fromTick, toTick);
+            scoreData->g_clef_analysis = g_clef_analyser->getSubset(fromTick, toTick);
+        }
+        if (m_f_clef)
+        {
+            scoreData->f_clef_notes    = f_clef_analyser->getSubset(fromTick, toTick);
+            scoreData->f_clef_analysis = f_clef_analyser->getSubset(fromTick, toTick);
+        }
+        
+        return new ScoreLineAnalysis(scoreData);
+    }
+    
+    // -------------------------------------------------------------------------------------------
+
+    void ScorePrintable::gatherVerticalSizingInfo(const int trackID, LineTrackRef& lineTrack, LayoutLine& line)
+    {
+        ScoreData* scoreData = dynamic_cast<ScoreData*>(lineTrack.editor_data.raw_ptr);
+        if (scoreData == NULL)
+        {
+            // line was not analysed ahead of time by the layout code, do it now
+            OwnerPtr<LineAnalysisJob> job(prepareLine(trackID, lineTrack, line));
+            job->run();
+            scoreData = dynamic_cast<ScoreData*>(lineTrack.editor_data.raw_ptr);
+        }
+        ASSERT(scoreData != NULL);
+        
         const GraphicalTrack* gtrack = lineTrack.getTrack();
         const ScoreEditor* scoreEditor = gtrack->getScoreEditor();
         const ScoreMidiConverter* converter = scoreEditor->getScoreMidiConverter();
@@ -829,30 +898,22 @@ namespace AriaMaestosa
         m_g_clef = scoreEditor->isGClefEnabled();
         m_f_clef = scoreEditor->isFClefEnabled();
         
-        const Sequence* seq = gtrack->getSequence()->getModel();
-        const MeasureData* md = seq->getMeasureData();
-        
-        const int fromTick = md->firstTickInMeasure( line.getFirstMeasure() );
-        const int toTick   = md->lastTickInMeasure ( line.getLastMeasure() );
-
         // ---- check if some signs (stems, triplet signs, etc.) go out of bounds
         for (int n=0; n<2; n++) // 0 is G clef, 1 is F clef
         {
             if (n == 0 and not m_g_clef) continue;
             if (n == 1 and not m_f_clef) continue;
             
-            // analyse notes. this analysis will be used to determine is some things go out of the track
-            // verticall, and will be thrown away after [FIXME] (it will be analysed again when it's time to render)
+            // use the analysis of this line to determine is some things go out of the track
+            // vertically (the same analysis is kept for when it's time to render)
             ScoreAnalyser* analyser = NULL;
-            if      (n == 0) analyser = g_clef_analyser;
-            else if (n == 1) analyser = f_clef_analyser;
+            ScoreAnalyser* lineAnalyser = NULL;
+            if      (n == 0) { analyser = g_clef_analyser; lineAnalyser = scoreData->g_clef_analysis; }
+            else if (n == 1) { analyser = f_clef_analyser; lineAnalyser = scoreData->f_clef_analysis; }
             else             ASSERT(false);
             
             ASSERT(analyser != NULL);
-
-            OwnerPtr<ScoreAnalyser> lineAnalyser;
-            lineAnalyser = analyser->getSubset(fromTick, toTick);
-            lineAnalyser->analyseNoteInfo();
+            ASSERT(lineAnalyser != NULL);
             
             const int noteAmount = lineAnalyser->m_note_render_info.size();
             for (int i=0; i<noteAmount; i++)
@@ -1263,8 +1324,9 @@ namespace AriaMaestosa
     
     // -------------------------------------------------------------------------------------------
     
-    void ScorePrintable::analyseAndDrawScore(ClefRenderType clefType, ScoreAnalyser& analyser, LayoutLine& line,
-                                             const GraphicalTrack* gtrack, wxDC& dc, wxGraphicsContext* grctx,
+    void ScorePrintable::analyseAndDrawScore(ClefRenderType clefType, ScoreAnalyser& analyser,
+                                             ScoreAnalyser& lineNotes, ScoreAnalyser& lineAnalysis,
+                                             LayoutLine& line, const GraphicalTrack* gtrack, wxDC& dc, wxGraphicsContext* grctx,
                                              const int extra_lines_above, const int extra_lines_under,
                                              const int x0, const int y0, const int x1, const int y1,
                                              bool show_measure_number, const int grandStaffCenterY)
@@ -1636,10 +1698,6 @@ namespace AriaMaestosa
 
         
         
-        OwnerPtr<ScoreAnalyser> lineAnalyser;
-        lineAnalyser = analyser.getSubset(fromTick, toTick);
-        
-        
         g_printable = this;
         
         // ---- render silences
@@ -1663,14 +1721,14 @@ namespace AriaMaestosa
         {
             const int silences_y = LEVEL_TO_Y(m_middle_c_level + 4);
             g_line_height = m_line_height;
-            SilenceAnalyser::findSilences(track->getSequence(), &renderSilenceCallback, lineAnalyser,
+            SilenceAnalyser::findSilences(track->getSequence(), &renderSilenceCallback, &lineNotes,
                                           first_measure, last_measure, silences_y, m_x_converter);
         }
         else
         {
             const int silences_y = LEVEL_TO_Y(m_middle_c_level - 8);
             g_line_height = m_line_height;
-            SilenceAnalyser::findSilences(track->getSequence(), &renderSilenceCallback, lineAnalyser,
+            SilenceAnalyser::findSilences(track->getSequence(), &renderSilenceCallback, &lineNotes,
                                           first_measure, last_measure, silences_y, m_x_converter);
         }
         
@@ -1679,20 +1737,15 @@ namespace AriaMaestosa
         #endif
         
         // ------------------ second part : intelligent drawing of the rest -----------------
-        if (LOGGING) std::cout << "[ScorePrintable] analyzing score\n";
-        
-        // analyse notes to know how to build the score
-        lineAnalyser->analyseNoteInfo();
-        
+        // the notes of this line were analysed during layout (see 'prepareLine'), to know how to build the score
         if (LOGGING) std::cout << "[ScorePrintable] rendering note ornaments\n";
-        // now that score was analysed, draw the remaining note bits
-        const int noteAmount = lineAnalyser->m_note_render_info.size();
+        const int noteAmount = lineAnalysis.m_note_render_info.size();
         for (int i=0; i<noteAmount; i++)
         {
             #if wxCHECK_VERSION(2,9,1) && wxUSE_GRAPHICS_CONTEXT
             grctx->PushState();
             #endif
-            NoteRenderInfo& noteRenderInfo = lineAnalyser->m_note_render_info[i];
+            NoteRenderInfo& noteRenderInfo = lineAnalysis.m_note_render_info[i];
             
             dc.SetPen(  wxPen( wxColour(0,0,0), 15 ) );
             
@@ -45,7 +45,13 @@ namespace AriaMaestosa
             F_CLEF_FROM_GRAND_STAFF
         };
         
-        void analyseAndDrawScore(ClefRenderType clefType, ScoreAnalyser& analyser, LayoutLine& line,
+        /**
+          * @param analyser      analyser of the whole track, for this clef
+          * @param lineNotes     notes of this line, for this clef, before analysis
+          * @param lineAnalysis  notes of this line, for this clef, once analysed
+          */
+        void analyseAndDrawScore(ClefRenderType clefType, ScoreAnalyser& analyser,
+                                 ScoreAnalyser& lineNotes, ScoreAnalyser& lineAnalysis, LayoutLine& line,
                                  const GraphicalTrack* track, wxDC& dc,
                                  wxGraphicsContext* grctx, const int extra_lines_above, const int extra_lines_under,
                                  const int x0, const int y0, const int x1, const int y1,
@@ -112,6 +118,9 @@ namespace AriaMaestosa
         virtual void drawTrack(const int trackID, const LineTrackRef& track, LayoutLine& line,
                                wxDC& dc, wxGraphicsContext* gc, const bool drawMeasureNumbers);
         
+        /** Implement method from EditorPrintable : copies the notes of the line, to be analysed in parallel */
+        virtual LineAnalysisJob* prepareLine(const int trackID, LineTrackRef& track, LayoutLine& line);
+        
         /** Implement method from EditorPrintable */
         virtual int calculateHeight(const int trackID, LineTrackRef& renderInfo, LayoutLine& line, bool* empty);
         
@@ -82,11 +82,15 @@ void SymbolPrintableSequence::calculateLayout()
 {
     ASSERT( MAGIC_NUMBER_OK_FOR(m_tracks) );
     
+    if (m_layout_calculated) return;
+    
     m_abstract_layout_manager = new PrintLayoutAbstract(this);
     m_abstract_layout_manager->addLayoutInformation(m_tracks, layoutPages /* out */);
     
     // prepare it for when we're ready to print
     m_numeric_layout_manager = new PrintLayoutNumeric();
+    m_page_placements.clear();
+    m_page_placements.resize(layoutPages.size());
     
     AbstractPrintableSequence::calculateLayout();
 }
@@ -127,9 +131,21 @@ void SymbolPrintableSequence::printLinesInArea(wxDC& dc, wxGraphicsContext* grct
 
     LayoutPage& page = getPage(pageID);
     
-    // ---- Give each track an area on the page
-    m_numeric_layout_manager->placeLinesInPage(page, notation_area_y0, notation_area_h,
-                                               pageHeight, x0, x1);
+    // ---- Give each track an area on the page (unless it was already done for that same area)
+    PagePlacement& placement = m_page_placements[pageID];
+    if (not placement.placed or placement.notation_area_y0 != notation_area_y0 or
+        placement.notation_area_h != notation_area_h or placement.pageHeight != pageHeight or
+        placement.x0 != x0 or placement.x1 != x1)
+    {
+        m_numeric_layout_manager->placeLinesInPage(page, notation_area_y0, notation_area_h,
+                                                   pageHeight, x0, x1);
+        placement.placed           = true;
+        placement.notation_area_y0 = notation_area_y0;
+        placement.notation_area_h  = notation_area_h;
+        placement.pageHeight       = pageHeight;
+        placement.x0               = x0;
+        placement.x1               = x1;
+    }
     
     // ---- Draw the tracks
     const wxFont regularFont = getPrintFont();
@@ -64,6 +64,18 @@ namespace AriaMaestosa
 
         /** the max number of sharp/flats we'll need to display at header (useful to allocate proper size) */
         int m_max_signs_in_keysig;
+        
+        /** Area in which the lines of a page were last placed, so pages drawn again (e.g. in the
+          * print preview) are not laid out again */
+        struct PagePlacement
+        {
+            bool  placed;
+            float notation_area_y0, notation_area_h;
+            int   pageHeight, x0, x1;
+            
+            PagePlacement() : placed(false) {}
+        };
+        std::vector<PagePlacement> m_page_placements;
 
     public:
                 
@@ -79,7 +91,8 @@ namespace AriaMaestosa
         /**
           * @brief Prepare the abstract layout for this sequence.
           * Divides sequence in pages, decides contents of each line, etc.
-          * Must be called before actually printing.
+          * Must be called before actually printing. The layout is only calculated once, calling
+          * this method again does nothing.
           */
         virtual void calculateLayout();
         
@@ -344,8 +344,10 @@ bool wxEasyPrintWrapper::OnPrintPage(int pageNum)
     {
         gc = wxGraphicsContext::Create( dynamic_cast<wxMemoryDC&>(dc) );
     }
+    // the wxGCDC owns 'gc' and deletes it along with itself
     wxGCDC* gcdc = new wxGCDC(gc);
     m_print_callback->printPage(pageNum, *gcdc, gc, x0, y0, x1, y1);
+    delete gcdc;
 #else
     m_print_callback->printPage(pageNum, dc, NULL, x0, y0, x1, y1);
 #endif
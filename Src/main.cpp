@@ -21,17 +21,21 @@
 #include <wx/snglinst.h>
 #include <wx/ipc.h>      // IPC support
 #include <wx/filename.h>
+#include <wx/stopwatch.h>
 #include <wx/tokenzr.h>
 
 #include "GUI/MainFrame.h"
 #include "GUI/MainPane.h"
+#include "IO/BatchImport.h"
 #include "Midi/Players/PlatformMidiManager.h"
 #include "Midi/KeyPresets.h"
 #include "PreferencesData.h"
+#include "Printing/HeadlessPrint.h"
 #include "languages.h"
 #include "UnitTest.h"
 #include "Utils.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "main.h"
@@ -135,6 +139,77 @@ public:
 
 
 
+// ------------------------------------------------------------------------------------------------------
+// ------------------------------------------------------------------------------------------------------
+
+/** prints the outcome of each file converted with '--convert-midi' */
+static void printBatchImportResult(const BatchImportResult& result, int done, int total)
+{
+    std::cout << "[" << done << "/" << total << "] " << result.m_source.mb_str();
+    if (not result.m_success)
+    {
+        std::cout << " : FAILED" << std::endl;
+        return;
+    }
+
+    const double seconds = std::max(result.m_time_ms, 1L)/1000.0;
+    std::cout << " -> " << result.m_destination.mb_str() << " : " << result.m_note_count << " notes, "
+              << result.m_file_size/1024 << " KiB in " << result.m_time_ms << " ms ("
+              << (int)(result.m_file_size/1024/seconds) << " KiB/s, "
+              << (int)(result.m_note_count/seconds) << " notes/s)" << std::endl;
+}
+
+/**
+  * Converts MIDI files to .aria without opening any window.
+  * @param args  the output directory, followed by MIDI files and/or directories containing MIDI files
+  * @return whether all files were converted
+  */
+static bool batchConvertMidiFiles(const wxArrayString& args)
+{
+    if (args.GetCount() < 2)
+    {
+        std::cerr << "Usage: --convert-midi <output directory> <MIDI file or directory>..." << std::endl;
+        return false;
+    }
+
+    const wxString outputDir = args[0];
+    if (not wxDirExists(outputDir) and not wxFileName::Mkdir(outputDir, 0777, wxPATH_MKDIR_FULL))
+    {
+        std::cerr << "Cannot create output directory " << outputDir.mb_str() << std::endl;
+        return false;
+    }
+
+    BatchImporter importer;
+    for (unsigned int n=1; n<args.GetCount(); n++)
+    {
+        if (wxDirExists(args[n]))
+        {
+            importer.addDirectory(args[n], outputDir);
+        }
+        else
+        {
+            wxFileName source(args[n]);
+            importer.addFile(source.GetFullPath(), wxFileName(outputDir, source.GetName(), wxT("aria")).GetFullPath());
+        }
+    }
+
+    wxStopWatch watch;
+    importer.run(&printBatchImportResult);
+    const long time = watch.Time();
+
+    const std::vector<BatchImportResult>& results = importer.getResults();
+    int failed = 0;
+    for (unsigned int n=0; n<results.size(); n++)
+    {
+        if (not results[n].m_success) failed++;
+    }
+
+    std::cout << "Converted " << (results.size() - failed) << " of " << results.size() << " files in "
+              << time << " ms (" << (int)(results.size()*1000.0/std::max(time, 1L)) << " files/s)" << std::endl;
+
+    return failed == 0;
+}
+
 // ------------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------------------------
 
@@ -168,6 +243,22 @@ void wxWidgetApp::onIdle(wxIdleEvent& evt)
     {
         pmm->processRecordQueue();
     }
+    
+    // '--print-png' : print once the file from the command line was processed
+    if (not m_print_png_directory.IsEmpty() and frame != NULL and frame->areStartupFilesOpened())
+    {
+        const wxString directory = m_print_png_directory;
+        m_print_png_directory = wxEmptyString;
+        
+        if (frame->getSequenceAmount() == 0)
+        {
+            std::cerr << "Could not load the file to print" << std::endl;
+            exit(1);
+        }
+        
+        const bool success = printToImages(frame->getCurrentSequence(), directory);
+        exit(success ? 0 : 1);
+    }
 }
 
 // ------------------------------------------------------------------------------------------------------
@@ -207,6 +298,30 @@ bool wxWidgetApp::OnInit()
             UnitTestCase::showMenu();
             exit(0);
         }
+        else if (wxString(argv[n]) == wxT("--convert-midi"))
+        {
+            okToLog = false;
+            prefs = PreferencesData::getInstance();
+            prefs->init();
+
+            wxArrayString args;
+            for (int i=n+1; i<argc; i++) args.Add( wxString(argv[i]) );
+
+            exit( batchConvertMidiFiles(args) ? 0 : 1 );
+        }
+        else if (wxString(argv[n]) == wxT("--print-png"))
+        {
+            // check what can be checked here, rather than have MainFrame complain in a message box
+            const wxString file = (n + 2 < argc ? cleanPath(wxString(argv[n+2])) : wxString());
+            if (not wxFileExists(file) or
+                not (file.EndsWith(wxT("aria")) or file.EndsWith(wxT("mid")) or file.EndsWith(wxT("midi")) or
+                     file.EndsWith(wxT("MID"))  or file.EndsWith(wxT("MIDI"))))
+            {
+                std::cerr << "Usage: --print-png <output directory> <.aria or MIDI file>" << std::endl;
+                exit(1);
+            }
+            m_print_png_directory = wxString(argv[n+1]);
+        }
         else if (wxString(argv[n]) == wxT("--verbose"))
         {
             wxLog::SetLogLevel(wxLOG_Info);
@@ -223,7 +338,8 @@ bool wxWidgetApp::OnInit()
 #ifndef __WXMAC__
     m_single_instance_checker = new wxSingleInstanceChecker(appName + wxGetUserId(), wxT("/tmp/"));
     
-    if ( prefs->getBoolValue(SETTING_ID_SINGLE_INSTANCE_APPLICATION, true) &&
+    if ( m_print_png_directory.IsEmpty() &&
+        prefs->getBoolValue(SETTING_ID_SINGLE_INSTANCE_APPLICATION, true) &&
         m_single_instance_checker->IsAnotherRunning() )
     {
         std::cout << "[main] detected another Aria instance" << std::endl;
@@ -266,11 +382,18 @@ bool wxWidgetApp::OnInit()
     
     wxArrayString filesToOpen;
     
-    addLastSessionFiles(prefs, filesToOpen);
+    // when printing from the command line, only open the file to print
+    if (m_print_png_directory.IsEmpty()) addLastSessionFiles(prefs, filesToOpen);
     
     // check if filenames to open were given on the command-line
     for (int n=1 ; n<argc ; n++)
     {
+        if (wxString(argv[n]) == wxT("--print-png"))
+        {
+            n++; // skip the output directory
+            continue;
+        }
+        
         wxString fileName = cleanPath(wxString(argv[n]));
         if (fileName!=RELOAD_PARAM)
         {
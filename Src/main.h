@@ -48,6 +48,10 @@ namespace AriaMaestosa
 
         bool m_render_loop_on;
         
+        /** if not empty, the directory where to save the pages of the printout of the file given on
+          * the command line (with '--print-png'), after which the app quits */
+        wxString m_print_png_directory;
+        
         
         wxWidgetApp() { frame = NULL; }
         
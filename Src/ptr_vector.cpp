@@ -2,6 +2,8 @@
 #include "ptr_vector.h"
 #include "UnitTest.h"
 
+#include <algorithm>
+
 namespace AriaMaestosa
 {
         
@@ -54,4 +56,82 @@ namespace AriaMaestosa
         require_e(s[9],  ==, 98, "Vector sorted correctly");
         require_e(s[10], ==, 99, "Vector sorted correctly");
     }
+    
+    struct SortItem
+    {
+        int m_key;
+        int m_order;
+        
+        SortItem(int key, int order) : m_key(key), m_order(order) {}
+        
+        bool operator<(const SortItem& other) const { return m_key < other.m_key; }
+    };
+    
+    int getSortItemKey(SortItem* item)
+    {
+        return item->m_key;
+    }
+    
+    bool sameOrder(const SortItem* a, const SortItem* b)
+    {
+        return a->m_key == b->m_key and a->m_order == b->m_order;
+    }
+    
+    bool stableLess(const SortItem* a, const SortItem* b)
+    {
+        return a->m_key < b->m_key or (a->m_key == b->m_key and a->m_order < b->m_order);
+    }
+    
+    UNIT_TEST( VectorMergeSortTest )
+    {
+        // random keys with many ties, in runs going up and down, to test stability and run detection
+        unsigned int seed = 7;
+        for (int size=0; size<300; size += 7)
+        {
+            ptr_vector<SortItem> v1, v2;
+            for (int n=0; n<size; n++)
+            {
+                seed = seed*1103515245 + 12345;
+                int key = (seed >> 16) % 20;
+                if ((n / 40) % 3 == 1) key = 1000 - n;  // descending stretch
+                if ((n / 40) % 3 == 2) key = n / 2;     // ascending stretch with ties
+                v1.push_back( new SortItem(key, n) );
+                v2.push_back( new SortItem(key, n) );
+            }
+            
+            v1.mergeSort();
+            v2.mergeSort(getSortItemKey);
+            
+            std::vector<SortItem*> expected(v1.contentsVector);
+            std::sort(expected.begin(), expected.end(), stableLess);
+            
+            require(std::equal(expected.begin(), expected.end(), v1.contentsVector.begin(), sameOrder),
+                    "items are sorted, ties are kept in their original order");
+            require(std::equal(expected.begin(), expected.end(), v2.contentsVector.begin(), sameOrder),
+                    "items are sorted by key, ties are kept in their original order");
+        }
+    }
+    
+    UNIT_TEST( VectorMergeSortSameAsInsertionSort )
+    {
+        // as after moving every other note of a track far later : many items far from their place
+        const int COUNT = 500;
+        ptr_vector<SortItem> v1, v2;
+        for (int n=0; n<COUNT; n++)
+        {
+            const int key = n*10 + (n % 2 == 0 ? 2500 : 0);
+            v1.push_back( new SortItem(key, n) );
+            v2.push_back( new SortItem(key, n) );
+        }
+        
+        v1.insertionSort(getSortItemKey);
+        v2.mergeSort(getSortItemKey);
+        require(std::equal(v1.contentsVector.begin(), v1.contentsVector.end(), v2.contentsVector.begin(),
+                           sameOrder), "both sorts give the same result");
+        
+        // sorting an already sorted vector leaves it as is
+        v2.mergeSort(getSortItemKey);
+        require(std::equal(v1.contentsVector.begin(), v1.contentsVector.end(), v2.contentsVector.begin(),
+                           sameOrder), "a sorted vector is unchanged");
+    }
 }
@@ -24,6 +24,7 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
 
 #include "Utils.h"
 
@@ -36,6 +37,97 @@ namespace AriaMaestosa
         HOLD
     };
     
+    /**
+     * Stable sort that takes advantage of the order already present in the data : it splits the vector
+     * in runs that are already sorted (or sorted backwards), then merges them pairwise. A sorted vector
+     * costs a single pass, a vector with a few misplaced items a few passes, and any order at most
+     * O(n log n), unlike insertion sort which degrades to O(n^2) when many items move far away.
+     *
+     * @param less  functor telling whether its first argument must come before its second
+     */
+    template<typename T, typename LESS>
+    void adaptiveMergeSort(std::vector<T>& items, LESS less)
+    {
+        const int count = items.size();
+        if (count < 2) return;
+        
+        // short runs are extended to this length with insertion sort, to avoid merging tiny runs
+        const int MIN_RUN = 32;
+        
+        // ---- find runs
+        std::vector<int> runEnds;
+        int from = 0;
+        while (from < count)
+        {
+            int to = from + 1;
+            if (to < count and less(items[to], items[from]))
+            {
+                // strictly descending, so reversing it keeps equal items in order
+                while (to < count and less(items[to], items[to-1])) to++;
+                std::reverse(items.begin() + from, items.begin() + to);
+            }
+            else
+            {
+                while (to < count and not less(items[to], items[to-1])) to++;
+            }
+            
+            if (to - from < MIN_RUN and to < count)
+            {
+                const int end = std::min(count, from + MIN_RUN);
+                for (int n=to; n<end; n++)
+                {
+                    T t = items[n];
+                    int i = n;
+                    while (i > from and less(t, items[i-1]))
+                    {
+                        items[i] = items[i-1];
+                        i--;
+                    }
+                    items[i] = t;
+                }
+                to = end;
+            }
+            
+            runEnds.push_back(to);
+            from = to;
+        }
+        
+        if (runEnds.size() == 1) return; // already sorted
+        
+        // ---- merge runs pairwise, back and forth between the vector and a buffer
+        std::vector<T> buffer(items);
+        std::vector<T>* source = &items;
+        std::vector<T>* target = &buffer;
+        
+        while (runEnds.size() > 1)
+        {
+            std::vector<int> mergedEnds;
+            int runFrom = 0;
+            for (unsigned int r=0; r<runEnds.size(); r+=2)
+            {
+                const int middle = runEnds[r];
+                const int runTo  = (r + 1 < runEnds.size() ? runEnds[r+1] : middle);
+                
+                int a = runFrom, b = middle, out = runFrom;
+                while (a < middle and b < runTo)
+                {
+                    // take from the left run on ties, to keep the sort stable
+                    if (less((*source)[b], (*source)[a])) (*target)[out++] = (*source)[b++];
+                    else                                  (*target)[out++] = (*source)[a++];
+                }
+                while (a < middle) (*target)[out++] = (*source)[a++];
+                while (b < runTo)  (*target)[out++] = (*source)[b++];
+                
+                mergedEnds.push_back(runTo);
+                runFrom = runTo;
+            }
+            runEnds.swap(mergedEnds);
+            std::swap(source, target);
+        }
+        
+        if (source != &items) items.swap(buffer);
+    }
+    
     template<typename TYPE, VECTOR_TYPE type=HOLD>
     class ptr_vector
     {
@@ -406,6 +498,43 @@ namespace AriaMaestosa
         
         // ------------------------------------------------------------------------
         
+        /** compares two items through their operator< */
+        struct PointeeLess
+        {
+            bool operator()(const TYPE* a, const TYPE* b) const { return *a < *b; }
+        };
+        
+        /** compares two items through the value returned by a function */
+        template<typename F, typename T>
+        struct FieldLess
+        {
+            F (*m_get_sort_field)(T*);
+            bool operator()(TYPE* a, TYPE* b) const { return m_get_sort_field(a) < m_get_sort_field(b); }
+        };
+        
+        /**
+         * @brief stable sort using operator< of the items, fast both when the vector is almost sorted
+         *        and when many items moved (see adaptiveMergeSort)
+         */
+        void mergeSort()
+        {
+            adaptiveMergeSort(contentsVector, PointeeLess());
+        }
+        
+        /**
+         * @brief stable sort by the value 'getSortFieldFn' returns for each item, fast both when the vector
+         *        is almost sorted and when many items moved (see adaptiveMergeSort)
+         */
+        template<typename F, typename T>
+        void mergeSort(F (*getSortFieldFn)(T*))
+        {
+            FieldLess<F, T> less;
+            less.m_get_sort_field = getSortFieldFn;
+            adaptiveMergeSort(contentsVector, less);
+        }
+        
+        // ------------------------------------------------------------------------
+        
         template<typename F, typename T>
         void insertionSort(F (*getSortFieldFn)(T*))
         {
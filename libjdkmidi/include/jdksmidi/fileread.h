@@ -48,6 +48,8 @@ namespace jdksmidi
 
 class MIDIFileReadStream;
 class MIDIFileReadStreamFile;
+class MIDIFileReadStreamMemory;
+class MIDIFileReadStreamMapped;
 class MIDIFileEvents;
 class MIDIFileRead;
 
@@ -66,6 +68,14 @@ public:
     virtual void Rewind() = 0;
 
     virtual int ReadChar() = 0;
+
+    // streams that hold the whole file in memory return it here, so that
+    // MIDIFileRead can parse it in place instead of calling ReadChar() for
+    // each byte. returns 0 if the stream can only be read byte by byte
+    virtual const unsigned char *GetSpan ( unsigned long *length )
+    {
+        return 0;
+    }
 };
 
 class MIDIFileReadStreamFile : public MIDIFileReadStream
@@ -119,6 +129,71 @@ private:
     FILE *f;
 };
 
+// reads a MIDI file already in memory; the buffer is not copied and must
+// outlive the stream
+class MIDIFileReadStreamMemory : public MIDIFileReadStream
+{
+public:
+    MIDIFileReadStreamMemory ( const unsigned char *data_, unsigned long length_ )
+        : data ( data_ ), length ( length_ ), pos ( 0 )
+    {
+    }
+
+    virtual void Rewind()
+    {
+        pos = 0;
+    }
+
+    virtual int ReadChar()
+    {
+        if ( pos < length )
+            return data[pos++];
+
+        return -1;
+    }
+
+    virtual const unsigned char *GetSpan ( unsigned long *length_ )
+    {
+        *length_ = length;
+        return data;
+    }
+
+protected:
+    MIDIFileReadStreamMemory() : data ( 0 ), length ( 0 ), pos ( 0 )
+    {
+    }
+
+    const unsigned char *data;
+    unsigned long length;
+    unsigned long pos;
+};
+
+// reads a MIDI file by mapping it in memory (or, where mapping is not
+// available, by reading it whole in one call), so that MIDIFileRead parses
+// it in place
+class MIDIFileReadStreamMapped : public MIDIFileReadStreamMemory
+{
+public:
+    explicit MIDIFileReadStreamMapped ( const char *fname );
+
+#ifdef WIN32
+    explicit MIDIFileReadStreamMapped ( const wchar_t *fname );
+#endif
+
+    virtual ~MIDIFileReadStreamMapped();
+
+    bool IsValid() const
+    {
+        return valid;
+    }
+
+private:
+    bool Load ( FILE *f );
+
+    bool valid;
+    bool mapped; // whether 'data' must be unmapped or freed
+};
+
 class MIDIFileEvents : protected MIDIFile
 {
 public:
@@ -229,6 +304,7 @@ private:
     int Read16Bit();
 
     void ReadTrack();
+    void ReadTrackSpan();
 
     void MsgAdd ( int );
     void MsgInit();
@@ -249,6 +325,11 @@ private:
 
     MIDIFileReadStream *input_stream;
     MIDIFileEvents *event_handler;
+
+    // when the stream exposes its data with GetSpan(), the parser reads it
+    // directly through these pointers and the stream itself is not used
+    const unsigned char *span_cur;
+    const unsigned char *span_end;
 };
 }
 
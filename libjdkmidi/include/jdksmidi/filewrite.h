@@ -58,6 +58,11 @@ public:
 
     virtual long Seek ( long pos, int whence = SEEK_SET ) = 0;
     virtual int WriteChar ( int c ) = 0;
+
+    // writes 'count' bytes at once, returns count or -1 on error.
+    // the default implementation calls WriteChar() for each byte; streams that
+    // can do better (e.g. memory buffers) should override it
+    virtual int WriteChars ( const unsigned char *data, int count );
 };
 
 class MIDIFileWriteStreamFile : public MIDIFileWriteStream
@@ -68,6 +73,7 @@ public:
 
     long Seek ( long pos, int whence = SEEK_SET );
     int WriteChar ( int c );
+    int WriteChars ( const unsigned char *data, int count );
 protected:
     FILE *f;
 };
@@ -163,6 +169,12 @@ protected:
             error = true;
     }
 
+    void WriteCharacters ( const uchar *data, int count )
+    {
+        if ( count > 0 && out_stream->WriteChars ( data, count ) < 0 )
+            error = true;
+    }
+
     void Seek ( long pos )
     {
         if ( out_stream->Seek ( pos ) < 0 )
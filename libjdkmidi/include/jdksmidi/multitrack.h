@@ -153,11 +153,51 @@ public:
     void Reset();
     int FindTrackOfFirstEvent();
 
+    // call after changing next_event_number[track] or next_event_time[track]
+    void UpdateTrackOrder ( int track );
+    // call after changing next_event_number[] or next_event_time[] of many tracks
+    void RebuildTrackOrder();
+
     MIDIClockTime cur_time;
     int cur_event_track;
     int num_tracks;
     int *next_event_number;
     MIDIClockTime *next_event_time;
+
+protected:
+
+    // The tracks that have events left are kept in two places, so that finding the next event does not
+    // require scanning all tracks :
+    //  - the tracks whose next event is at the earliest time, 'tied_time', in tied_tracks[], sorted by
+    //    track number; they take turns, like when scanning all tracks starting after the current one.
+    //  - all other tracks in a min-heap ordered by next event time then by track number; when all tied
+    //    tracks moved on, the tracks with the earliest event of the heap become the new tied tracks.
+    int *heap;
+    int heap_size;
+    int *tied_tracks;
+    int tied_count;
+    MIDIClockTime tied_time;
+    // position of each track in heap[], IN_TIED_TRACKS, or -1 if the track has no events left
+    int *heap_position;
+
+    enum { IN_TIED_TRACKS = -2 };
+
+    bool HeapLess ( int track_a, int track_b ) const
+    {
+        return next_event_time[track_a] < next_event_time[track_b]
+               || ( next_event_time[track_a] == next_event_time[track_b] && track_a < track_b );
+    }
+    void HeapSwap ( int pos_a, int pos_b );
+    void HeapSiftUp ( int pos );
+    void HeapSiftDown ( int pos );
+    void HeapInsert ( int track );
+    void HeapRemove ( int pos );
+    void TiedInsert ( int track );
+    void TiedRemove ( int track );
+    void TiedFlush();
+    void TiedFill();
+    void Allocate();
+    void CopyFrom ( const MIDIMultiTrackIteratorState &m );
 };
 
 class MIDIMultiTrackIterator
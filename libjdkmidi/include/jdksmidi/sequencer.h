@@ -35,6 +35,9 @@
 #include "jdksmidi/matrix.h"
 #include "jdksmidi/process.h"
 
+// maximum amount of sequencer states kept to speed up seeking, see MIDISequencer::ClearCheckpoints()
+#define MAX_SEQUENCER_CHECKPOINTS (64)
+
 namespace jdksmidi
 {
 
@@ -320,6 +323,12 @@ public:
     bool GoToTimeMs ( float time_ms );
     bool GoToMeasure ( int measure, int beat = 0 );
 
+    // GoToTime() and GoToTimeMs() keep a copy of the sequencer state every few measures they go through,
+    // and later seeks resume from the nearest one before the requested time instead of from zero.
+    // these copies are dropped when the tempo scale, solo mode or track states are changed through this
+    // class; call ClearCheckpoints() after changing the multitrack or a track processor.
+    void ClearCheckpoints();
+
     bool GetNextEventTimeMs ( float *t );
     bool GetNextEventTimeMs ( double *t );
     bool GetNextEventTime ( MIDIClockTime *t );
@@ -341,6 +350,22 @@ protected:
     MIDISequencerTrackProcessor *track_processors[64];
 
     MIDISequencerState state;
+
+    // save the current state as checkpoint, unless one was already saved near the current time
+    void SaveCheckpoint();
+
+    // last checkpoint whose events all come before time_clk (or time_ms), or 0 if there is none
+    const MIDISequencerState *FindCheckpoint ( MIDIClockTime time_clk ) const;
+    const MIDISequencerState *FindCheckpointMs ( float time_ms ) const;
+
+    // checkpoints[i] is a state saved between times i * checkpoint_interval
+    // and (i+1) * checkpoint_interval, or 0
+    MIDIClockTime checkpoint_interval;
+    MIDISequencerState *checkpoints[MAX_SEQUENCER_CHECKPOINTS];
+
+    // true while the current state is the one reached by going through events from zero
+    // (or from a checkpoint), with the current settings; only such a state is saved as checkpoint
+    bool on_checkpoint_path;
 } ;
 
 }
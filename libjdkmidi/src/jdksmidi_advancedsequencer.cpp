@@ -391,6 +391,7 @@ void AdvancedSequencer::UnmuteAllTracks()
         {
             seq.GetTrackState ( i )->note_matrix.Clear();
             seq.GetTrackProcessor ( i )->mute = false;
+            seq.ClearCheckpoints();
         }
     }
 
@@ -453,6 +454,7 @@ void AdvancedSequencer::SetTrackMute ( int trk, bool f )
     }
 
     seq.GetTrackProcessor ( trk )->mute = f;
+    seq.ClearCheckpoints();
     driver.AllNotesOff();
 }
 
@@ -578,6 +580,7 @@ void AdvancedSequencer::SetTrackVelocityScale ( int trk, int scale )
     }
 
     seq.GetTrackProcessor ( trk )->velocity_scale = scale;
+    seq.ClearCheckpoints();
 }
 
 
@@ -601,6 +604,7 @@ void AdvancedSequencer::SetTrackRechannelize ( int trk, int chan )
     }
 
     seq.GetTrackProcessor ( trk )->rechannel = chan;
+    seq.ClearCheckpoints();
     driver.AllNotesOff();
     seq.GetTrackState ( trk )->note_matrix.Clear();
 }
@@ -646,6 +650,8 @@ void AdvancedSequencer::SetTrackTranspose ( int trk, int trans )
         seq.GetTrackProcessor ( trk )->transpose = trans;
     }
 
+    seq.ClearCheckpoints();
+
     if ( was_playing )
     {
 #if 0
@@ -38,6 +38,13 @@
 #include "jdksmidi/world.h"
 #include "jdksmidi/fileread.h"
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 // Standard MIDI-File Format Spec. 1.1, page 9 of 18:
 // "Sysex events and meta events cancel any running status which was in effect.
 // Running status does not apply to and may not be used for these messages."
@@ -48,6 +55,126 @@
 namespace jdksmidi
 {
 
+//
+// This array is indexed by the high half of a status byte.
+// Its/ value is either the number of bytes needed (1 or 2) for a channel message,
+// or 0 (meaning it's not a channel message).
+//
+static const char chantype[] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0,  // 0x00 through 0x70
+    2, 2, 2, 2, 1, 1, 2, 0   // 0x80 through 0xF0
+};
+
+MIDIFileReadStreamMapped::MIDIFileReadStreamMapped ( const char *fname )
+    : valid ( false ), mapped ( false )
+{
+#ifndef WIN32
+    int fd = open ( fname, O_RDONLY );
+
+    if ( fd < 0 )
+        return;
+
+    struct stat st;
+
+    if ( fstat ( fd, &st ) == 0 && st.st_size > 0 )
+    {
+        void *p = mmap ( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        if ( p != MAP_FAILED )
+        {
+            madvise ( p, st.st_size, MADV_SEQUENTIAL );
+            data = ( const unsigned char * ) p;
+            length = st.st_size;
+            mapped = true;
+            valid = true;
+        }
+    }
+
+    close ( fd );
+
+    if ( valid )
+        return;
+#endif
+
+    // mapping not available or failed (e.g. empty file or pipe), read the file whole instead
+    FILE *f = fopen ( fname, "rb" );
+
+    if ( f )
+    {
+        valid = Load ( f );
+        fclose ( f );
+    }
+}
+
+#ifdef WIN32
+MIDIFileReadStreamMapped::MIDIFileReadStreamMapped ( const wchar_t *fname )
+    : valid ( false ), mapped ( false )
+{
+    FILE *f = _wfopen ( fname, L"rb" );
+
+    if ( f )
+    {
+        valid = Load ( f );
+        fclose ( f );
+    }
+}
+#endif
+
+MIDIFileReadStreamMapped::~MIDIFileReadStreamMapped()
+{
+#ifndef WIN32
+    if ( mapped )
+    {
+        munmap ( ( void * ) data, length );
+        return;
+    }
+#endif
+
+    free ( ( void * ) data );
+}
+
+bool MIDIFileReadStreamMapped::Load ( FILE *f )
+{
+    unsigned char *buf = 0;
+    unsigned long len = 0;
+    unsigned long capacity = 0;
+
+    // the size is not known in advance for all kinds of files, grow in large blocks
+    while ( true )
+    {
+        if ( len == capacity )
+        {
+            capacity = ( capacity == 0 ) ? 65536 : capacity * 2;
+            unsigned char *grown = ( unsigned char * ) realloc ( buf, capacity );
+
+            if ( grown == 0 )
+            {
+                free ( buf );
+                return false;
+            }
+
+            buf = grown;
+        }
+
+        size_t got = fread ( buf + len, 1, capacity - len, f );
+        len += got;
+
+        if ( got == 0 )
+            break;
+    }
+
+    if ( ferror ( f ) )
+    {
+        free ( buf );
+        return false;
+    }
+
+    data = buf;
+    length = len;
+    return true;
+}
+
 void MIDIFileEvents::UpdateTime ( MIDIClockTime delta_time )
 {
 }
@@ -254,6 +381,8 @@ MIDIFileRead::MIDIFileRead (
     cur_track = 0;
     abort_parse = 0;
     used_running_status = false;
+    span_cur = 0;
+    span_end = 0;
 
     max_msg_len = max_msg_len_;
     the_msg = new unsigned char[max_msg_len];
@@ -283,6 +412,10 @@ void MIDIFileRead::Reset()
 
     // rewind input stream
     input_stream->Rewind();
+
+    unsigned long length = 0;
+    span_cur = input_stream->GetSpan ( &length );
+    span_end = span_cur ? span_cur + length : 0;
 }
 
 int MIDIFileRead::ReadNumTracks()
@@ -404,16 +537,6 @@ int MIDIFileRead::ReadHeader()
 
 void MIDIFileRead::ReadTrack()
 {
-    //
-    // This array is indexed by the high half of a status byte.
-    // Its/ value is either the number of bytes needed (1 or 2) for a channel message,
-    // or 0 (meaning it's not a channel message).
-    //
-    static char chantype[] =
-    {
-        0, 0, 0, 0, 0, 0, 0, 0,  // 0x00 through 0x70
-        2, 2, 2, 2, 1, 1, 2, 0   // 0x80 through 0xF0
-    };
     unsigned long lookfor, lng;
     int c, c1, type;
     int running = 0; // 1 when running status used
@@ -430,6 +553,13 @@ void MIDIFileRead::ReadTrack()
     cur_time = 0;
     event_handler->mf_starttrack ( cur_track );
 
+    if ( span_cur )
+    {
+        ReadTrackSpan();
+        event_handler->mf_endtrack ( cur_track );
+        return;
+    }
+
     while ( to_be_read > 0 && !abort_parse )
     {
         unsigned long deltat = ReadVariableNum();
@@ -527,6 +657,158 @@ void MIDIFileRead::ReadTrack()
     return;
 }
 
+//
+// same as the event loop of ReadTrack(), for streams that expose their data
+// with GetSpan() : the events are decoded straight from memory
+//
+
+static inline bool SpanReadVariableNum ( const unsigned char *&p, const unsigned char *end, unsigned long &value )
+{
+    value = 0;
+
+    while ( p < end )
+    {
+        unsigned char c = *p++;
+        value = ( value << 7 ) + ( c & 0x7f );
+
+        if ( ( c & 0x80 ) == 0 )
+            return true;
+    }
+
+    return false;
+}
+
+void MIDIFileRead::ReadTrackSpan()
+{
+    const unsigned char *p = span_cur;
+    const unsigned char *const end = span_end;
+    const unsigned char *event_start;
+    unsigned long lng;
+    int c, type;
+    int running = 0; // 1 when running status used
+    int status = 0;  // (possible running) status byte
+    int needed;      // number of bytes needed (1 or 2) for a channel message, or 0 if not a channel message
+
+    while ( to_be_read > 0 && !abort_parse )
+    {
+        event_start = p;
+
+        unsigned long deltat;
+
+        if ( !SpanReadVariableNum ( p, end, deltat ) || p == end )
+        {
+            mf_error ( "Unexpected Stream Error" );
+            break;
+        }
+
+        event_handler->UpdateTime ( deltat );
+        cur_time += deltat;
+        c = *p++;
+
+        if ( ( c & 0x80 ) == 0 )
+        {
+            if ( status == 0 )
+                mf_error ( "Unexpected Running Status" );
+
+            running = 1;
+            used_running_status = true;
+        }
+        else
+        {
+            status = c;
+            running = 0;
+        }
+
+        needed = chantype[ ( status>>4 ) & 0x0F ];
+
+        if ( needed ) // ie. is it a channel message?
+        {
+            if ( end - p < needed - running )
+            {
+                mf_error ( "Unexpected Stream Error" );
+                break;
+            }
+
+            unsigned char c1 = running ? c : *p++;
+            unsigned char c2 = ( needed > 1 ) ? *p++ : 0;
+            to_be_read -= p - event_start;
+
+            if ( !FormChanMessage ( status, c1, c2 ) )
+            {
+                mf_error("Parse error, invalid channel message");
+                abort_parse = true;
+            }
+            continue;
+        }
+
+        // else System Exclusive Event or Meta Event:
+
+        if ( status == 0xFF ) // META_EVENT
+        {
+            if ( p == end )
+            {
+                mf_error ( "Unexpected Stream Error" );
+                break;
+            }
+            type = *p++;
+        }
+        else if ( status == 0xF0 || status == 0xF7 ) // SYSEX_START, SYSEX_START_A
+        {
+            type = status;
+        }
+        else
+        {
+            mf_error ( "Unexpected status byte" );
+            abort_parse = true;
+            break;
+        }
+
+        if ( !SpanReadVariableNum ( p, end, lng ) )
+        {
+            mf_error ( "Unexpected Stream Error" );
+            break;
+        }
+
+        to_be_read -= p - event_start;
+
+        if ( lng > to_be_read )
+        {
+            // false variable length in midifile, thanks to Stephan.Huebler@tu-dresden.de
+            mf_error ( "Variable length incorrect" );
+            abort_parse = true;
+            break;
+        }
+
+        if ( lng > ( unsigned long ) ( end - p ) )
+        {
+            mf_error ( "Unexpected Stream Error" );
+            break;
+        }
+
+        // the message buffer spares 1 byte for a last NULL char, longer messages are truncated
+        act_msg_len = ( lng < ( unsigned long ) ( max_msg_len - 1 ) ) ? ( int ) lng : max_msg_len - 1;
+        memcpy ( the_msg, p, act_msg_len );
+        p += lng;
+        to_be_read -= lng;
+
+        if ( status == 0xFF )
+        {
+            if ( !event_handler->MetaEvent ( cur_time, type, act_msg_len, the_msg ) )
+            {
+                mf_error("Parse error, invalid meta message");
+                abort_parse = true;
+            }
+        }
+        else if ( !event_handler->mf_sysex ( cur_time, type, act_msg_len, the_msg ) )
+        {
+            mf_error("Parse error, invalid sysex message");
+            abort_parse = true;
+        }
+    }
+
+    span_cur = p;
+}
+
 unsigned long MIDIFileRead::ReadVariableNum()
 {
     unsigned long value;
@@ -576,7 +858,11 @@ int MIDIFileRead::Read16Bit()
 int MIDIFileRead::EGetC()
 {
     int c;
-    c = input_stream->ReadChar();
+
+    if ( span_cur )
+        c = ( span_cur < span_end ) ? *span_cur++ : -1;
+    else
+        c = input_stream->ReadChar();
 
     if ( c < 0 )
     {
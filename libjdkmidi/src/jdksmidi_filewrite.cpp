@@ -58,6 +58,17 @@ MIDIFileWriteStream::~MIDIFileWriteStream()
 {
 }
 
+int MIDIFileWriteStream::WriteChars ( const unsigned char *data, int count )
+{
+    for ( int i = 0; i < count; i++ )
+    {
+        if ( WriteChar ( data[i] ) < 0 )
+            return -1;
+    }
+
+    return count;
+}
+
 MIDIFileWriteStreamFile::MIDIFileWriteStreamFile ( FILE *f_ )
     : f ( f_ )
 {
@@ -85,6 +96,15 @@ int MIDIFileWriteStreamFile::WriteChar ( int c )
     }
 }
 
+int MIDIFileWriteStreamFile::WriteChars ( const unsigned char *data, int count )
+{
+    if ( fwrite ( data, 1, count, f ) != ( size_t ) count )
+    {
+        return -1;
+    }
+
+    return count;
+}
 
 MIDIFileWrite::MIDIFileWrite ( MIDIFileWriteStream *out_stream_ )
     : out_stream ( out_stream_ )
@@ -114,25 +134,37 @@ void MIDIFileWrite::Error ( const char *s )
 void MIDIFileWrite::WriteShort ( unsigned short c )
 {
     ENTER ( "void MIDIFileWrite::WriteShort()" );
-    WriteCharacter ( ( unsigned char ) ( ( c >> 8 ) & 0xff ) );
-    WriteCharacter ( ( unsigned char ) ( ( c & 0xff ) ) );
+    const uchar buf[2] =
+    {
+        ( uchar ) ( ( c >> 8 ) & 0xff ),
+        ( uchar ) ( c & 0xff )
+    };
+    WriteCharacters ( buf, 2 );
 }
 
 void MIDIFileWrite::Write3Char ( long c )
 {
     ENTER ( "void MIDIFileWrite::Write3Char()" );
-    WriteCharacter ( ( unsigned char ) ( ( c >> 16 ) & 0xff ) );
-    WriteCharacter ( ( unsigned char ) ( ( c >> 8 ) & 0xff ) );
-    WriteCharacter ( ( unsigned char ) ( ( c & 0xff ) ) );
+    const uchar buf[3] =
+    {
+        ( uchar ) ( ( c >> 16 ) & 0xff ),
+        ( uchar ) ( ( c >> 8 ) & 0xff ),
+        ( uchar ) ( c & 0xff )
+    };
+    WriteCharacters ( buf, 3 );
 }
 
 void MIDIFileWrite::WriteLong ( unsigned long c )
 {
     ENTER ( "void MIDIFileWrite::WriteLong()" );
-    WriteCharacter ( ( unsigned char ) ( ( c >> 24 ) & 0xff ) );
-    WriteCharacter ( ( unsigned char ) ( ( c >> 16 ) & 0xff ) );
-    WriteCharacter ( ( unsigned char ) ( ( c >> 8 ) & 0xff ) );
-    WriteCharacter ( ( unsigned char ) ( ( c & 0xff ) ) );
+    const uchar buf[4] =
+    {
+        ( uchar ) ( ( c >> 24 ) & 0xff ),
+        ( uchar ) ( ( c >> 16 ) & 0xff ),
+        ( uchar ) ( ( c >> 8 ) & 0xff ),
+        ( uchar ) ( c & 0xff )
+    };
+    WriteCharacters ( buf, 4 );
 }
 
 void MIDIFileWrite::WriteFileHeader (
@@ -142,10 +174,7 @@ void MIDIFileWrite::WriteFileHeader (
 )
 {
     ENTER ( "void MIDIFileWrite::WriteFileHeader()" );
-    WriteCharacter ( ( unsigned char ) 'M' );
-    WriteCharacter ( ( unsigned char ) 'T' );
-    WriteCharacter ( ( unsigned char ) 'h' );
-    WriteCharacter ( ( unsigned char ) 'd' );
+    WriteCharacters ( ( const uchar * ) "MThd", 4 );
     WriteLong ( 6 );
     WriteShort ( ( short ) format );
     WriteShort ( ( short ) ntrks );
@@ -160,10 +189,7 @@ void MIDIFileWrite::WriteTrackHeader ( unsigned long length )
     track_length = 0;
     track_time = 0;
     running_status = 0;
-    WriteCharacter ( ( unsigned char ) 'M' );
-    WriteCharacter ( ( unsigned char ) 'T' );
-    WriteCharacter ( ( unsigned char ) 'r' );
-    WriteCharacter ( ( unsigned char ) 'k' );
+    WriteCharacters ( ( const uchar * ) "MTrk", 4 );
     WriteLong ( length );
     file_length += 8;
     within_track = true;
@@ -172,29 +198,18 @@ void MIDIFileWrite::WriteTrackHeader ( unsigned long length )
 int MIDIFileWrite::WriteVariableNum ( unsigned long n )
 {
     ENTER ( "short MIDIFileWrite::WriteVariableNum()" );
-    register unsigned long buffer;
-    short cnt = 0;
-    buffer = n & 0x7f;
+    // fill the buffer backwards, least significant group of 7 bits last
+    uchar buffer[10];
+    int pos = sizeof ( buffer ) - 1;
+    buffer[pos] = ( uchar ) ( n & 0x7f );
 
     while ( ( n >>= 7 ) > 0 )
     {
-        buffer <<= 8;
-        buffer |= 0x80;
-        buffer += ( n & 0x7f );
-    }
-
-    while ( true )
-    {
-        WriteCharacter ( ( unsigned char ) ( buffer & 0xff ) );
-        cnt++;
-
-        if ( buffer & 0x80 )
-            buffer >>= 8;
-
-        else
-            break;
+        buffer[--pos] = ( uchar ) ( ( n & 0x7f ) | 0x80 );
     }
 
+    int cnt = sizeof ( buffer ) - pos;
+    WriteCharacters ( buffer + pos, cnt );
     return cnt;
 }
 
@@ -272,27 +287,25 @@ void MIDIFileWrite::WriteEvent ( const MIDITimedBigMessage &m )
         WriteDeltaTime ( m.GetTime() );
 
         unsigned char status = m.GetStatus();
+        uchar buf[3];
+        int cnt = 0;
 
         if ( running_status != status )
         {
-            WriteCharacter ( status );
-            IncrementCounters ( 1 );
+            buf[cnt++] = status;
             running_status = status;
             if ( !use_running_status )
                 running_status = 0;
         }
 
         if ( len > 1 )
-        {
-            WriteCharacter ( m.GetByte1() );
-            IncrementCounters ( 1 );
-        }
+            buf[cnt++] = m.GetByte1();
 
         if ( len > 2 )
-        {
-            WriteCharacter ( m.GetByte2() );
-            IncrementCounters ( 1 );
-        }
+            buf[cnt++] = m.GetByte2();
+
+        WriteCharacters ( buf, cnt );
+        IncrementCounters ( cnt );
     }
 }
 
@@ -307,10 +320,7 @@ void MIDIFileWrite::WriteSystemExclusiveEvent ( const MIDITimedBigMessage &m )
     int len = m.GetSysEx()->GetLengthSE();
     IncrementCounters ( WriteVariableNum ( len ) );
 
-    for ( int i = 0; i < len; i++ )
-    {
-        WriteCharacter ( m.GetSysEx()->GetData ( i ) );
-    }
+    WriteCharacters ( m.GetSysEx()->GetBuf(), len );
     IncrementCounters ( len );
 
     running_status = 0;
@@ -328,10 +338,7 @@ void MIDIFileWrite::WriteTextEvent ( unsigned long time, unsigned char type, con
     int len = strlen ( text );
     IncrementCounters ( WriteVariableNum ( len ) );
 
-    while ( *text )
-    {
-        WriteCharacter ( ( unsigned char ) *text++ );
-    }
+    WriteCharacters ( ( const uchar * ) text, len );
     IncrementCounters ( len );
 
     running_status = 0;
@@ -348,11 +355,7 @@ void MIDIFileWrite::WriteMetaEvent ( unsigned long time, unsigned char type, con
 
     IncrementCounters ( WriteVariableNum ( length ) );
 
-    for ( int i = 0; i < length; i++ )
-    {
-        WriteCharacter ( data[i] );
-    }
-
+    WriteCharacters ( data, length );
     IncrementCounters ( length );
     running_status = 0;
 }
@@ -170,30 +170,24 @@ MIDIMultiTrackIteratorState::MIDIMultiTrackIteratorState ( int num_tracks_ )
 {
     num_tracks = num_tracks_;
     cur_event_track = 0;
-    next_event_number = new int [num_tracks];
-    next_event_time = new MIDIClockTime [num_tracks];
+    Allocate();
     Reset();
 }
 
 MIDIMultiTrackIteratorState::MIDIMultiTrackIteratorState ( const MIDIMultiTrackIteratorState &m )
 {
     num_tracks = m.num_tracks;
-    cur_event_track = m.cur_event_track;
-    next_event_number = new int [num_tracks];
-    next_event_time = new MIDIClockTime [num_tracks];
-    cur_time = m.cur_time;
-
-    for ( int i = 0; i < num_tracks; ++i )
-    {
-        next_event_number[i] = m.next_event_number[i];
-        next_event_time[i] = m.next_event_time[i];
-    }
+    Allocate();
+    CopyFrom( m );
 }
 
 MIDIMultiTrackIteratorState::~MIDIMultiTrackIteratorState()
 {
     jdks_safe_delete_array( next_event_number );
     jdks_safe_delete_array( next_event_time );
+    jdks_safe_delete_array( heap );
+    jdks_safe_delete_array( tied_tracks );
+    jdks_safe_delete_array( heap_position );
 }
 
 const MIDIMultiTrackIteratorState & MIDIMultiTrackIteratorState::operator = ( const MIDIMultiTrackIteratorState &m )
@@ -202,58 +196,258 @@ const MIDIMultiTrackIteratorState & MIDIMultiTrackIteratorState::operator = ( co
     {
         delete [] next_event_number;
         delete [] next_event_time;
+        delete [] heap;
+        delete [] tied_tracks;
+        delete [] heap_position;
         num_tracks = m.num_tracks;
-        next_event_number = new int [num_tracks];
-        next_event_time = new MIDIClockTime [num_tracks];
+        Allocate();
     }
 
+    CopyFrom( m );
+    return *this;
+}
+
+void MIDIMultiTrackIteratorState::Allocate()
+{
+    next_event_number = new int [num_tracks];
+    next_event_time = new MIDIClockTime [num_tracks];
+    heap = new int [num_tracks];
+    tied_tracks = new int [num_tracks];
+    heap_position = new int [num_tracks];
+}
+
+void MIDIMultiTrackIteratorState::CopyFrom ( const MIDIMultiTrackIteratorState &m )
+{
     cur_time = m.cur_time;
     cur_event_track = m.cur_event_track;
+    heap_size = m.heap_size;
+    tied_count = m.tied_count;
+    tied_time = m.tied_time;
 
     for ( int i = 0; i < num_tracks; ++i )
     {
         next_event_number[i] = m.next_event_number[i];
         next_event_time[i] = m.next_event_time[i];
+        heap[i] = m.heap[i];
+        tied_tracks[i] = m.tied_tracks[i];
+        heap_position[i] = m.heap_position[i];
     }
-
-    return *this;
 }
 
 void MIDIMultiTrackIteratorState::Reset()
 {
     cur_time = 0;
     cur_event_track = 0;
+    heap_size = 0;
+    tied_count = 0;
+    tied_time = 0;
 
     for ( int i = 0; i < num_tracks; ++i )
     {
         next_event_number[i] = 0;
         next_event_time[i] = 0xffffffff;
+        heap[i] = -1;
+        tied_tracks[i] = -1;
+        heap_position[i] = -1;
     }
 }
 
-int MIDIMultiTrackIteratorState::FindTrackOfFirstEvent()
+void MIDIMultiTrackIteratorState::HeapSwap ( int pos_a, int pos_b )
 {
-    MIDIClockTime minimum_time = 0xffffffff;
-    int minimum_time_track = -1;
-    // go through all tracks and find the track with the smallest
-    // event time.
+    int track = heap[pos_a];
+    heap[pos_a] = heap[pos_b];
+    heap[pos_b] = track;
+    heap_position[ heap[pos_a] ] = pos_a;
+    heap_position[ heap[pos_b] ] = pos_b;
+}
 
-    for ( int j = 0; j < num_tracks; ++j )
+void MIDIMultiTrackIteratorState::HeapSiftUp ( int pos )
+{
+    while ( pos > 0 && HeapLess( heap[pos], heap[ ( pos - 1 ) / 2 ] ) )
     {
-        int i = ( j + cur_event_track + 1 ) % num_tracks;
-        // skip any tracks that have a current event number less than 0 - these are
-        // finished already
+        HeapSwap( pos, ( pos - 1 ) / 2 );
+        pos = ( pos - 1 ) / 2;
+    }
+}
+
+void MIDIMultiTrackIteratorState::HeapSiftDown ( int pos )
+{
+    while ( true )
+    {
+        int smallest = pos;
+        int left = pos * 2 + 1;
+        int right = left + 1;
+
+        if ( left < heap_size && HeapLess( heap[left], heap[smallest] ) )
+            smallest = left;
+
+        if ( right < heap_size && HeapLess( heap[right], heap[smallest] ) )
+            smallest = right;
+
+        if ( smallest == pos )
+            return;
+
+        HeapSwap( pos, smallest );
+        pos = smallest;
+    }
+}
+
+void MIDIMultiTrackIteratorState::HeapInsert ( int track )
+{
+    int pos = heap_size++;
+    heap[pos] = track;
+    heap_position[track] = pos;
+    HeapSiftUp( pos );
+}
+
+void MIDIMultiTrackIteratorState::HeapRemove ( int pos )
+{
+    int track = heap[pos];
+    heap_position[track] = -1;
+    --heap_size;
+
+    if ( pos < heap_size )
+    {
+        // move the last track of the heap in the hole, then put it back in order
+        int moved = heap[heap_size];
+        heap[pos] = moved;
+        heap_position[moved] = pos;
+        HeapSiftUp( pos );
+        HeapSiftDown( heap_position[moved] );
+    }
+}
+
+void MIDIMultiTrackIteratorState::TiedInsert ( int track )
+{
+    int pos = tied_count++;
+
+    while ( pos > 0 && tied_tracks[pos - 1] > track )
+    {
+        tied_tracks[pos] = tied_tracks[pos - 1];
+        --pos;
+    }
+
+    tied_tracks[pos] = track;
+    heap_position[track] = IN_TIED_TRACKS;
+}
 
-        if ( next_event_number[i] >= 0 && next_event_time[i] < minimum_time )
+void MIDIMultiTrackIteratorState::TiedRemove ( int track )
+{
+    int pos = 0;
+
+    while ( tied_tracks[pos] != track )
+        ++pos;
+
+    for ( --tied_count; pos < tied_count; ++pos )
+        tied_tracks[pos] = tied_tracks[pos + 1];
+
+    heap_position[track] = -1;
+}
+
+void MIDIMultiTrackIteratorState::TiedFlush()
+{
+    for ( int i = 0; i < tied_count; ++i )
+        HeapInsert( tied_tracks[i] );
+
+    tied_count = 0;
+}
+
+void MIDIMultiTrackIteratorState::TiedFill()
+{
+    if ( heap_size == 0 )
+        return;
+
+    // ties in the heap are ordered by track number, so the tracks come out sorted
+    tied_time = next_event_time[ heap[0] ];
+
+    while ( heap_size > 0 && next_event_time[ heap[0] ] == tied_time )
+    {
+        int track = heap[0];
+        HeapRemove( 0 );
+        tied_tracks[tied_count++] = track;
+        heap_position[track] = IN_TIED_TRACKS;
+    }
+}
+
+void MIDIMultiTrackIteratorState::UpdateTrackOrder ( int track )
+{
+    bool has_events = next_event_number[track] >= 0;
+
+    if ( heap_position[track] == IN_TIED_TRACKS )
+    {
+        // most common case : another event at the same time on this track
+        if ( has_events && next_event_time[track] == tied_time )
+            return;
+
+        TiedRemove( track );
+    }
+
+    else if ( heap_position[track] >= 0 )
+    {
+        HeapRemove( heap_position[track] );
+    }
+
+    if ( !has_events )
+        return;
+
+    if ( tied_count > 0 )
+    {
+        if ( next_event_time[track] == tied_time )
         {
-            minimum_time = next_event_time[i];
-            minimum_time_track = i;
+            TiedInsert( track );
+            return;
         }
+
+        if ( next_event_time[track] < tied_time )
+        {
+            // the tied tracks are no longer the earliest ones
+            TiedFlush();
+        }
+    }
+
+    HeapInsert( track );
+}
+
+void MIDIMultiTrackIteratorState::RebuildTrackOrder()
+{
+    heap_size = 0;
+    tied_count = 0;
+
+    for ( int i = 0; i < num_tracks; ++i )
+        heap_position[i] = -1;
+
+    for ( int i = 0; i < num_tracks; ++i )
+    {
+        if ( next_event_number[i] >= 0 )
+            HeapInsert( i );
     }
+}
 
-    // set cur_event_track to -1 if there are no more events left
-    cur_event_track = minimum_time_track;
-    cur_time = minimum_time;
+int MIDIMultiTrackIteratorState::FindTrackOfFirstEvent()
+{
+    if ( tied_count == 0 )
+        TiedFill();
+
+    if ( tied_count == 0 || tied_time == 0xffffffff )
+    {
+        // set cur_event_track to -1 if there are no more events left
+        cur_event_track = -1;
+        cur_time = 0xffffffff;
+        return cur_event_track;
+    }
+
+    // tracks with an event at the earliest time take turns : pick the first one after the current
+    // track, wrapping around to the first one
+    int pos = 0;
+
+    while ( pos < tied_count && tied_tracks[pos] <= cur_event_track )
+        ++pos;
+
+    if ( pos == tied_count )
+        pos = 0;
+
+    cur_event_track = tied_tracks[pos];
+    cur_time = tied_time;
     return cur_event_track;
 }
 
@@ -304,6 +498,8 @@ void MIDIMultiTrackIterator::GoToTime ( MIDIClockTime time )
         }
     }
 
+    state.RebuildTrackOrder();
+
     // are there any events at all? find the track with the
     // earliest event
 
@@ -428,6 +624,7 @@ bool MIDIMultiTrackIterator::GoToNextEventOnTrack ( int track_num )
     {
         // yes, set *event_num to -1
         *event_num = -1;
+        state.UpdateTrackOrder ( track_num );
         return false; // at end of track
     }
 
@@ -437,6 +634,7 @@ bool MIDIMultiTrackIterator::GoToNextEventOnTrack ( int track_num )
         const MIDITimedBigMessage *msg;
         msg = track->GetEventAddress ( *event_num );
         state.next_event_time[ track_num ] = msg->GetTime();
+        state.UpdateTrackOrder ( track_num );
     }
 
     return true;
@@ -538,6 +538,14 @@ const MIDISequencerState & MIDISequencerState::operator = ( const MIDISequencerS
         }
     }
 
+    else
+    {
+        for ( int i = 0; i < num_tracks; ++i )
+        {
+            *track_state[i] = *s.track_state[i];
+        }
+    }
+
     iterator = s.iterator;
     cur_clock = s.cur_clock;
     cur_time_ms = s.cur_time_ms;
@@ -559,17 +567,26 @@ MIDISequencer::MIDISequencer (
     solo_mode ( false ),
     tempo_scale ( 100 ),
     num_tracks ( m->GetNumTracks() ),
-    state ( this, m, n ) // TO DO: fix this hack
+    state ( this, m, n ), // TO DO: fix this hack
+    checkpoint_interval ( 0 ),
+    on_checkpoint_path ( false )
 {
     for ( int i = 0; i < num_tracks; ++i )
     {
         track_processors[i] = new MIDISequencerTrackProcessor;
     }
+
+    for ( int i = 0; i < MAX_SEQUENCER_CHECKPOINTS; ++i )
+    {
+        checkpoints[i] = 0;
+    }
 }
 
 
 MIDISequencer::~MIDISequencer()
 {
+    ClearCheckpoints();
+
     for ( int i = 0; i < num_tracks; ++i )
     {
         jdks_safe_delete_object( track_processors[i] );
@@ -580,6 +597,7 @@ void MIDISequencer::ResetTrack ( int trk )
 {
     state.track_state[trk]->Reset();
     track_processors[trk]->Reset();
+    ClearCheckpoints();
 }
 
 void MIDISequencer::ResetAllTracks()
@@ -589,6 +607,82 @@ void MIDISequencer::ResetAllTracks()
         state.track_state[i]->Reset();
         track_processors[i]->Reset();
     }
+
+    ClearCheckpoints();
+}
+
+void MIDISequencer::ClearCheckpoints()
+{
+    for ( int i = 0; i < MAX_SEQUENCER_CHECKPOINTS; ++i )
+    {
+        jdks_safe_delete_object( checkpoints[i] );
+    }
+
+    // computed again on next use, the multitrack may have changed
+    checkpoint_interval = 0;
+    // and the current state may not match what it would be with the new settings
+    on_checkpoint_path = false;
+}
+
+void MIDISequencer::SaveCheckpoint()
+{
+    if ( checkpoint_interval == 0 )
+    {
+        // spread the checkpoints over the whole song, but no closer than every 4 measures of 4/4
+        MIDIClockTime last_time = 0;
+
+        for ( int i = 0; i < state.multitrack->GetNumTracks(); ++i )
+        {
+            const MIDITrack *track = state.multitrack->GetTrack ( i );
+
+            if ( track && track->GetLastEventTime() > last_time )
+            {
+                last_time = track->GetLastEventTime();
+            }
+        }
+
+        checkpoint_interval = last_time / MAX_SEQUENCER_CHECKPOINTS + 1;
+
+        const MIDIClockTime min_interval = state.multitrack->GetClksPerBeat() * 16;
+
+        if ( checkpoint_interval < min_interval )
+        {
+            checkpoint_interval = min_interval;
+        }
+    }
+
+    const MIDIClockTime i = state.cur_clock / checkpoint_interval;
+
+    if ( i < MAX_SEQUENCER_CHECKPOINTS && checkpoints[i] == 0 )
+    {
+        checkpoints[i] = new MIDISequencerState ( state );
+    }
+}
+
+const MIDISequencerState *MIDISequencer::FindCheckpoint ( MIDIClockTime time_clk ) const
+{
+    for ( int i = MAX_SEQUENCER_CHECKPOINTS - 1; i >= 0; --i )
+    {
+        if ( checkpoints[i] && checkpoints[i]->cur_clock < time_clk )
+        {
+            return checkpoints[i];
+        }
+    }
+
+    return 0;
+}
+
+const MIDISequencerState *MIDISequencer::FindCheckpointMs ( float time_ms ) const
+{
+    for ( int i = MAX_SEQUENCER_CHECKPOINTS - 1; i >= 0; --i )
+    {
+        if ( checkpoints[i] && checkpoints[i]->cur_time_ms < time_ms )
+        {
+            return checkpoints[i];
+        }
+    }
+
+    return 0;
 }
 
 MIDISequencerState *MIDISequencer::GetState()
@@ -604,6 +698,7 @@ const MIDISequencerState *MIDISequencer::GetState() const
 void MIDISequencer::SetState ( MIDISequencerState *s )
 {
     state = *s;
+    on_checkpoint_path = false;
 }
 
 MIDIClockTime MIDISequencer::GetCurrentMIDIClockTime() const
@@ -664,13 +759,22 @@ bool MIDISequencer::GetSoloMode() const
 
 void MIDISequencer::SetCurrentTempoScale ( float scale )
 {
-    tempo_scale = ( int ) ( scale * 100 );
+    const int new_tempo_scale = ( int ) ( scale * 100 );
+
+    // times in milliseconds of the checkpoints depend on the tempo scale
+    if ( new_tempo_scale != tempo_scale )
+    {
+        ClearCheckpoints();
+    }
+
+    tempo_scale = new_tempo_scale;
 }
 
 void MIDISequencer::SetSoloMode ( bool m, int trk )
 {
     int i;
     solo_mode = m;
+    ClearCheckpoints();
 
     for ( i = 0; i < num_tracks; ++i )
     {
@@ -717,23 +821,43 @@ bool MIDISequencer::GoToTime ( MIDIClockTime time_clk )
         state.notifier->SetEnable ( false );
     }
 
+    const MIDISequencerState *checkpoint = FindCheckpoint ( time_clk );
+
     if ( time_clk < state.cur_clock || time_clk == 0 )
     {
-        // start from zero if desired time is before where we are
-        for ( int i = 0; i < state.num_tracks; ++i )
+        if ( checkpoint )
         {
-            state.track_state[i]->GoToZero();
+            // start from the last checkpoint before desired time
+            state = *checkpoint;
+            on_checkpoint_path = true;
         }
 
-        state.iterator.GoToTime ( 0 );
-        state.cur_time_ms = 0.0;
-        state.cur_clock = 0;
+        else
+        {
+            // start from zero if desired time is before where we are
+            for ( int i = 0; i < state.num_tracks; ++i )
+            {
+                state.track_state[i]->GoToZero();
+            }
+
+            state.iterator.GoToTime ( 0 );
+            state.cur_time_ms = 0.0;
+            state.cur_clock = 0;
 //  state.next_beat_time = state.multitrack->GetClksPerBeat();
-        state.next_beat_time =
-            state.multitrack->GetClksPerBeat()
-            * 4 / ( state.track_state[0]->timesig_denominator );
-        state.cur_beat = 0;
-        state.cur_measure = 0;
+            state.next_beat_time =
+                state.multitrack->GetClksPerBeat()
+                * 4 / ( state.track_state[0]->timesig_denominator );
+            state.cur_beat = 0;
+            state.cur_measure = 0;
+            on_checkpoint_path = true;
+        }
+    }
+
+    else if ( checkpoint && checkpoint->cur_clock > state.cur_clock )
+    {
+        // skip ahead to the last checkpoint before desired time
+        state = *checkpoint;
+        on_checkpoint_path = true;
     }
 
     MIDIClockTime t = 0;
@@ -746,7 +870,10 @@ bool MIDISequencer::GoToTime ( MIDIClockTime time_clk )
         && GetNextEvent ( &trk, &ev )
     )
     {
-        ;
+        if ( on_checkpoint_path )
+        {
+            SaveCheckpoint();
+        }
     }
 
     // examine all the events at this specific time
@@ -775,23 +902,43 @@ bool MIDISequencer::GoToTimeMs ( float time_ms )
         state.notifier->SetEnable ( false );
     }
 
+    const MIDISequencerState *checkpoint = FindCheckpointMs ( time_ms );
+
     if ( time_ms < state.cur_time_ms || time_ms == 0.0 )
     {
-        // start from zero if desired time is before where we are
-        for ( int i = 0; i < state.num_tracks; ++i )
+        if ( checkpoint )
         {
-            state.track_state[i]->GoToZero();
+            // start from the last checkpoint before desired time
+            state = *checkpoint;
+            on_checkpoint_path = true;
         }
 
-        state.iterator.GoToTime ( 0 );
-        state.cur_time_ms = 0.0;
-        state.cur_clock = 0;
+        else
+        {
+            // start from zero if desired time is before where we are
+            for ( int i = 0; i < state.num_tracks; ++i )
+            {
+                state.track_state[i]->GoToZero();
+            }
+
+            state.iterator.GoToTime ( 0 );
+            state.cur_time_ms = 0.0;
+            state.cur_clock = 0;
 //  state.next_beat_time = state.multitrack->GetClksPerBeat();
-        state.next_beat_time =
-            state.multitrack->GetClksPerBeat()
-            * 4 / ( state.track_state[0]->timesig_denominator );
-        state.cur_beat = 0;
-        state.cur_measure = 0;
+            state.next_beat_time =
+                state.multitrack->GetClksPerBeat()
+                * 4 / ( state.track_state[0]->timesig_denominator );
+            state.cur_beat = 0;
+            state.cur_measure = 0;
+            on_checkpoint_path = true;
+        }
+    }
+
+    else if ( checkpoint && checkpoint->cur_time_ms > state.cur_time_ms )
+    {
+        // skip ahead to the last checkpoint before desired time
+        state = *checkpoint;
+        on_checkpoint_path = true;
     }
 
     float t = 0;
@@ -804,7 +951,10 @@ bool MIDISequencer::GoToTimeMs ( float time_ms )
         && GetNextEvent ( &trk, &ev )
     )
     {
-        ;
+        if ( on_checkpoint_path )
+        {
+            SaveCheckpoint();
+        }
     }
 
     // examine all the events at this specific time
@@ -1098,6 +1248,8 @@ void MIDISequencer::ScanEventsAtThisTime()
 
     // restore the iterator state
     state.iterator.SetState ( istate );
+    // track states now include the events at this time, that will be processed again
+    on_checkpoint_path = false;
     // and current time
     state.cur_clock = orig_clock;
     state.cur_time_ms = float ( orig_time_ms );